@@ -0,0 +1,544 @@
+//  Benchmark program for SRELL.
+//  Version 1.000 (2026/10/18)
+//
+//  Usage: bench [-s size] [-n repeats] [-c cputouse] [filter]
+//    -s: Size of each generated corpus in KiB of code points (default: 4096).
+//    -n: How many times each case is run. The fastest run is reported (default: 5).
+//    -c: Pins the process to the CPU specified (Linux only).
+//    filter: Runs only the cases whose names contain this string.
+//
+//  Requires C++11 or later. char8_t is measured when the compiler supports it.
+//  Example: g++ -O2 -std=c++20 -o bench bench.cpp
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "../srell.hpp"
+
+namespace constants
+{
+	enum corpus_type
+	{
+		log, html, multilingual, num_of_corpora
+	};
+
+	enum operation_type
+	{
+		search, replace, split, lines
+	};
+}
+
+struct benchcase
+{
+	const char *name;
+	constants::corpus_type corpus;
+	const char32_t *pattern;
+	srell::regex_constants::syntax_option_type flags;
+	constants::operation_type operation;
+	const char32_t *format;	//  For replace.
+};
+
+const benchcase cases[] =
+{
+	{ "literal-bmh", constants::log, U"connection reset", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "literal-bmh-icase", constants::log, U"CONNECTION RESET", srell::regex_constants::icase, constants::search, NULL },
+	{ "single-char-finder", constants::log, U"@[a-z]+\\.(?:com|org)", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "firstchar-bitset", constants::log, U"\\d+ms", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "group-loop", constants::log, U"/(?:[a-z]+/)+\\d+ ", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "bounded-repeat", constants::log, U"\\[[-\\w]{3,16}\\] \\w{3,6} /\\w{3,12}", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "alternation", constants::html, U"</?(?:div|span|a)\\b", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "keyword-list", constants::html, U"\\b(?:alpha|beta|gamma|dolor|elit|iota|kappa|lambda|nu|omega|pi|rho|sigma|tau|upsilon|xi|zeta)\\b", srell::regex_constants::ECMAScript, constants::search, NULL },
+	//  196 words; six of them occur in the corpus.
+	{ "alternation-large", constants::html, U"\\b(?:able|act|age|allow|amet|and|apple|arrive|bad|beat|bell|black|bone|box|brother|buy|capital|"
+		U"carry|cell|charge|child|city|clock|coat|column|complete|contain|cool|cost|course|crop|cut|"
+		U"day|decide|describe|dictionary|direct|doctor|dolor|done|dream|dry|early|edge|electric|elit|"
+		U"enemy|equal|event|except|experiment|fall|fast|feed|few|fill|finish|five|fly|force|fraction|"
+		U"front|garden|gentle|glass|govern|green|guess|hand|hat|heart|her|his|home|house|hunt|"
+		U"imagine|insect|ipsum|joy|key|know|large|lay|led|let|lift|list|log|lorem|lost|machine|make|"
+		U"market|matter|meat|method|million|mix|month|mother|move|name|necessary|new|none|note|"
+		U"number|ocean|oil|open|original|own|paper|party|pay|phrase|place|plant|point|position|"
+		U"practice|print|product|provide|question|race|ran|ready|red|represent|ride|road|rope|rule|"
+		U"salt|saw|score|second|segment|sense|set|shape|shell|shore|show|silver|single|sit|skill|"
+		U"slip|snow|solution|soon|special|spoke|stand|stay|stick|store|street|study|such|suit|sure|"
+		U"symbol|talk|tell|than|them|thick|this|three|time|tone|total|trade|trip|tube|under|us|vary|"
+		U"visit|wall|wash|wear|went|when|white|wide|wind|wish|wood|write|year|young)\\b", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "property-script", constants::multilingual, U"\\p{Script=Greek}+", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "property-letter", constants::multilingual, U"\\p{L}+", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "icase-nonascii", constants::multilingual, U"STRA\u1e9eE|\u039b\u039f\u0393\u039f\u03a3", srell::regex_constants::icase, constants::search, NULL },
+	{ "quoted-string", constants::html, U"\"[^\"]*\"", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "backreference", constants::html, U"<(\\w+)[^>]*>[^<]*</\\1>", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "start-anchored", constants::log, U"^[-\\d]+T\\S+ [A-Z]+ ", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "end-anchored", constants::log, U"\\w{1,16}\\s$", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "leading-dotstar", constants::log, U".*\\.\\d{3}$", srell::regex_constants::multiline, constants::search, NULL },
+	{ "lookbehind", constants::log, U"(?<=user=)\\w+", srell::regex_constants::ECMAScript, constants::search, NULL },
+	{ "required-units", constants::log, U"&id=(\\d+) 500", srell::regex_constants::ECMAScript, constants::lines, NULL },
+	{ "replace", constants::log, U"\\d+", srell::regex_constants::ECMAScript, constants::replace, U"#" },
+	{ "split", constants::multilingual, U"\\s+", srell::regex_constants::ECMAScript, constants::split, NULL },
+	{ "search-lines", constants::log, U"ERROR .* 500 .*=mallory", srell::regex_constants::ECMAScript, constants::lines, NULL },
+	{ NULL, constants::log, NULL, srell::regex_constants::ECMAScript, constants::search, NULL }
+};
+
+struct options
+{
+	std::size_t size;
+	unsigned int repeats;
+	int cpu;
+	const char *filter;
+	int errorno;
+
+	options(const int argc, const char *const *const argv)
+		: size(4096 * 1024)
+		, repeats(5)
+		, cpu(-1)
+		, filter(NULL)
+		, errorno(0)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+				size = static_cast<std::size_t>(std::strtoul(argv[++i], NULL, 10)) * 1024;
+			else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+				repeats = static_cast<unsigned int>(std::strtoul(argv[++i], NULL, 10));
+			else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+				cpu = std::atoi(argv[++i]);
+			else if (argv[i][0] != '-' && filter == NULL)
+				filter = argv[i];
+			else
+			{
+				std::fprintf(stderr, "[Error] Unknown option: %s\n", argv[i]);
+				errorno = 1;
+				return;
+			}
+		}
+
+		if (size == 0 || repeats == 0)
+		{
+			std::fputs("[Error] -s and -n require a positive number.\n", stderr);
+			errorno = 1;
+		}
+	}
+};
+//  struct options
+
+//  Corpus generation.
+//  A fixed seed is used so that every run measures the same text.
+
+class xorshift32
+{
+public:
+
+	xorshift32() : state_(2463534242u)
+	{
+	}
+
+	unsigned long next(const unsigned long range)
+	{
+		//  Masked so that the sequence does not depend on the width of long.
+		state_ ^= (state_ << 13) & 0xffffffffu;
+		state_ ^= state_ >> 17;
+		state_ ^= (state_ << 5) & 0xffffffffu;
+		return state_ % range;
+	}
+
+private:
+
+	unsigned long state_;
+};
+
+template <std::size_t N>
+const char32_t *pick(xorshift32 &rng, const char32_t *const (&words)[N])
+{
+	return words[rng.next(N)];
+}
+
+void append_number(std::u32string &out, unsigned long num, unsigned int width)
+{
+	char32_t digits[16];
+	unsigned int len = 0;
+
+	do
+	{
+		digits[len++] = static_cast<char32_t>(U'0' + num % 10);
+		num /= 10;
+	}
+	while (num);
+
+	for (; width > len; --width)
+		out.push_back(U'0');
+
+	while (len)
+		out.push_back(digits[--len]);
+}
+
+std::u32string make_log(const std::size_t size)
+{
+	static const char32_t *const levels[] = { U"INFO ", U"INFO ", U"INFO ", U"DEBUG", U"WARN ", U"ERROR" };
+	static const char32_t *const methods[] = { U"GET", U"GET", U"POST", U"PUT", U"DELETE" };
+	static const char32_t *const paths[] = { U"/api/v1/items/", U"/api/v1/users/", U"/static/img/", U"/login?next=/home&id=" };
+	static const char32_t *const users[] = { U"alice", U"bob", U"carol", U"dave", U"eve", U"mallory" };
+	static const char32_t *const domains[] = { U"example.com", U"example.org", U"mail.example.net" };
+	static const char32_t *const notes[] = { U"", U"", U"", U" connection reset by peer", U" retrying", U" cache miss" };
+	xorshift32 rng;
+	std::u32string out;
+
+	while (out.size() < size)
+	{
+		out.append(U"2026-10-");
+		append_number(out, rng.next(28) + 1, 2);
+		out.push_back(U'T');
+		append_number(out, rng.next(24), 2);
+		out.push_back(U':');
+		append_number(out, rng.next(60), 2);
+		out.push_back(U':');
+		append_number(out, rng.next(60), 2);
+		out.push_back(U'.');
+		append_number(out, rng.next(1000), 3);
+		out.append(U"Z ");
+		out.append(pick(rng, levels));
+		out.append(U" [worker-");
+		append_number(out, rng.next(32), 0);
+		out.append(U"] ");
+		out.append(pick(rng, methods));
+		out.push_back(U' ');
+		out.append(pick(rng, paths));
+		append_number(out, rng.next(100000), 0);
+		out.push_back(U' ');
+		append_number(out, rng.next(5) ? 200 : 500, 0);
+		out.push_back(U' ');
+		append_number(out, rng.next(2000), 0);
+		out.append(U"ms user=");
+		out.append(pick(rng, users));
+		out.push_back(U'@');
+		out.append(pick(rng, domains));
+		out.append(U" ip=192.168.");
+		append_number(out, rng.next(256), 0);
+		out.push_back(U'.');
+		append_number(out, rng.next(256), 0);
+		out.append(pick(rng, notes));
+		out.push_back(U'\n');
+	}
+	return out;
+}
+
+std::u32string make_html(const std::size_t size)
+{
+	static const char32_t *const tags[] = { U"div", U"span", U"p", U"a", U"li", U"em", U"strong" };
+	static const char32_t *const words[] = { U"lorem", U"ipsum", U"dolor", U"sit", U"amet", U"consectetur", U"adipiscing", U"elit", U"&amp;", U"&lt;tag&gt;" };
+	xorshift32 rng;
+	std::u32string out(U"<!DOCTYPE html>\n<html><head><title>Benchmark</title></head><body>\n");
+
+	while (out.size() < size)
+	{
+		const char32_t *const outer = pick(rng, tags);
+		const char32_t *const inner = pick(rng, tags);
+
+		out.push_back(U'<');
+		out.append(outer);
+		out.append(U" class=\"item-");
+		append_number(out, rng.next(100), 0);
+		out.append(U"\">");
+
+		for (unsigned long i = rng.next(4) + 1; i; --i)
+		{
+			out.push_back(U'<');
+			out.append(inner);
+			if (inner[0] == U'a' && inner[1] == 0)
+			{
+				out.append(U" href=\"https://example.com/page/");
+				append_number(out, rng.next(10000), 0);
+				out.push_back(U'"');
+			}
+			out.push_back(U'>');
+
+			for (unsigned long j = rng.next(6) + 1; j; --j)
+			{
+				out.append(pick(rng, words));
+				out.push_back(U' ');
+			}
+
+			out.append(U"</");
+			out.append(inner);
+			out.push_back(U'>');
+		}
+
+		out.append(U"</");
+		out.append(outer);
+		out.append(U">\n");
+	}
+	return out;
+}
+
+std::u32string make_multilingual(const std::size_t size)
+{
+	static const char32_t *const words[] =
+	{
+		U"the", U"quick", U"brown", U"fox", U"caf\u00e9", U"na\u00efve", U"Stra\u00dfe",
+		U"\u03b1\u03bb\u03c6\u03b1", U"\u03bb\u03cc\u03b3\u03bf\u03c2", U"\u039b\u03bf\u03b3\u03bf\u03c2",	//  Greek.
+		U"\u043c\u0438\u0440", U"\u0441\u043b\u043e\u0432\u043e",	//  Cyrillic.
+		U"\u65e5\u672c\u8a9e", U"\u3072\u3089\u304c\u306a", U"\u30ab\u30bf\u30ab\u30ca",	//  Japanese.
+		U"\u4e2d\u6587", U"\ud55c\uad6d\uc5b4",	//  Chinese, Korean.
+		U"\u0645\u0631\u062d\u0628\u0627", U"\u05e9\u05dc\u05d5\u05dd",	//  Arabic, Hebrew.
+		U"\U0001f600", U"\U0001f44d\U0001f3fd", U"\U00020bb7"	//  Emoji, CJK Ext-B.
+	};
+	static const char32_t *const spaces[] = { U" ", U" ", U" ", U"  ", U"\t", U"\n", U"\u3000" };
+	xorshift32 rng;
+	std::u32string out;
+
+	while (out.size() < size)
+	{
+		out.append(pick(rng, words));
+		out.append(pick(rng, spaces));
+	}
+	return out;
+}
+
+//  Encoding conversion.
+
+template <typename CharT>
+struct encoder;
+
+template <>
+struct encoder<char>
+{
+	template <typename Char8T>
+	static void put(std::basic_string<Char8T> &out, const char32_t u32)
+	{
+		if (u32 < 0x80)
+		{
+			out.push_back(static_cast<Char8T>(u32));
+		}
+		else if (u32 < 0x800)
+		{
+			out.push_back(static_cast<Char8T>(((u32 >> 6) & 0x1f) | 0xc0));
+			out.push_back(static_cast<Char8T>((u32 & 0x3f) | 0x80));
+		}
+		else if (u32 < 0x10000)
+		{
+			out.push_back(static_cast<Char8T>(((u32 >> 12) & 0x0f) | 0xe0));
+			out.push_back(static_cast<Char8T>(((u32 >> 6) & 0x3f) | 0x80));
+			out.push_back(static_cast<Char8T>((u32 & 0x3f) | 0x80));
+		}
+		else
+		{
+			out.push_back(static_cast<Char8T>(((u32 >> 18) & 7) | 0xf0));
+			out.push_back(static_cast<Char8T>(((u32 >> 12) & 0x3f) | 0x80));
+			out.push_back(static_cast<Char8T>(((u32 >> 6) & 0x3f) | 0x80));
+			out.push_back(static_cast<Char8T>((u32 & 0x3f) | 0x80));
+		}
+	}
+};
+
+template <>
+struct encoder<char16_t>
+{
+	static void put(std::u16string &out, const char32_t u32)
+	{
+		if (u32 < 0x10000)
+		{
+			out.push_back(static_cast<char16_t>(u32));
+		}
+		else
+		{
+			out.push_back(static_cast<char16_t>(((u32 - 0x10000) >> 10) | 0xd800));
+			out.push_back(static_cast<char16_t>((u32 & 0x3ff) | 0xdc00));
+		}
+	}
+};
+
+template <>
+struct encoder<char32_t>
+{
+	static void put(std::u32string &out, const char32_t u32)
+	{
+		out.push_back(u32);
+	}
+};
+
+#if defined(__cpp_char8_t)
+template <>
+struct encoder<char8_t> : public encoder<char>
+{
+};
+#endif
+
+template <typename CharT>
+std::basic_string<CharT> to_utf(const char32_t *p)
+{
+	std::basic_string<CharT> out;
+
+	for (; *p; ++p)
+		encoder<CharT>::put(out, *p);
+	return out;
+}
+
+template <typename CharT>
+std::basic_string<CharT> to_utf(const std::u32string &s)
+{
+	return to_utf<CharT>(s.c_str());
+}
+
+//  Measurement.
+
+typedef std::chrono::steady_clock clock_type;
+
+double seconds_since(const clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+template <typename Iterator>
+struct line_counter
+{
+	std::size_t *count;
+
+	bool operator()(const srell::matched_line<Iterator> &) const
+	{
+		++*count;
+		return true;
+	}
+};
+
+template <typename RegexT, typename StringT>
+std::size_t run_once(const RegexT &re, const StringT &text, const StringT &format, const constants::operation_type operation)
+{
+	typedef typename StringT::const_iterator iterator;
+
+	switch (operation)
+	{
+	case constants::replace:
+		return srell::regex_replace(text, re, format).size();
+
+	case constants::split:
+		{
+			std::vector<srell::sub_match<iterator> > parts;
+
+			re.split(parts, text);
+			return parts.size();
+		}
+
+	case constants::lines:
+		{
+			std::size_t count = 0;
+			const line_counter<iterator> counter = { &count };
+
+			re.search_lines(text.begin(), text.end(), counter);
+			return count;
+		}
+
+	default:
+		{
+			typedef srell::regex_iterator<iterator, typename RegexT::value_type, typename RegexT::traits_type> regex_iterator;
+			std::size_t count = 0;
+
+			for (regex_iterator it(text.begin(), text.end(), re), end; it != end; ++it)
+				++count;
+
+			return count;
+		}
+	}
+}
+
+template <typename RegexT>
+void run_case(const benchcase &bc, const std::basic_string<typename RegexT::value_type> &text, const char *const type_name, const options &opts)
+{
+	typedef typename RegexT::value_type char_type;
+	typedef std::basic_string<char_type> string_type;
+
+	const string_type pattern(to_utf<char_type>(bc.pattern));
+	const string_type format(bc.format ? to_utf<char_type>(bc.format) : string_type());
+	const unsigned int compile_count = 1000;
+	RegexT re;
+
+	clock_type::time_point start = clock_type::now();
+
+	for (unsigned int i = 0; i < compile_count; ++i)
+		re.assign(pattern, bc.flags);
+
+	const double compile_us = seconds_since(start) * 1000000.0 / compile_count;
+	double fastest = 0.0;
+	std::size_t result = 0;
+
+	for (unsigned int i = 0; i < opts.repeats; ++i)
+	{
+		start = clock_type::now();
+		result = run_once(re, text, format, bc.operation);
+
+		const double elapsed = seconds_since(start);
+
+		if (i == 0 || elapsed < fastest)
+			fastest = elapsed;
+	}
+
+	const double megabytes = static_cast<double>(text.size() * sizeof (char_type)) / (1024.0 * 1024.0);
+
+	std::printf("%-20s %-9s %12.2f %10.1f %12lu\n", bc.name, type_name, compile_us, fastest > 0.0 ? megabytes / fastest : 0.0, static_cast<unsigned long>(result));
+}
+
+template <typename RegexT>
+void run_cases(const std::u32string (&corpora)[constants::num_of_corpora], const char *const type_name, const options &opts)
+{
+	typedef typename RegexT::value_type char_type;
+	std::basic_string<char_type> texts[constants::num_of_corpora];
+
+	for (int i = 0; i < constants::num_of_corpora; ++i)
+		texts[i] = to_utf<char_type>(corpora[i]);
+
+	for (const benchcase *bc = cases; bc->name; ++bc)
+	{
+		if (opts.filter && std::strstr(bc->name, opts.filter) == NULL)
+			continue;
+
+		run_case<RegexT>(*bc, texts[bc->corpus], type_name, opts);
+	}
+}
+
+int main(const int argc, const char *const argv[])
+{
+	const options opts(argc, argv);
+
+	if (opts.errorno)
+		return opts.errorno;
+
+	if (opts.cpu >= 0)
+	{
+#if defined(__linux__)
+		cpu_set_t cpuset;
+
+		CPU_ZERO(&cpuset);
+		CPU_SET(opts.cpu, &cpuset);
+		if (sched_setaffinity(0, sizeof (cpuset), &cpuset) != 0)
+			std::fprintf(stderr, "[Warning] Could not pin to CPU %d.\n", opts.cpu);
+#else
+		std::fputs("[Warning] -c is supported only on Linux. Ignored.\n", stderr);
+#endif
+	}
+
+	const std::u32string corpora[constants::num_of_corpora] =
+	{
+		make_log(opts.size),
+		make_html(opts.size),
+		make_multilingual(opts.size)
+	};
+
+	std::printf("Corpus size: %lu code points each. Best of %u runs.\n\n", static_cast<unsigned long>(opts.size), opts.repeats);
+	std::printf("%-20s %-9s %12s %10s %12s\n", "case", "type", "compile(us)", "MB/s", "result");
+
+	run_cases<srell::u8cregex>(corpora, "char", opts);
+#if defined(__cpp_char8_t)
+	run_cases<srell::u8regex>(corpora, "char8_t", opts);
+#else
+	std::fputs("[Info] char8_t is not supported by the compiler. Skipped.\n", stdout);
+#endif
+	run_cases<srell::u16regex>(corpora, "char16_t", opts);
+	run_cases<srell::u32regex>(corpora, "char32_t", opts);
+
+	return 0;
+}
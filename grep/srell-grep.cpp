@@ -0,0 +1,191 @@
+//
+//  srell-grep.cpp: version 1.000 (2026/10/18).
+//
+//  This is a small grep-like program that prints the lines of files that
+//  match a regular expression, as an example of basic_regex::search_lines().
+//  Files are read into memory and treated as UTF-8.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../srell.hpp"
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(disable:4996)
+#endif
+
+namespace srellgrep
+{
+
+bool read_file(std::string &str, const char *const filename)
+{
+	FILE *const fp = filename ? std::fopen(filename, "rb") : stdin;
+
+	if (fp)
+	{
+		static const std::size_t bufsize = 65536;
+		char buffer[bufsize];
+
+		for (;;)
+		{
+			const std::size_t size = std::fread(buffer, 1, bufsize, fp);
+
+			if (!size)
+				break;
+
+			str.append(buffer, size);
+		}
+		if (fp != stdin)
+			std::fclose(fp);
+		return true;
+	}
+	std::fprintf(stderr, "[Error] Could not open '%s'.\n", filename);
+	return false;
+}
+
+struct grep_options
+{
+	const char *pattern;
+	std::vector<const char *> filenames;
+	srell::regex_constants::syntax_option_type syntax;
+	bool count_only;
+	bool show_lineno;
+	bool show_offset;
+	int errorno;
+
+	grep_options(const int argc, const char *const *const argv)
+		: pattern(NULL)
+		, syntax(srell::regex_constants::ECMAScript)
+		, count_only(false)
+		, show_lineno(false)
+		, show_offset(false)
+		, errorno(0)
+	{
+		for (int index = 1; index < argc; ++index)
+		{
+			const char *const arg = argv[index];
+
+			if (arg[0] == '-' && arg[1] != '\0' && !pattern)
+			{
+				for (const char *option = arg + 1; *option; ++option)
+				{
+					if (*option == 'i')
+						syntax |= srell::regex_constants::icase;
+					else if (*option == 's')
+						syntax |= srell::regex_constants::dotall;
+					else if (*option == 'c')
+						count_only = true;
+					else if (*option == 'n')
+						show_lineno = true;
+					else if (*option == 'b')
+						show_offset = true;
+					else
+					{
+						std::fprintf(stderr, "[Error] Unknown option \"-%c\" found.\n", *option);
+						goto PRINT_USAGE;
+					}
+				}
+			}
+			else if (!pattern)
+				pattern = arg;
+			else
+				filenames.push_back(arg);
+		}
+
+		if (pattern)
+			return;
+
+		PRINT_USAGE:
+		std::fputs("Usage: srell-grep [options] pattern [file...]\n", stderr);
+		std::fputs("    -i  ignore case\n", stderr);
+		std::fputs("    -s  dotall\n", stderr);
+		std::fputs("    -c  print only the number of matching lines\n", stderr);
+		std::fputs("    -n  print the line number of each line\n", stderr);
+		std::fputs("    -b  print the byte offset of each line\n", stderr);
+		errorno = 2;
+	}
+};
+//  grep_options
+
+struct line_printer
+{
+	const grep_options *opts;
+	const char *filename;
+	std::size_t *matched;	//  The callback is passed by value.
+
+	bool operator()(const srell::matched_line<const char *> &line) const
+	{
+		++*matched;
+
+		if (!opts->count_only)
+		{
+			const srell::csub_match l = line.line();
+
+			if (filename)
+				std::printf("%s:", filename);
+			if (opts->show_lineno)
+				std::printf("%lu:", static_cast<unsigned long>(line.lineno()));
+			if (opts->show_offset)
+				std::printf("%lu:", static_cast<unsigned long>(line.position()));
+			std::fwrite(l.first, 1, static_cast<std::size_t>(l.second - l.first), stdout);
+			std::putchar('\n');
+		}
+		return true;
+	}
+};
+
+int grep(const grep_options &opts)
+{
+	srell::u8cregex re;
+	const std::size_t numfiles = opts.filenames.size();
+	bool found = false;
+
+	re.assign(opts.pattern, opts.syntax);
+
+	for (std::size_t i = 0; i < (numfiles ? numfiles : 1); ++i)
+	{
+		const char *const filename = numfiles ? opts.filenames[i] : NULL;
+		std::string text;
+		std::size_t matched = 0;
+		const line_printer printer = { &opts, numfiles > 1 ? filename : NULL, &matched };
+
+		if (!read_file(text, filename))
+			return 2;
+
+		const char *const begin = text.data();
+
+		re.search_lines(begin, begin + text.size(), printer);
+
+		if (opts.count_only)
+		{
+			if (printer.filename)
+				std::printf("%s:", printer.filename);
+			std::printf("%lu\n", static_cast<unsigned long>(matched));
+		}
+		if (matched)
+			found = true;
+	}
+	return found ? 0 : 1;
+}
+
+}	//  namespace srellgrep
+
+int main(const int argc, const char *const *const argv)
+{
+	srellgrep::grep_options opts(argc, argv);
+
+	if (opts.errorno)
+		return opts.errorno;
+
+	try
+	{
+		return srellgrep::grep(opts);
+	}
+	catch (const srell::regex_error &e)
+	{
+		std::fprintf(stderr, "[Error] regex_error %d.\n", e.code());
+	}
+	return 2;
+}
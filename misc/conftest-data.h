@@ -275,6 +275,14 @@ testdata tests[] = {
 	0, 0,
 	STR0("")
 },
+{
+	0, "regex_match 04: Lookahead entered with nothing pushed.\n",
+	"M",
+	RE("(?=b)bd"),
+	STR("bd"),
+	0, 1,
+	STR0("bd")
+},
 {
 	0, "match_continous 01.\n",
 	"y",
@@ -550,6 +558,195 @@ testdata tests[] = {
 	STR("0123abcd"),
 	4, 0,
 	STR0("")
+},
+	//  Search plans.
+{
+	0, "Search plan 01: ^ without multiline.\n",
+	"",
+	RE("^\\d+"),
+	STR("a1\n23"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Search plan 02: ^ with multiline.\n",
+	"m",
+	RE("^\\d+"),
+	STR("a1\n\n23"),
+	0, 1,
+	STR0("23")
+},
+{
+	0, "Search plan 03: ^ after the beginning.\n",
+	"3",
+	RE("^\\d+"),
+	STR("0123abcd"),
+	2, 0,
+	STR0("")
+},
+{
+	0, "Search plan 04: $ and the maximum length.\n",
+	"",
+	RE("\\d{1,2}$|x$"),
+	STR("12\n345"),
+	0, 1,
+	STR0("45")
+},
+{
+	0, "Search plan 05: Shorter than the minimum.\n",
+	"",
+	RE("\\w{3}"),
+	STR("ab cd"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Search plan 06: $ in only one of the branches of a character switch.\n",
+	"",
+	RE("ab|cd|ef|g$"),
+	STR("ab-"),
+	0, 1,
+	STR0("ab")
+},
+{
+	0, "Search plan 07: Leading .* tried once per line.\n",
+	"",
+	RE(".*foo(\\d+)"),
+	STR("xfoo\nabfoo12foo3"),
+	0, 2,
+	STR0("abfoo12foo3")
+	STR0("3")
+},
+{
+	0, "Search plan 08: Leading .*? and line terminators.\n",
+	"G",
+	RE(".*?="),
+	STR("a\nb=c=d\r\n="),
+	0, 3,
+	STR0("b=")
+	STR0("c=")
+	STR0("=")
+},
+{
+	0, "Search plan 09: Leading .* with dotall.\n",
+	"s",
+	RE(".*\\d"),
+	STR("a1\nb2\nc"),
+	0, 1,
+	STR0("a1\nb2")
+},
+{
+	0, "Search plan 10: Leading .+.\n",
+	"",
+	RE(".+x"),
+	STR("ab\rx\\u2028cdx"),
+	0, 1,
+	STR0("cdx")
+},
+{
+	0, "Search plan 11: Leading .* and a match across lines.\n",
+	"",
+	RE(".*a\\nb"),
+	STR("a\nxa\nb"),
+	0, 1,
+	STR0("xa\nb")
+},
+{
+	0, "Required characters 01: A subject without @ cannot match.\n",
+	"",
+	RE("user=(\\w+)@corp"),
+	STR("user=alice at corp, user=bob"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Required characters 02: A unit in every branch of an alternation.\n",
+	"",
+	RE("(?:ab|cb)d"),
+	STR("abcbd"),
+	0, 1,
+	STR0("cbd")
+},
+{
+	0, "Required characters 03: Case-insensitive; only the caseless unit is required.\n",
+	"i",
+	RE("user=(\\w+)@corp"),
+	STR("USER=Bob@CORP"),
+	0, 2,
+	STR0("USER=Bob@CORP")
+	STR0("Bob")
+},
+{
+	0, "Rare unit 01: A literal found by its rarest code unit.\n",
+	"",
+	RE("eat@home"),
+	STR("eat eat@hom eat@home"),
+	0, 1,
+	STR0("eat@home")
+},
+{
+	0, "Rare unit 02: The rarest code unit appears too often.\n",
+	"",
+	RE("q@q"),
+	STR("@@@@@@@@@@@@@@@@q@q"),
+	0, 1,
+	STR0("q@q")
+},
+{
+	0, "Rare unit 03: Entry point in the middle of a sequence.\n",
+	"",
+	RE("\\w+a-b"),
+	STR("xa-c ya-b"),
+	0, 1,
+	STR0("ya-b")
+},
+{
+	0, "Rare unit 04: Entry point after a variable length atom.\n",
+	"",
+	RE("\\w+ing-ring"),
+	STR("singing-ring"),
+	0, 1,
+	STR0("singing-ring")
+},
+{
+	0, "Rare unit 05: Lazy optional sequence before the entry point.\n",
+	"",
+	RE("a{0,3}?abc{0,5}?"),
+	STR("ab"),
+	0, 1,
+	STR0("ab")
+},
+{
+	0, "Rare unit 06: Lazy optional sequence before the entry point.\n",
+	"",
+	RE("a{0,3}?abc{0,5}?"),
+	STR("kkkkkkkkkkkkab"),
+	0, 1,
+	STR0("ab")
+},
+{
+	0, "Rare unit 07: Lazy and greedy optional sequences around the entry point.\n",
+	"",
+	RE("a{0,3}?abc{0,5}"),
+	STR("ab"),
+	0, 1,
+	STR0("ab")
+},
+{
+	0, "Rare unit 08: Lazy and greedy optional sequences around the entry point.\n",
+	"",
+	RE("a{0,3}?abc{0,5}"),
+	STR("kkkkkkkkkkkkab"),
+	0, 1,
+	STR0("ab")
+},
+{
+	0, "Rare unit 09: Lazy optional character before the entry point.\n",
+	"",
+	RE("a??ab"),
+	STR("kkaab"),
+	0, 1,
+	STR0("aab")
 },
 	//  Character class escapes.
 {
@@ -805,6 +1002,165 @@ testdata tests[] = {
 	0, 0,
 	STR0("")
 },
+	//  Atomic groups and possessive quantifiers.
+{
+	0, "Atomic 01.\n",
+	"a",
+	RE("(?>a+)b"),
+	STR("aaab"),
+	0, 1,
+	STR0("aaab")
+},
+{
+	0, "Atomic 02: Never gives back.\n",
+	"a",
+	RE("(?>a+)a"),
+	STR("aaa"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Atomic 03: In lookbehind.\n",
+	"a",
+	RE("(?<=(?>a+)b)c"),
+	STR("aabc"),
+	0, 1,
+	STR0("c")
+},
+{
+	0, "Atomic 04: regex_match.\n",
+	"aM",
+	RE("b(?>c?)d"),
+	STR("bd"),
+	0, 1,
+	STR0("bd")
+},
+{
+	0, "Possessive 01: Asterisk.\n",
+	"a",
+	RE("a*+a"),
+	STR("aaa"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Possessive 02: Plus.\n",
+	"a",
+	RE("a++b"),
+	STR("aab"),
+	0, 1,
+	STR0("aab")
+},
+{
+	0, "Possessive 03: Question.\n",
+	"a",
+	RE("a?+a"),
+	STR("a"),
+	0, 0,
+	STR0("")
+},
+{
+	0, "Possessive 04: Counter.\n",
+	"a",
+	RE("a{1,3}+a"),
+	STR("aaaa"),
+	0, 1,
+	STR0("aaaa")
+},
+{
+	0, "Possessive 05: Group.\n",
+	"a",
+	RE("(?:ab)*+a"),
+	STR("ababa"),
+	0, 1,
+	STR0("ababa")
+},
+#if !defined(SRELL_ENABLE_GT)
+{
+	0, "Possessive 06: Without the flag.\n",
+	"E",
+	RE("a*+"),
+	STR(""),
+	srell::regex_constants::error_badrepeat, 0,
+	STR0("")
+},
+{
+	0, "Atomic 05: Without the flag.\n",
+	"E",
+	RE("(?>a)"),
+	STR(""),
+	srell::regex_constants::error_paren, 0,
+	STR0("")
+},
+#else
+{
+	0, "Possessive 06: Without the flag, enabled by SRELL_ENABLE_GT.\n",
+	"",
+	RE("a*+"),
+	STR("aab"),
+	0, 1,
+	STR0("aa")
+},
+{
+	0, "Atomic 05: Without the flag, enabled by SRELL_ENABLE_GT.\n",
+	"",
+	RE("(?>a+)b"),
+	STR("aab"),
+	0, 1,
+	STR0("aab")
+},
+#endif	//  !defined(SRELL_ENABLE_GT)
+	//  regex_constants::noredos.
+{
+	0, "Noredos 01: Group without alternatives.\n",
+	"r",
+	RE("(?:ab)*c"),
+	STR("xababc"),
+	0, 1,
+	STR0("ababc")
+},
+{
+	0, "Noredos 02: Alternatives beginning with different characters.\n",
+	"r",
+	RE("(?:cat|dog)*x"),
+	STR("catdogcatx"),
+	0, 1,
+	STR0("catdogcatx")
+},
+{
+	0, "Noredos 03: Nested loop that cannot stop at what it consumes.\n",
+	"r",
+	RE("(?:\\d+,)*\\d+"),
+	STR("1,22,333"),
+	0, 1,
+	STR0("1,22,333")
+},
+#if !defined(SRELL_NO_RISKCHECK)
+{
+	0, "Noredos 04: Nested loops.\n",
+	"Er",
+	RE("(a+)+b"),
+	STR(""),
+	srell::regex_constants::error_complexity, 0,
+	STR0("")
+},
+{
+	0, "Noredos 05: Nested loops in a non-capturing group.\n",
+	"Er",
+	RE("(?:a+)+b"),
+	STR(""),
+	srell::regex_constants::error_complexity, 0,
+	STR0("")
+},
+{
+	0, "Noredos 06: Alternatives beginning with the same character.\n",
+	"Er",
+	RE("(a|a)*b"),
+	STR(""),
+	srell::regex_constants::error_complexity, 0,
+	STR0("")
+},
+#endif	//  !defined(SRELL_NO_RISKCHECK)
 	//  Optimisations' side effect check.
 	//  gather_nextchars().
 {
@@ -944,6 +1300,64 @@ testdata tests[] = {
 	STR("aab"),
 	0, 1,
 	STR0("aab")
+},
+	//  group_asterisk_optimisation().
+{
+	0, "OSEC, GES 01: Exclusive exit.\n",
+	"",
+	RE("(?:ab)*c"),
+	STR("ababc"),
+	0, 1,
+	STR0("ababc")
+},
+{
+	0, "OSEC, GES 02: Jump into the loop.\n",
+	"",
+	RE("(?:ab)+c"),
+	STR("cababc"),
+	0, 1,
+	STR0("ababc")
+},
+{
+	0, "OSEC, GES 03: Non-greedy.\n",
+	"",
+	RE("(?:ab)*?c"),
+	STR("abac"),
+	0, 1,
+	STR0("c")
+},
+{
+	0, "OSEC, GES 04: Backtracking into the previous round.\n",
+	"",
+	RE("(?:ab|a)*bc"),
+	STR("abc"),
+	0, 1,
+	STR0("abc")
+},
+	//  repeat_atom_optimisation(), bounded repeat.
+{
+	0, "OSEC, BR 01: Giving back down to the minimum.\n",
+	"",
+	RE("a{3,70}ab"),
+	STR("aaab aaaaab"),
+	0, 1,
+	STR0("aaaaab")
+},
+{
+	0, "OSEC, BR 02: Exact count.\n",
+	"",
+	RE("x[0-9a-f]{8}\\b"),
+	STR("x0123abcde x0123abcd"),
+	0, 1,
+	STR0("x0123abcd")
+},
+{
+	0, "OSEC, BR 03: In lookbehind.\n",
+	"",
+	RE("(?<=x[a-f]{3,20})y"),
+	STR("xaby zxabcdefy"),
+	0, 1,
+	STR0("y")
 },
 	//  is_exclusive_sequence(), splitting char class.
 {
@@ -2510,6 +2924,308 @@ testdata tests[] = {
 	STR0("a")
 	STR0("b")
 	STR0("(undefined)")
+},
+	//  Cases added later are appended here, so that the indices in
+	//  conftest-metrics.txt stay the same.
+	//  find_better_ep().
+{
+	0, "Backref 07: Not rewinding a captured loop.\n",
+	"",
+	RE("(\\w+) \\1"),
+	STR("lf frn"),
+	0, 2,
+	STR0("f f")
+	STR0("f")
+},
+	//  set_bitset_table(), single character search.
+{
+	0, "Non-BMP 01: Single character search for a character above U+FFFF.\n",
+	"",
+	RE("\\u{1F600}\\d"),
+	STR("a\\u{1F600}x\\u{1F600}1"),
+	0, 1,
+	STR0("\\u{1F600}1")
+},
+	//  string_optimisation().
+{
+	0, "OSEC, STR 01: Icase.\n",
+	"i",
+	RE("(\\u03C3)\\u03C3b"),
+	STR("\\u03C3\\u03A3x \\u03A3\\u03C2B"),
+	0, 2,
+	STR0("\\u03A3\\u03C2B")
+	STR0("\\u03A3")
+},
+{
+	0, "OSEC, STR 02: Icase, non-BMP.\n",
+	"i",
+	RE("(\\u{10400})\\u{10401}ab"),
+	STR("\\u{10428}\\u{10429}Ax \\u{10428}\\u{10401}AB"),
+	0, 2,
+	STR0("\\u{10428}\\u{10401}AB")
+	STR0("\\u{10428}")
+},
+{
+	0, "OSEC, STR 03: In lookbehind.\n",
+	"",
+	RE("(?<=(\\w)abc)d"),
+	STR("abcd zxabd yabcd"),
+	0, 2,
+	STR0("d")
+	STR0("y")
+},
+{
+	0, "OSEC, STR 04: Icase in lookbehind, non-BMP.\n",
+	"i",
+	RE("(?<=(.)\\u{10400}k)x"),
+	STR("a\\u{10400}zx -\\u{10428}\\u212AX"),
+	0, 2,
+	STR0("X")
+	STR0("-")
+},
+{
+	0, "OSEC, STR 05: Non-BMP.\n",
+	"",
+	RE("(\\u{1F600})x\\u{1F601}"),
+	STR("\\u{1F600}x\\u{1F600} \\u{1F600}x\\u{1F601}"),
+	0, 2,
+	STR0("\\u{1F600}x\\u{1F601}")
+	STR0("\\u{1F600}")
+},
+{
+	0, "OSEC, STR 06: Lone surrogate between strings.\n",
+	"",
+	RE("(a)bc\\uD83Dde"),
+	STR("abc\\u{1F600}de abc\\uD83Dde"),
+	0, 2,
+	STR0("abc\\uD83Dde")
+	STR0("a")
+},
+{
+	0, "OSEC, STR 07: Subject shorter than the string.\n",
+	"",
+	RE("abcd|(?<=abcd)e"),
+	STR("xabc bcde"),
+	0, 0,
+	STR0("")
+},
+	//  repeat_atom_optimisation().
+{
+	0, "OSEC, RA 01: Icase character, giving back.\n",
+	"i",
+	RE("(\\u212A*)kb"),
+	STR("xkK\\u212Akkb"),
+	0, 2,
+	STR0("kK\\u212Akkb")
+	STR0("kK\\u212Ak")
+},
+{
+	0, "OSEC, RA 02: Complement of an ASCII character over non-BMP characters.\n",
+	"",
+	RE("([^;]*);"),
+	STR("a\\u{1F600}b\\u{1F601};"),
+	0, 2,
+	STR0("a\\u{1F600}b\\u{1F601};")
+	STR0("a\\u{1F600}b\\u{1F601}")
+},
+{
+	0, "OSEC, RA 03: Giving back non-BMP characters.\n",
+	"",
+	RE("(.*)(.);"),
+	STR("a\\u{1F600}b\\u{1F601};"),
+	0, 3,
+	STR0("a\\u{1F600}b\\u{1F601};")
+	STR0("a\\u{1F600}b")
+	STR0("\\u{1F601}")
+},
+{
+	0, "OSEC, RA 04: Non-BMP class.\n",
+	"",
+	RE("([\\u{1F600}-\\u{1F64F}a]*)\\u{1F601}x"),
+	STR("a\\u{1F600}\\u{1F601}\\u{1F601}x"),
+	0, 2,
+	STR0("a\\u{1F600}\\u{1F601}\\u{1F601}x")
+	STR0("a\\u{1F600}\\u{1F601}")
+},
+{
+	0, "OSEC, RA 05: Icase class with a non-BMP range.\n",
+	"i",
+	RE("([b-k\\u{10428}]*)kz"),
+	STR("B\\u{10400}\\u212AKkz"),
+	0, 2,
+	STR0("B\\u{10400}\\u212AKkz")
+	STR0("B\\u{10400}\\u212AK")
+},
+{
+	0, "OSEC, RA 06: In lookbehind, giving back non-BMP characters.\n",
+	"",
+	RE("(?<=;(.)(.*))c"),
+	STR(";\\u{1F600}\\u{10400}xc"),
+	0, 3,
+	STR0("c")
+	STR0("\\u{1F600}")
+	STR0("\\u{10400}x")
+},
+{
+	0, "OSEC, RA 07: Icase in lookbehind.\n",
+	"i",
+	RE("(?<=K(k*)k)c"),
+	STR("\\u212Akk\\u212Akc"),
+	0, 2,
+	STR0("c")
+	STR0("kk\\u212A")
+},
+{
+	0, "OSEC, RA 08: Bounded, non-BMP.\n",
+	"",
+	RE("(\\u{1F600}{2,4})\\u{1F600}x"),
+	STR("\\u{1F600}\\u{1F600}\\u{1F600}\\u{1F600}\\u{1F600}x"),
+	0, 2,
+	STR0("\\u{1F600}\\u{1F600}\\u{1F600}\\u{1F600}\\u{1F600}x")
+	STR0("\\u{1F600}\\u{1F600}\\u{1F600}\\u{1F600}")
+},
+	//  re_character_class::charclasspos(), class layouts.
+{
+	0, "OSEC, CCL 01: Bitmap, icase.\n",
+	"i",
+	RE("[a-cx-z]+"),
+	STR("\\u0161\\u{1F661}dWAbZx\\u00C1"),
+	0, 1,
+	STR0("AbZx")
+},
+{
+	0, "OSEC, CCL 02: Bitmap in lookbehind.\n",
+	"",
+	RE("(?<=([a-c\\u00E0-\\u00E5]+))1"),
+	STR("d\\u00E4b\\u0161\\u00E1a1"),
+	0, 2,
+	STR0("1")
+	STR0("\\u00E1a")
+},
+{
+	0, "OSEC, CCL 03: One range, non-BMP.\n",
+	"",
+	RE("[\\u{1F600}-\\u{1F64F}]+"),
+	STR("\\u{1F5FF}\\u{1F600}\\u{1F64F}\\u{1F650}"),
+	0, 1,
+	STR0("\\u{1F600}\\u{1F64F}")
+},
+{
+	0, "OSEC, CCL 04: Two ranges, non-BMP.\n",
+	"",
+	RE("[a\\u{1F600}]+"),
+	STR("b\\u{1F600}a\\u{1F601}"),
+	0, 1,
+	STR0("\\u{1F600}a")
+},
+{
+	0, "OSEC, CCL 05: Four ranges made by icase, non-BMP.\n",
+	"i",
+	RE("[\\u0400-\\u040F\\u{10400}-\\u{10401}]+"),
+	STR("\\u0410\\u0450\\u0400\\u{10429}\\u{10401}\\u{10402}"),
+	0, 1,
+	STR0("\\u0450\\u0400\\u{10429}\\u{10401}")
+},
+{
+	0, "OSEC, CCL 06: Six ranges padded to eight, in lookbehind.\n",
+	"",
+	RE("(?<=([ace\\u0100\\u0102\\u{10400}]+))x"),
+	STR("b\\u0101e\\u{10400}\\u0102ax"),
+	0, 2,
+	STR0("x")
+	STR0("e\\u{10400}\\u0102a")
+},
+{
+	0, "OSEC, CCL 07: Eytzinger layout, icase.\n",
+	"i",
+	RE("[acegikmoqsu\\u0100]+"),
+	STR("bK\\u212AQ\\u0101\\u0102"),
+	0, 1,
+	STR0("K\\u212AQ\\u0101")
+},
+{
+	0, "OSEC, CCL 08: Eytzinger layout in lookbehind, non-BMP.\n",
+	"",
+	RE("(?<=([acegikmoqsu\\u{1F600}\\u{1F602}]+))x"),
+	STR("b\\u{1F601}\\u{1F602}u\\u{1F600}kx"),
+	0, 2,
+	STR0("x")
+	STR0("\\u{1F602}u\\u{1F600}k")
+},
+	//  character_switch_optimisation().
+{
+	0, "OSEC, CSW 01: Icase.\n",
+	"i",
+	RE("(?:kb|sc|\\u00E0d|\\u{10400}e)+"),
+	STR("\\u017FC\\u212Ab\\u00C0D\\u{10428}Ex"),
+	0, 1,
+	STR0("\\u017FC\\u212Ab\\u00C0D\\u{10428}E")
+},
+{
+	0, "OSEC, CSW 02: In lookbehind, non-BMP.\n",
+	"",
+	RE("(?<=(ab|cd|ef|gh|i\\u{1F600}))x"),
+	STR("zbx i\\u{1F600}x"),
+	0, 2,
+	STR0("x")
+	STR0("i\\u{1F600}")
+},
+{
+	0, "OSEC, CSW 03: Non-BMP.\n",
+	"",
+	RE("\\u{1F600}a|\\u{1F601}b|\\u{1F602}c|\\u{1F603}d|\\u00E9e"),
+	STR("\\u{1F601}a\\u{1F603}d"),
+	0, 1,
+	STR0("\\u{1F603}d")
+},
+{
+	0, "OSEC, CSW 04: Fallthrough.\n",
+	"",
+	RE("(?:ab|cd|ef|gh|\\d)z"),
+	STR("ab 7z"),
+	0, 1,
+	STR0("7z")
+},
+{
+	0, "OSEC, CSW 05: Fallthrough in lookbehind, icase.\n",
+	"i",
+	RE("(?<=(?:ab|cd|ef|gh|\\d))x"),
+	STR("zBx 1X"),
+	0, 1,
+	STR0("X")
+},
+{
+	0, "OSEC, CSW 06: Fallthrough with a non-BMP character given back.\n",
+	"",
+	RE("(?:ab|cd|ef|gh|[\\u{1F600}-\\u{1F64F}])b"),
+	STR("a\\u{1F601}b"),
+	0, 1,
+	STR0("\\u{1F601}b")
+},
+	//  check_eol_anchoring().
+{
+	0, "EOL anchoring 01: Switch leading to the success.\n",
+	"",
+	RE("a|b|c|d|e"),
+	STR("bxxxxxxxxd"),
+	0, 1,
+	STR0("b")
+},
+{
+	0, "EOL anchoring 02: Switch after a character.\n",
+	"",
+	RE("x(?:a|b|c|d)"),
+	STR("xa -------- xb"),
+	0, 1,
+	STR0("xa")
+},
+{
+	0, "EOL anchoring 03: Switch followed by $.\n",
+	"",
+	RE("(?:a|b|c|d)$"),
+	STR("ab -------- xb"),
+	0, 1,
+	STR0("b")
 },
 {
 	1, NULL,
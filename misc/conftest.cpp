@@ -1,6 +1,6 @@
 
 //  Conformance test program for SRELL.
-//  Version 3.000 (2024/01/14)
+//  Version 3.001 (2026/10/18)
 
 #include <cstdio>
 #include <cstring>
@@ -410,6 +410,14 @@ std::string parse_flagstring(
 			str.push_back(*flags);
 			break;
 #endif
+		case 'a':
+			so |= srell::regex_constants::atomic;
+			str.push_back(*flags);
+			break;
+		case 'r':
+			so |= srell::regex_constants::noredos;
+			str.push_back(*flags);
+			break;
 		case 'y':
 			mf |= srell::regex_constants::match_continuous;
 			str.push_back(*flags);
@@ -463,6 +471,56 @@ const char* get_errmsg(const srell::regex_constants::error_type e)
 	return "error_internal";
 }
 
+#if defined(SRELL_ENABLE_STATS) && !defined(SRELL_NO_LIMIT_COUNTER)
+#define STEP_METRICS
+
+//  Work done by each test. Unlike time these counts do not depend on the
+//  machine, so a change in them shows that the behaviour of the compiler
+//  or of the automaton has changed.
+struct step_metrics
+{
+	enum
+	{
+		states, steps, backtracks, automaton_runs, firstchar_skips, bmh_skips, max_btstack_depth, lookarounds, num_of_metrics
+	};
+
+	unsigned long values[num_of_metrics];
+
+	void clear()
+	{
+		for (int i = 0; i < num_of_metrics; ++i)
+			values[i] = 0;
+	}
+
+	template <typename MatchResults>
+	void add(const MatchResults &mr)
+	{
+		const srell::search_statistics &st = mr.stats();
+
+		values[steps] += static_cast<unsigned long>(mr.steps_consumed());
+		values[backtracks] += static_cast<unsigned long>(st.backtracks);
+		values[automaton_runs] += static_cast<unsigned long>(st.automaton_runs);
+		values[firstchar_skips] += static_cast<unsigned long>(st.firstchar_skips);
+		values[bmh_skips] += static_cast<unsigned long>(st.bmh_skips);
+		if (values[max_btstack_depth] < st.max_btstack_depth)
+			values[max_btstack_depth] = static_cast<unsigned long>(st.max_btstack_depth);
+		values[lookarounds] += static_cast<unsigned long>(st.lookarounds);
+	}
+
+	static const char *name(const int i)
+	{
+		static const char *names[] = {
+			"states", "steps", "backtracks", "automaton_runs", "firstchar_skips", "bmh_skips", "max_btstack_depth", "lookarounds"
+		};
+		return names[i];
+	}
+};
+//  struct step_metrics
+
+step_metrics metrics;
+
+#endif	//  defined(SRELL_ENABLE_STATS) && !defined(SRELL_NO_LIMIT_COUNTER)
+
 template <typename RegexType, typename CharT, typename UtfTag>
 bool conf_test(
 	const char_type *str1,
@@ -518,10 +576,18 @@ bool conf_test(
 		tried[comb] = true;
 #endif
 
+#if defined(STEP_METRICS)
+	metrics.clear();
+#endif
+
 	try
 	{
 		re.assign(exp, so);
 
+#if defined(STEP_METRICS)
+		metrics.values[step_metrics::states] = static_cast<unsigned long>(re.state_count());
+#endif
+
 		if (errortest)	//  Reaching here means that an exception has not been thrown.
 			return false;
 
@@ -539,6 +605,9 @@ bool conf_test(
 		{
 			b = srell::regex_match(begin, end, mr, re, mf);
 		}
+#if defined(STEP_METRICS)
+		metrics.add(mr);
+#endif
 
 		std::fprintf(stdout, "\t/%s/%s.%sch(\"%s\");", expfc.c_str(), flagstr2.c_str(), search ? "sear" : "mat", strfc.c_str());
 
@@ -603,6 +672,9 @@ bool conf_test(
 				const CharT *const begin2 = mr[0].second;
 
 				b = srell::regex_search(begin2, end, lblimit, mr, re, mf);
+#if defined(STEP_METRICS)
+				metrics.add(mr);
+#endif
 			}
 			else
 				break;
@@ -691,10 +763,18 @@ struct options
 {
 	constants::utf_type utype;
 	int errorno;
+#if defined(STEP_METRICS)
+	const char *metrics_file;
+	bool write_metrics;
+#endif
 
 	options(const int argc, const char *const *const argv)
 		: utype(constants::unknown)
 		, errorno(0)
+#if defined(STEP_METRICS)
+		, metrics_file(NULL)
+		, write_metrics(false)
+#endif
 	{
 		if (argc >= 2)
 		{
@@ -741,6 +821,18 @@ struct options
 			else
 				goto UNKNOWN_TYPE;
 
+#if defined(STEP_METRICS)
+			if (argc >= 4 && (std::strcmp(argv[2], "-w") == 0 || std::strcmp(argv[2], "-c") == 0))
+			{
+				metrics_file = argv[3];
+				write_metrics = argv[2][1] == 'w';
+			}
+			else if (argc >= 3)
+			{
+				errorno = 2;
+				goto PRINT_USAGE;
+			}
+#endif
 			return;
 		}
 
@@ -757,6 +849,11 @@ struct options
 #endif
 #if defined(SRELL_HAS_UTF32W)
 		std::fputs("    utf32w  u1632wregex (UTF-32 with wchar_t)\n", stdout);
+#endif
+#if defined(STEP_METRICS)
+		std::fputs("Options (after testtype):\n", stdout);
+		std::fputs("    -w file  write the step metrics of each test to file\n", stdout);
+		std::fputs("    -c file  compare the step metrics with the baseline in file\n", stdout);
 #endif
 		return;
 
@@ -768,6 +865,781 @@ struct options
 };
 //  struct options
 
+#if defined(STEP_METRICS)
+
+struct baseline_entry
+{
+	bool present;
+	step_metrics m;
+
+	baseline_entry() : present(false)
+	{
+		m.clear();
+	}
+};
+
+//  Line format: index, the values in the order of step_metrics, and title,
+//  separated by tabs. Lines beginning with '#' are comments.
+bool read_metrics(std::vector<baseline_entry> &baseline, int &utype, const char *const filename)
+{
+	std::FILE *const fp = std::fopen(filename, "r");
+	char line[4096];
+
+	if (fp == NULL)
+		return false;
+
+	while (std::fgets(line, sizeof (line), fp))
+	{
+		const char *p = line;
+		unsigned int index = 0;
+		int len = 0;
+		baseline_entry e;
+
+		if (line[0] == '#')
+		{
+			std::sscanf(line, "# TestType: %d", &utype);
+			continue;
+		}
+
+		if (std::sscanf(p, "%u%n", &index, &len) != 1)
+			continue;
+
+		p += len;
+		for (int i = 0; i < step_metrics::num_of_metrics; ++i, p += len)
+			if (std::sscanf(p, "%lu%n", &e.m.values[i], &len) != 1)
+				goto NEXT_LINE;
+
+		e.present = true;
+		if (baseline.size() <= index)
+			baseline.resize(index + 1);
+		baseline[index] = e;
+
+		NEXT_LINE:;
+	}
+	std::fclose(fp);
+	return true;
+}
+
+void write_metrics(std::FILE *const fp, const unsigned int index, const char *const title)
+{
+	std::size_t len = std::strlen(title);
+
+	if (len && title[len - 1] == '\n')
+		--len;
+
+	std::fprintf(fp, "%u", index);
+	for (int i = 0; i < step_metrics::num_of_metrics; ++i)
+		std::fprintf(fp, "\t%lu", metrics.values[i]);
+	std::fprintf(fp, "\t%.*s\n", static_cast<int>(len), title);
+}
+
+bool compare_metrics(const std::vector<baseline_entry> &baseline, const unsigned int index)
+{
+	if (index >= baseline.size() || !baseline[index].present)
+	{
+		std::fprintf(stdout, "[Metrics] #%u: not in the baseline.\n\n", index);
+		return false;
+	}
+
+	const step_metrics &m = baseline[index].m;
+	bool same = true;
+
+	for (int i = 0; i < step_metrics::num_of_metrics; ++i)
+	{
+		if (m.values[i] != metrics.values[i])
+		{
+			std::fprintf(stdout, "[Metrics] #%u: %s %lu -> %lu\n", index, step_metrics::name(i), m.values[i], metrics.values[i]);
+			same = false;
+		}
+	}
+	if (!same)
+		std::fputs("\n", stdout);
+	return same;
+}
+
+#endif	//  defined(STEP_METRICS)
+
+//  Tests of the API extensions, which the table in conftest-data.h cannot
+//  express. They do not depend on the test type.
+
+namespace apitest
+{
+
+bool result(const unsigned int num_of_failures)
+{
+	std::fprintf(stdout, "Result: %s.\n\n", num_of_failures ? "Failed" : "OK");
+	return num_of_failures == 0;
+}
+
+//  Compares a value with the expected one, reporting it with name.
+bool expect(unsigned int &num_of_failures, const char *const name, const long value, const long expected)
+{
+	std::fprintf(stdout, "\t%s = %ld; %s\n", name, value, value == expected ? "OK." : "failed...");
+	if (value == expected)
+		return true;
+	std::fprintf(stdout, "\t  (expected: %ld)\n", expected);
+	++num_of_failures;
+	return false;
+}
+
+//  Calls a search function object, turning the exception thrown for an error
+//  into its code so that the tests work in both modes.
+template <typename Search>
+srell::regex_constants::error_type catch_error(const Search &search)
+{
+	try
+	{
+		return search();
+	}
+	catch (const srell::regex_error &e)
+	{
+		return e.code();
+	}
+}
+
+#if !defined(SRELL_NO_RISKCHECK)
+
+bool backtracking_risk()
+{
+	static const struct
+	{
+		const char *re;
+		srell::regex_constants::risk_type risk;
+	} cases[] =
+	{
+		{ "(ab)*c", srell::regex_constants::risk_none },
+		{ "(?:ab)*c", srell::regex_constants::risk_none },
+		{ "(?:a|b)*c", srell::regex_constants::risk_none },
+		{ "(?:cat|dog)*x", srell::regex_constants::risk_none },
+		{ "\\d+\\d+", srell::regex_constants::risk_polynomial },
+		{ "(a+)+b", srell::regex_constants::risk_exponential },
+		{ "(?:a+)+b", srell::regex_constants::risk_exponential },
+		{ "(a|a)*b", srell::regex_constants::risk_exponential },
+		{ "(?:\\w|\\d)*x", srell::regex_constants::risk_exponential },
+		{ "(?:ab){10}", srell::regex_constants::risk_none },
+		{ "(?:[a-z]+,){30}", srell::regex_constants::risk_none },
+		{ "(?:(?:ab){3}){12}a", srell::regex_constants::risk_none },
+		{ "(?:\\d{1,3}\\.){3}\\d{1,3}", srell::regex_constants::risk_none },
+		{ "(.*a){3}", srell::regex_constants::risk_polynomial },
+		{ "(.*a){10}", srell::regex_constants::risk_exponential },
+		{ "(.*a){2,}", srell::regex_constants::risk_exponential },
+		{ "(?:.*?,){11}P", srell::regex_constants::risk_exponential },
+		{ "(?:a?){30}a{30}", srell::regex_constants::risk_exponential },
+		{ "(?:a{2,3}){10}", srell::regex_constants::risk_exponential }
+	};
+	unsigned int num_of_failures = 0;
+
+	for (std::size_t i = 0; i < sizeof (cases) / sizeof (cases[0]); ++i)
+	{
+		const srell::regex re(cases[i].re);
+		const std::string name(std::string("/") + cases[i].re + "/ backtracking_risk()");
+
+		expect(num_of_failures, name.c_str(), re.backtracking_risk(), cases[i].risk);
+	}
+	return result(num_of_failures);
+}
+
+#endif	//  !defined(SRELL_NO_RISKCHECK)
+
+#if defined(SRELL_ENABLE_PROFILER)
+
+bool profile_report()
+{
+	const srell::regex re("ab+c");
+	srell::cmatch m;
+	unsigned int num_of_failures = 0;
+
+	srell::regex_search("xabbc", m, re);
+
+	const std::string withsource(re.profile_report(m.profile(), "ab+c"));
+	const std::string withoutsource(re.profile_report(m.profile()));
+
+	std::fputs("\t/ab+c/ profile_report() after searching \"xabbc\";\n", stdout);
+	expect(num_of_failures, "header with the source", withsource.compare(0, withsource.find('\n'), "state  type                       entries    failures  span       source") == 0, 1);
+	expect(num_of_failures, "row with the source", withsource.find("  character                        1           0  0-1        a\n") != std::string::npos, 1);
+	expect(num_of_failures, "header without the source", withoutsource.compare(0, withoutsource.find('\n'), "state  type                       entries    failures  span") == 0, 1);
+	expect(num_of_failures, "row without the source", withoutsource.find("  character                        1           0  0-1\n") != std::string::npos, 1);
+	return result(num_of_failures);
+}
+
+#endif	//  defined(SRELL_ENABLE_PROFILER)
+
+//  Runs regex_search() with m, returning the error as catch_error() expects.
+struct searcher
+{
+	const srell::u8cregex *re;
+	const std::string *text;
+	srell::u8ccmatch *m;
+
+	srell::regex_constants::error_type operator()() const
+	{
+		srell::regex_search(text->c_str(), text->c_str() + text->size(), *m, *re);
+		return m->ecode();
+	}
+};
+
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+
+bool limit_counter_override()
+{
+	//  Takes 131070 steps to find "b".
+	const srell::u8cregex re("(?:a|a)*b");
+	const std::string text(std::string(16, 'a') + " b");
+	srell::u8ccmatch limited, shared;
+	const searcher search_limited = { &re, &text, &limited };
+	const searcher search_shared = { &re, &text, &shared };
+	unsigned int num_of_failures = 0;
+
+	limited.set_limit_counter(100);
+	std::fputs("\t/(?:a|a)*b/ search(\"a\" * 16 + \" b\") with set_limit_counter(100);\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_limited), srell::regex_constants::error_complexity);
+	expect(num_of_failures, "steps_consumed()", static_cast<long>(limited.steps_consumed()), 100);
+
+	std::fputs("\tThe same with another match_results;\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_shared), 0);
+	expect(num_of_failures, "found", shared.size() == 1 && shared.position(0) == 17, 1);
+	expect(num_of_failures, "steps_consumed()", static_cast<long>(shared.steps_consumed()), 131070);
+	expect(num_of_failures, "limit_counter", static_cast<long>(re.limit_counter), 16777216);
+
+	limited.set_limit_counter(0);
+	std::fputs("\tThe first match_results after set_limit_counter(0);\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_limited), 0);
+	expect(num_of_failures, "steps_consumed()", static_cast<long>(limited.steps_consumed()), 131070);
+	return result(num_of_failures);
+}
+
+#endif	//  !defined(SRELL_NO_LIMIT_COUNTER)
+
+bool interrupt_checker_override()
+{
+	const srell::u8cregex re("[a-z](?=\\d)");
+	const std::string text(std::string(10000, 'x') + "a1");
+	srell::cancellation_token token;
+	srell::u8ccmatch interrupted, shared;
+	const searcher search_interrupted = { &re, &text, &interrupted };
+	const searcher search_shared = { &re, &text, &shared };
+	unsigned int num_of_failures = 0;
+
+	token.cancel();
+	interrupted.set_interrupt_checker(&token);
+	std::fputs("\t/[a-z](?=\\d)/ search(\"x\" * 10000 + \"a1\") with a cancelled token set;\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_interrupted), srell::regex_constants::error_timeout);
+
+	std::fputs("\tThe same with another match_results;\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_shared), 0);
+	expect(num_of_failures, "found", shared.size() == 1 && shared.position(0) == 10000, 1);
+
+	interrupted.set_interrupt_checker(NULL);
+	std::fputs("\tThe first match_results after set_interrupt_checker(NULL);\n", stdout);
+	expect(num_of_failures, "error", catch_error(search_interrupted), 0);
+	return result(num_of_failures);
+}
+
+#if !defined(SRELL_NO_APIEXT)
+
+struct match_record
+{
+	long position;
+	long length;
+	long position1;	//  -1 if $1 did not match.
+	std::string str;
+	std::string prefix;
+};
+
+//  Records each match and stops after limit matches.
+struct match_recorder
+{
+	std::vector<match_record> *records;
+	std::size_t limit;
+
+	bool operator()(const srell::match_view<const char *> &view) const
+	{
+		match_record r;
+
+		r.position = static_cast<long>(view.position());
+		r.length = static_cast<long>(view.length());
+		r.position1 = view.size() > 1 && view[1].matched ? static_cast<long>(view.position(1)) : -1L;
+		r.str = view.str();
+		r.prefix = view.prefix().str();
+		records->push_back(r);
+		return records->size() < limit;
+	}
+};
+
+bool for_each_match_empty()
+{
+	const srell::u8cregex re("a*");
+	const char *const text = "baac";
+	std::vector<match_record> records;
+	const match_recorder recorder = { &records, 100 };
+	const long expected[][2] = { { 0, 0 }, { 1, 2 }, { 3, 0 }, { 4, 0 } };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/a*/ for_each_match(\"baac\");\n", stdout);
+	expect(num_of_failures, "error", re.for_each_match(text, recorder), 0);
+	if (expect(num_of_failures, "matches", static_cast<long>(records.size()), 4))
+	{
+		for (std::size_t i = 0; i < records.size(); ++i)
+		{
+			expect(num_of_failures, "position", records[i].position, expected[i][0]);
+			expect(num_of_failures, "length", records[i].length, expected[i][1]);
+		}
+	}
+	return result(num_of_failures);
+}
+
+bool for_each_match_stop()
+{
+	const srell::u8cregex re("\\d");
+	std::vector<match_record> records;
+	const match_recorder recorder = { &records, 2 };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/\\d/ for_each_match(\"1234\"), stopping at the 2nd match;\n", stdout);
+	expect(num_of_failures, "error", re.for_each_match("1234", recorder), 0);
+	expect(num_of_failures, "matches", static_cast<long>(records.size()), 2);
+	return result(num_of_failures);
+}
+
+bool for_each_match_view()
+{
+	const srell::u8cregex re("(\\d)(x)?|(y)");
+	const std::string text("a1b2xy");
+	std::vector<match_record> records;
+	const match_recorder recorder = { &records, 100 };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/(\\d)(x)?|(y)/ for_each_match(\"a1b2xy\");\n", stdout);
+	re.for_each_match(text.c_str(), text.c_str() + text.size(), recorder);
+	if (expect(num_of_failures, "matches", static_cast<long>(records.size()), 3))
+	{
+		expect(num_of_failures, "#0 position", records[0].position, 1);
+		expect(num_of_failures, "#0 position(1)", records[0].position1, 1);
+		expect(num_of_failures, "#0 prefix", records[0].prefix == "a", 1);
+		expect(num_of_failures, "#1 position", records[1].position, 3);
+		expect(num_of_failures, "#1 str", records[1].str == "2x", 1);
+		expect(num_of_failures, "#1 prefix", records[1].prefix == "b", 1);
+		expect(num_of_failures, "#2 position(1)", records[2].position1, -1);
+		expect(num_of_failures, "#2 prefix", records[2].prefix.empty(), 1);
+	}
+	return result(num_of_failures);
+}
+
+//  Counts the calls through a pointer, so that it works as a const or
+//  temporary function object too.
+struct call_counter
+{
+	std::size_t *calls;
+
+	template <typename View>
+	bool operator()(const View &) const
+	{
+		++*calls;
+		return true;
+	}
+};
+
+call_counter make_call_counter(std::size_t &calls)
+{
+	const call_counter counter = { &calls };
+
+	return counter;
+}
+
+bool for_each_match_temporary()
+{
+	const srell::u8cregex re("\\d+");
+	std::size_t calls = 0;
+	std::size_t linecalls = 0;
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/\\d+/ for_each_match(\"1a23b456\") and search_lines(\"1a23\\nb456\") with a temporary function object;\n", stdout);
+	expect(num_of_failures, "error", re.for_each_match("1a23b456", make_call_counter(calls)), 0);
+	expect(num_of_failures, "calls", static_cast<long>(calls), 3);
+	expect(num_of_failures, "error", re.search_lines("1a23\nb456", make_call_counter(linecalls)), 0);
+	expect(num_of_failures, "calls", static_cast<long>(linecalls), 2);
+
+#if defined(SRELL_CPP11_MOVE_ENABLED)
+	std::size_t total = 0;
+	std::size_t linetotal = 0;
+
+	std::fputs("\tThe same with lambdas;\n", stdout);
+	expect(num_of_failures, "error", re.for_each_match("1a23b456", [&total](const srell::match_view<const char *> &view)
+	{
+		total += static_cast<std::size_t>(view.length());
+		return true;
+	}), 0);
+	expect(num_of_failures, "total", static_cast<long>(total), 6);
+	expect(num_of_failures, "error", re.search_lines("1a23\nb456", [&linetotal](const srell::matched_line<const char *> &line)
+	{
+		linetotal += static_cast<std::size_t>(line.match().length());
+		return true;
+	}), 0);
+	expect(num_of_failures, "total", static_cast<long>(linetotal), 4);
+#endif
+	return result(num_of_failures);
+}
+
+#if defined(SRELL_CPP11_MOVE_ENABLED)
+
+//  Keeps what it gathers in its own members.
+struct length_summer
+{
+	std::size_t calls;
+	std::size_t total;
+
+	bool operator()(const srell::match_view<const char *> &view)
+	{
+		++calls;
+		total += static_cast<std::size_t>(view.length());
+		return true;
+	}
+
+	bool operator()(const srell::matched_line<const char *> &line)
+	{
+		return operator()(line.match());
+	}
+};
+
+bool for_each_match_state()
+{
+	const srell::u8cregex re("\\d+");
+	length_summer summer = { 0, 0 };
+	length_summer linesummer = { 0, 0 };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/\\d+/ for_each_match(\"1a23b456\") and search_lines(\"1a23\\nb456\");\n", stdout);
+	expect(num_of_failures, "error", re.for_each_match("1a23b456", summer), 0);
+	expect(num_of_failures, "calls", static_cast<long>(summer.calls), 3);
+	expect(num_of_failures, "total", static_cast<long>(summer.total), 6);
+	expect(num_of_failures, "error", re.search_lines("1a23\nb456", linesummer), 0);
+	expect(num_of_failures, "calls", static_cast<long>(linesummer.calls), 2);
+	expect(num_of_failures, "total", static_cast<long>(linesummer.total), 4);
+	return result(num_of_failures);
+}
+#endif	//  defined(SRELL_CPP11_MOVE_ENABLED)
+
+//  Records the number and position of each line and the position of the
+//  match in it.
+struct line_recorder
+{
+	std::vector<long> *records;
+
+	bool operator()(const srell::matched_line<const char *> &line) const
+	{
+		records->push_back(static_cast<long>(line.lineno()));
+		records->push_back(static_cast<long>(line.position()));
+		records->push_back(static_cast<long>(line.match().position()));
+		return true;
+	}
+};
+
+bool search_lines_view()
+{
+	const srell::u8cregex re("^b|c$");
+	std::vector<long> records;
+	const line_recorder recorder = { &records };
+	const long expected[] = { 2, 3, 0, 3, 6, 2 };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/^b|c$/ search_lines(\"ab\\nbc\\nabc\\ncb\");\n", stdout);
+	expect(num_of_failures, "error", re.search_lines("ab\nbc\nabc\ncb", recorder), 0);
+	if (expect(num_of_failures, "values", static_cast<long>(records.size()), 6))
+	{
+		expect(num_of_failures, "#0 lineno", records[0], expected[0]);
+		expect(num_of_failures, "#0 line position", records[1], expected[1]);
+		expect(num_of_failures, "#0 match position", records[2], expected[2]);
+		expect(num_of_failures, "#1 lineno", records[3], expected[3]);
+		expect(num_of_failures, "#1 line position", records[4], expected[4]);
+		expect(num_of_failures, "#1 match position", records[5], expected[5]);
+	}
+	return result(num_of_failures);
+}
+
+struct counter
+{
+	const srell::u8cregex *re;
+	const char *text;
+	std::size_t *num;
+	srell::interrupt_checker *ic;
+
+	srell::regex_constants::error_type operator()() const
+	{
+		return re->count(*num, text, srell::regex_constants::match_default, ic);
+	}
+};
+
+bool count_empty()
+{
+	const srell::u8cregex re("a*");
+	std::size_t num = 0;
+	const counter search = { &re, "baac", &num, NULL };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/a*/ count(\"baac\");\n", stdout);
+	expect(num_of_failures, "error", catch_error(search), 0);
+	expect(num_of_failures, "num", static_cast<long>(num), 4);
+	return result(num_of_failures);
+}
+
+//  An empty match at the beginning followed by a non-empty match at the
+//  same position, which regex_iterator finds by the retry with
+//  match_not_null and match_continuous. The subject is put in a
+//  buffer of its own length so that no character precedes or follows it.
+bool count_empty_at_begin(unsigned int &num_of_failures, const char *const pattern, const long expected)
+{
+	const srell::u8cregex re(pattern);
+	const std::vector<char> text(3, 'a');
+	std::size_t num = 0;
+	long num_iter = 0;
+
+	for (srell::u8ccregex_iterator it(&text[0], &text[0] + text.size(), re), eoi; it != eoi; ++it)
+		++num_iter;
+
+	std::fprintf(stdout, "\t/%s/ count(\"aaa\");\n", pattern);
+	expect(num_of_failures, "error", re.count(num, &text[0], &text[0] + text.size()), 0);
+	expect(num_of_failures, "num", static_cast<long>(num), expected);
+	return expect(num_of_failures, "regex_iterator", num_iter, expected);
+}
+
+bool count_empty_retry()
+{
+	unsigned int num_of_failures = 0;
+
+	count_empty_at_begin(num_of_failures, "^|^a+", 2);
+	count_empty_at_begin(num_of_failures, "\\b|\\Ba+", 3);
+	return result(num_of_failures);
+}
+
+bool count_error()
+{
+	const srell::u8cregex re("[a-z](?=\\d)");
+	const std::string text(std::string("a1") + std::string(10000, 'x'));
+	std::size_t num = 0;
+	srell::cancellation_token token;
+	const counter search = { &re, text.c_str(), &num, &token };
+	unsigned int num_of_failures = 0;
+
+	token.cancel();
+	std::fputs("\t/[a-z](?=\\d)/ count(\"a1\" + \"x\" * 10000) with a cancelled token;\n", stdout);
+	expect(num_of_failures, "error", catch_error(search), srell::regex_constants::error_timeout);
+	expect(num_of_failures, "num", static_cast<long>(num), 1);
+	return result(num_of_failures);
+}
+
+bool extract_offsets_columns()
+{
+	const srell::u8cregex re("(\\d+)(?:-(\\d+))?");
+	long starts0[4], starts1[4], starts2[4], ends0[4], ends1[4], ends2[4];
+	long *const starts[] = { starts0, starts1, starts2 };
+	long *const ends[] = { ends0, ends1, ends2 };
+	const long expected[][6] =
+	{
+		{ 1, 5, 1, 3, 4, 5 },
+		{ 7, 9, 7, 9, -1, -1 },
+		{ 10, 14, 10, 11, 12, 14 }
+	};
+	std::size_t rows = 0;
+	std::size_t next = 0;
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/(\\d+)(?:-(\\d+))?/ extract_offsets(\"a12-3 b45 7-89\");\n", stdout);
+	expect(num_of_failures, "error", re.extract_offsets(rows, next, "a12-3 b45 7-89", starts, ends, 3, 4), 0);
+	expect(num_of_failures, "next", static_cast<long>(next), -1L);
+	if (expect(num_of_failures, "rows", static_cast<long>(rows), 3))
+	{
+		for (std::size_t row = 0; row < rows; ++row)
+		{
+			for (std::size_t col = 0; col < 3; ++col)
+			{
+				expect(num_of_failures, "start", starts[col][row], expected[row][col * 2]);
+				expect(num_of_failures, "end", ends[col][row], expected[row][col * 2 + 1]);
+			}
+		}
+	}
+	return result(num_of_failures);
+}
+
+struct offsets_extractor
+{
+	const srell::u8cregex *re;
+	const char *text;
+	std::size_t from;	//  Resumes the scan at text + from.
+	std::size_t *rows;
+	std::size_t *next;
+	unsigned int *first;	//  Receives the start of the first row.
+	std::size_t capacity;
+	srell::interrupt_checker *ic;
+
+	srell::regex_constants::error_type operator()() const
+	{
+		unsigned int starts0[4] = { 0, 0, 0, 0 }, ends0[4];
+		unsigned int *const starts[] = { starts0 };
+		unsigned int *const ends[] = { ends0 };
+		const srell::regex_constants::error_type e = from == 0
+			? re->extract_offsets(*rows, *next, text, starts, ends, 1, capacity, srell::regex_constants::match_default, ic)
+			: re->extract_offsets(*rows, *next, text, text + from, text + std::strlen(text), starts, ends, 1, capacity, srell::regex_constants::match_default, ic);
+
+		*first = starts0[0];
+		return e;
+	}
+};
+
+bool extract_offsets_limits()
+{
+	const srell::u8cregex re("[a-z](?=\\d)");
+	const srell::u8cregex lbre("(?<=a1)b");
+	const std::string text(std::string("a1b2") + std::string(10000, 'x'));
+	std::size_t rows = 0;
+	std::size_t next = 0;
+	unsigned int first = 0;
+	srell::cancellation_token token;
+	const offsets_extractor full = { &re, text.c_str(), 0, &rows, &next, &first, 1, NULL };
+	const offsets_extractor resumed = { &re, text.c_str(), 2, &rows, &next, &first, 1, NULL };
+	const offsets_extractor lbresumed = { &lbre, text.c_str(), 2, &rows, &next, &first, 1, NULL };
+	const offsets_extractor empty = { &re, text.c_str(), 0, &rows, &next, &first, 0, NULL };
+	const offsets_extractor interrupted = { &re, text.c_str(), 0, &rows, &next, &first, 4, &token };
+	unsigned int num_of_failures = 0;
+
+	std::fputs("\t/[a-z](?=\\d)/ extract_offsets(\"a1b2\" + \"x\" * 10000) with capacity 1;\n", stdout);
+	expect(num_of_failures, "error", catch_error(full), 0);
+	expect(num_of_failures, "rows", static_cast<long>(rows), 1);
+	expect(num_of_failures, "next", static_cast<long>(next), 2);
+
+	std::fputs("\tThe same with capacity 0;\n", stdout);
+	expect(num_of_failures, "error", catch_error(empty), 0);
+	expect(num_of_failures, "rows", static_cast<long>(rows), 0);
+	expect(num_of_failures, "next", static_cast<long>(next), 0);
+
+	std::fputs("\tResumed at next with capacity 1;\n", stdout);
+	expect(num_of_failures, "error", catch_error(resumed), 0);
+	expect(num_of_failures, "rows", static_cast<long>(rows), 1);
+	expect(num_of_failures, "start", static_cast<long>(first), 2);
+	expect(num_of_failures, "next", static_cast<long>(next), -1L);
+
+	std::fputs("\t/(?<=a1)b/ resumed at 2 with capacity 1;\n", stdout);
+	expect(num_of_failures, "error", catch_error(lbresumed), 0);
+	expect(num_of_failures, "rows", static_cast<long>(rows), 1);
+	expect(num_of_failures, "start", static_cast<long>(first), 2);
+
+	token.cancel();
+	std::fputs("\tThe same with capacity 4 and a cancelled token;\n", stdout);
+	expect(num_of_failures, "error", catch_error(interrupted), srell::regex_constants::error_timeout);
+	expect(num_of_failures, "rows", static_cast<long>(rows), 2);
+	return result(num_of_failures);
+}
+
+//  Runs for_each_match() or search_lines() over text, counting the calls
+//  of the callback.
+struct scanner
+{
+	const srell::u8cregex *re;
+	const std::string *text;
+	bool lines;
+	std::size_t *calls;
+	srell::interrupt_checker *ic;
+
+	srell::regex_constants::error_type operator()() const
+	{
+		const call_counter counter = { calls };
+
+		*calls = 0;
+		return lines
+			? re->search_lines(text->begin(), text->end(), counter, srell::regex_constants::match_default, ic)
+			: re->for_each_match(text->begin(), text->end(), counter, srell::regex_constants::match_default, ic);
+	}
+};
+
+bool interrupt_scan(const char *const pattern, const std::string &text, const bool lines, srell::interrupt_checker &ic, const bool matching)
+{
+	const srell::u8cregex re(pattern);
+	std::size_t calls = 0;
+	const scanner scan = { &re, &text, lines, &calls, &ic };
+	unsigned int num_of_failures = 0;
+
+	std::fprintf(stdout, "\t/%s/ %s(%lu code units);\n", pattern, lines ? "search_lines" : "for_each_match", static_cast<unsigned long>(text.size()));
+	expect(num_of_failures, "error", catch_error(scan), srell::regex_constants::error_timeout);
+	if (matching)
+		expect(num_of_failures, "stopped early", calls > 0 && calls < 100000, 1);
+	return num_of_failures == 0;
+}
+
+std::string repeat_string(const char *const s, const std::size_t count)
+{
+	std::string text;
+
+	for (std::size_t i = 0; i < count; ++i)
+		text.append(s);
+
+	return text;
+}
+
+bool interrupt_scans()
+{
+#if defined(SRELL_CPP11_CHRONO_ENABLED)
+	srell::search_deadline ic(srell::search_deadline::clock_type::now());
+	std::fputs("\tWith a deadline that has passed:\n", stdout);
+#else
+	srell::cancellation_token ic;
+	ic.cancel();
+	std::fputs("\tWith a cancelled token:\n", stdout);
+#endif
+	const std::string lines(repeat_string("b1\n", 400000));
+	const std::string text(std::string(1000000, 'x') + "z");
+	unsigned int num_of_failures = 0;
+
+	num_of_failures += !interrupt_scan("b\\d", lines, false, ic, true);
+	num_of_failures += !interrupt_scan("^b", lines, true, ic, true);
+	num_of_failures += !interrupt_scan("b1", lines, true, ic, true);
+	//  Scans in which only the prefilters run.
+	num_of_failures += !interrupt_scan("needle", text, false, ic, false);
+	num_of_failures += !interrupt_scan("(?i)needle", text, false, ic, false);
+	num_of_failures += !interrupt_scan("z\\d", text, false, ic, false);
+	num_of_failures += !interrupt_scan("[yz]\\d", text, false, ic, false);
+	return result(num_of_failures);
+}
+
+#endif	//  !defined(SRELL_NO_APIEXT)
+
+struct testcase
+{
+	const char *title;
+	bool (*func)();
+};
+
+const testcase tests[] =
+{
+#if !defined(SRELL_NO_RISKCHECK)
+	{ "backtracking_risk 01: Loops, unbounded and counted, rated by their bodies.\n", backtracking_risk },
+#endif
+#if defined(SRELL_ENABLE_PROFILER)
+	{ "profile_report 01: Header and rows with and without the source.\n", profile_report },
+#endif
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+	{ "limit_counter 01: Per-search limit set in match_results and steps_consumed().\n", limit_counter_override },
+#endif
+#if !defined(SRELL_NO_APIEXT)
+	{ "for_each_match 01: Empty matches advance as in JavaScript.\n", for_each_match_empty },
+	{ "for_each_match 02: The callback stops the scan.\n", for_each_match_stop },
+	{ "for_each_match 03: Positions and prefixes in match_view.\n", for_each_match_view },
+#if defined(SRELL_CPP11_MOVE_ENABLED)
+	{ "for_each_match 04: The callback keeps its state.\n", for_each_match_state },
+#endif
+	{ "for_each_match 05: A temporary function object and a lambda.\n", for_each_match_temporary },
+	{ "search_lines 01: Line numbers and positions in matched_line.\n", search_lines_view },
+	{ "count 01: Empty matches are counted as regex_iterator visits them.\n", count_empty },
+	{ "count 02: An empty match at the beginning followed by a non-empty one.\n", count_empty_retry },
+	{ "count 03: An error and the number of matches found before it.\n", count_error },
+	{ "extract_offsets 01: Columns of offsets with an unmatched group.\n", extract_offsets_columns },
+	{ "extract_offsets 02: Capacity, resumption and an error.\n", extract_offsets_limits },
+	{ "interrupt_checker 01: Interrupting scans made of many searches and long prefilter scans.\n", interrupt_scans },
+#endif
+	{ "interrupt_checker 02: Per-search interrupt_checker set in match_results.\n", interrupt_checker_override },
+	{ NULL, NULL }
+};
+
+}	//  namespace apitest
+
 int main(const int argc, const char *const argv[])
 {
 	options opts(argc, argv);
@@ -788,6 +1660,43 @@ int main(const int argc, const char *const argv[])
 	if (opts.errorno)
 		return opts.errorno;
 
+#if defined(STEP_METRICS)
+	std::vector<baseline_entry> baseline;
+	std::FILE *metrics_fp = NULL;
+	unsigned int num_of_metrics_same = 0;
+	unsigned int num_of_metrics = 0;
+
+	if (opts.metrics_file)
+	{
+		if (opts.write_metrics)
+		{
+			metrics_fp = std::fopen(opts.metrics_file, "w");
+			if (metrics_fp == NULL)
+			{
+				std::fprintf(stdout, "[Error] Could not open \"%s\".\n", opts.metrics_file);
+				return 1;
+			}
+			std::fprintf(metrics_fp, "# Step metrics of conftest.\n# TestType: %d\n#", opts.utype);
+			std::fputs(" index", metrics_fp);
+			for (int i = 0; i < step_metrics::num_of_metrics; ++i)
+				std::fprintf(metrics_fp, " %s", step_metrics::name(i));
+			std::fputs(" title\n", metrics_fp);
+		}
+		else
+		{
+			int btype = opts.utype;
+
+			if (!read_metrics(baseline, btype, opts.metrics_file))
+			{
+				std::fprintf(stdout, "[Error] Could not read \"%s\".\n", opts.metrics_file);
+				return 1;
+			}
+			if (btype != opts.utype)
+				std::fprintf(stdout, "[Warning] The baseline was written for TestType %d.\n\n", btype);
+		}
+	}
+#endif
+
 	const testdata *t = tests;
 
 	for (;; ++t)
@@ -814,6 +1723,28 @@ int main(const int argc, const char *const argv[])
 			++num_of_tests_passed;
 
 		++num_of_tests;
+
+#if defined(STEP_METRICS)
+		const unsigned int index = static_cast<unsigned int>(t - tests);
+
+		if (metrics_fp)
+			write_metrics(metrics_fp, index, t->title);
+		else if (opts.metrics_file)
+		{
+			if (compare_metrics(baseline, index))
+				++num_of_metrics_same;
+			++num_of_metrics;
+		}
+#endif
+	}
+
+	for (const apitest::testcase *a = apitest::tests; a->title; ++a)
+	{
+		std::fputs(a->title, stdout);
+		if (a->func())
+			++num_of_tests_passed;
+
+		++num_of_tests;
 	}
 
 	const char *typetable[] = {
@@ -836,5 +1767,12 @@ int main(const int argc, const char *const argv[])
 	std::fprintf(stdout, "Results of tests: %u/%u (%.1lf%%) passed. (%u skipped).\n", num_of_tests_passed, num_of_tests, num_of_tests ? static_cast<double>(num_of_tests_passed) * 100.0 / num_of_tests : -1.0, skipped);
 //	std::fprintf(stdout, "Results of benchmarks: %u/%u passed.\n", num_of_benches_passed, num_of_benches);
 
+#if defined(STEP_METRICS)
+	if (metrics_fp)
+		std::fclose(metrics_fp);
+	else if (opts.metrics_file)
+		std::fprintf(stdout, "Results of metrics: %u/%u unchanged.\n", num_of_metrics_same, num_of_metrics);
+#endif
+
 	return 0;
 }
@@ -0,0 +1,1208 @@
+//
+//  regexgen.cpp: version 1.000 (2026/10/18).
+//
+//  This is a program that generates a C++ header file from a list of
+//  regular expressions. For each expression the header contains a matcher
+//  translated from the states that SRELL's compiler makes for it, so that
+//  a program including the header needs neither to compile the expressions
+//  at run time nor to interpret the states.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../srell.hpp"
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(disable:4996)
+#endif
+
+namespace regexgen
+{
+typedef srell::re_detail::ui_l32 ui_l32;
+typedef srell::re_detail::re_state state_type;
+
+std::string to_string(const unsigned long value)
+{
+	char buf[32];
+
+	std::sprintf(buf, "%lu", value);
+	return buf;
+}
+
+std::string to_hex(const ui_l32 value)
+{
+	char buf[16];
+
+	std::sprintf(buf, "0x%lX", static_cast<unsigned long>(value));
+	return buf;
+}
+
+bool read_file(std::string &str, const char *const filename)
+{
+	FILE *const fp = std::fopen(filename, "r");
+
+	std::fprintf(stdout, "Reading '%s'... ", filename);
+
+	if (fp)
+	{
+		static const std::size_t bufsize = 4096;
+		char buffer[bufsize];
+
+		for (;;)
+		{
+			const std::size_t size = std::fread(buffer, 1, bufsize, fp);
+
+			if (!size)
+				break;
+
+			str.append(buffer, size);
+		}
+		std::fclose(fp);
+		std::fputs("done.\n", stdout);
+		return true;
+	}
+	std::fputs("failed...\n", stdout);
+	return false;
+}
+
+bool write_file(const char *const filename, const std::string &str)
+{
+	FILE *const fp = std::fopen(filename, "wb");
+
+	std::fprintf(stdout, "Writing '%s'... ", filename);
+
+	if (fp)
+	{
+		const bool success = std::fwrite(str.c_str(), 1, str.size(), fp) == str.size();
+		std::fclose(fp);
+		if (success)
+		{
+			std::fputs("done.\n", stdout);
+			return true;
+		}
+	}
+	std::fputs("failed...\n", stdout);
+	return false;
+}
+
+//  Gives access to the result of compilation.
+class compiled_regex : public srell::u8cregex
+{
+public:
+
+	const regexgen::state_type &state(const std::size_t no) const
+	{
+		return this->NFA_states[no];
+	}
+
+	ui_l32 state_number(const regexgen::state_type *const st) const
+	{
+		return static_cast<ui_l32>(st - this->NFA_states.data());
+	}
+
+	srell::re_detail::range_pairs class_ranges(const ui_l32 no) const
+	{
+		return this->character_class[no];
+	}
+
+	//  Code points of st_string.
+	std::vector<ui_l32> string_codepoints(const regexgen::state_type &st) const
+	{
+		std::vector<ui_l32> cps;
+		const char *begin = this->strings.data() + st.char_num;
+		const char *const end = begin + st.quantifier.atleast;
+
+		while (begin != end)
+			cps.push_back(srell::re_detail::utf8_traits<char>::codepoint_inc(begin, end));
+		return cps;
+	}
+
+	//  Pairs of a code point and a state number of st_character_switch.
+	std::vector<srell::re_detail::range_pair> cases_of(const regexgen::state_type &st) const
+	{
+		const srell::re_detail::range_pair *const begin = this->switch_cases.data() + st.char_num;
+
+		return std::vector<srell::re_detail::range_pair>(begin, begin + st.quantifier.atleast);
+	}
+
+	ui_l32 brackets() const
+	{
+		return this->number_of_brackets;
+	}
+
+	ui_l32 counters() const
+	{
+		return this->number_of_counters;
+	}
+
+	ui_l32 repeats() const
+	{
+		return this->number_of_repeats;
+	}
+
+	bool icase() const
+	{
+		return this->is_ricase();
+	}
+
+	std::size_t limit() const
+	{
+		return this->limit_counter;
+	}
+
+	//  Name of group no in code points, empty if unnamed.
+	std::vector<ui_l32> group_name(const ui_l32 no) const
+	{
+		std::vector<ui_l32> name;
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+		const srell::re_detail::groupname_mapper<char>::gname_string gname(this->namedcaptures[no]);
+		const char *begin = gname.data();
+		const char *const end = begin + gname.size();
+
+		while (begin != end)
+			name.push_back(srell::re_detail::utf8_traits<char>::codepoint_inc(begin, end));
+#else
+		static_cast<void>(no);
+#endif
+		return name;
+	}
+};
+//  compiled_regex
+
+struct pattern_entry
+{
+	std::string name;
+	std::string source;	//  As written in the list, "/.../flags".
+	std::string expression;
+	srell::regex_constants::syntax_option_type options;
+	unsigned int line;
+};
+
+class matcher_writer
+{
+public:
+
+	matcher_writer(const compiled_regex &re, const pattern_entry &pe)
+		: re_(re), pe_(pe), uses_counter_(false), uses_submatch_(false)
+	{
+	}
+
+	//  Returns an empty string and sets message on failure.
+	std::string write(std::string &message)
+	{
+		const state_type &entry = re_.state(0);
+		const ui_l32 e2 = ref(entry.next_state2());
+		//  The search entry may begin with a lookbehind that rewinds the
+		//  start of the match after finding a later part of the expression.
+		//  The entry for match_continuous tried at each position finds the
+		//  same match.
+		const ui_l32 e1 = entry.next_state1()->type == srell::re_detail::st_lookaround_open && entry.next_state1()->quantifier.is_greedy >= 2
+			? e2 : ref(entry.next_state1());
+		std::string states;
+
+		//  Writing a state or popping a state pushed by it may add others.
+		for (std::size_t written = 0;;)
+		{
+			for (; written < queue_.size(); ++written)
+			{
+				if (!write_state(states, queue_[written]))
+				{
+					message = message_;
+					return std::string();
+				}
+			}
+
+			for (std::size_t i = 0; i < pushers_.size(); ++i)
+				ref(re_.state(pushers_[i]).next_state2());
+
+			if (written == queue_.size())
+				break;
+		}
+
+		std::string out("//  ");
+
+		out += pe_.source + "\nstruct " + pe_.name + " : public regexgen_detail::matcher<" + pe_.name + ">\n{\n";
+		out += "\tstatic const srell::re_detail::ui_l32 number_of_brackets = " + to_string(re_.brackets()) + ";\n";
+		out += "\tstatic const srell::re_detail::ui_l32 number_of_counters = " + to_string(re_.counters()) + ";\n";
+		out += "\tstatic const srell::re_detail::ui_l32 number_of_repeats = " + to_string(re_.repeats()) + ";\n";
+		out += "\tstatic const std::size_t limit_counter = " + to_string(static_cast<unsigned long>(re_.limit())) + ";\n\n";
+
+		out += write_names();
+
+		for (std::size_t i = 0; i < classes_.size(); ++i)
+			out += write_class(classes_[i]);
+
+		out += "\ttemplate <typename utf_traits, typename BidirectionalIterator>\n";
+		out += "\tstatic int run_(srell::re_detail::re_search_state<BidirectionalIterator> &ss, std::vector<regexgen_detail::frame<BidirectionalIterator> > &" + std::string(pushers_.size() ? "bt" : "/* bt */") + ", const bool continuous)\n";
+		out += "\t{\n";
+		if (pushers_.size())
+			out += "\t\ttypedef regexgen_detail::frame<BidirectionalIterator> frame_type;\n";
+		if (uses_submatch_)
+			out += "\t\ttypedef typename srell::re_detail::re_search_state<BidirectionalIterator>::submatch_type submatch_type;\n";
+		if (uses_counter_)
+			out += "\t\ttypedef typename srell::re_detail::re_search_state<BidirectionalIterator>::counter_type counter_type;\n";
+		if (pushers_.size() || uses_submatch_ || uses_counter_)
+			out += "\n";
+
+		if (e1 != e2)
+			out += "\t\tif (continuous)\n\t\t\tgoto S" + to_string(e2) + ";\n";
+		else
+			out += "\t\tstatic_cast<void>(continuous);\n";
+		out += "\t\tgoto S" + to_string(e1) + ";\n\n";
+
+		out += "\t\tNOT_MATCHED:\n";
+		out += "\t\tif (const int reason = regexgen_detail::count_failure(ss))\n\t\t\treturn reason;\n";
+		if (pushers_.size())
+		{
+			out += "\t\tif (bt.empty())\n\t\t\treturn 0;\n\n";
+			out += "\t\tss.ssc.iter = bt.back().iter;\n";
+			out += "\t\tswitch (bt.back().state)\n\t\t{\n";
+			for (std::size_t i = 0; i < pushers_.size(); ++i)
+			{
+				const ui_l32 target = ref(re_.state(pushers_[i]).next_state2());
+
+				out += i + 1 < pushers_.size() ? "\t\tcase " + to_string(pushers_[i]) + ":\n" : "\t\tdefault:\t//  " + to_string(pushers_[i]) + "\n";
+				out += "\t\t\tbt.pop_back();\n\t\t\tgoto S" + to_string(target) + ";\n";
+			}
+			out += "\t\t}\n\n";
+		}
+		else
+			out += "\t\treturn 0;\n\n";
+
+		out += states;
+		out.erase(out.size() - 1);
+		out += "\t}\n};\n\n";
+		return out;
+	}
+
+private:
+
+	ui_l32 ref(const state_type *const st)
+	{
+		const ui_l32 no = re_.state_number(st);
+
+		if (queued_.size() <= no)
+			queued_.resize(no + 1, false);
+		if (!queued_[no])
+		{
+			queued_[no] = true;
+			queue_.push_back(no);
+		}
+		return no;
+	}
+
+	std::string go(const state_type *const st)
+	{
+		return "goto S" + to_string(ref(st)) + ";";
+	}
+
+	std::string class_call(const ui_l32 no, const std::string &arg)
+	{
+		std::size_t i = 0;
+
+		for (; i < classes_.size(); ++i)
+			if (classes_[i] == no)
+				break;
+		if (i == classes_.size())
+			classes_.push_back(no);
+
+		return "class" + to_string(no) + "_(" + arg + ")";
+	}
+
+	void add_pusher(const ui_l32 no)
+	{
+		for (std::size_t i = 0; i < pushers_.size(); ++i)
+			if (pushers_[i] == no)
+				return;
+		pushers_.push_back(no);
+	}
+
+	std::string push(const ui_l32 no)
+	{
+		add_pusher(no);
+		return "bt.push_back(frame_type(" + to_string(no) + ", ss.ssc.iter));";
+	}
+
+	std::string canonicalise(const std::string &expr) const
+	{
+		return re_.icase() ? "srell::re_detail::unicode_case_folding::do_casefolding(" + expr + ")" : expr;
+	}
+
+	//  Loops saving or restoring the brackets nested in a group or in a repeat.
+	static std::string push_inner(const state_type &st, const std::string &indent)
+	{
+		if (st.quantifier.atleast > st.quantifier.atmost)
+			return std::string();
+
+		return indent + "for (srell::re_detail::ui_l32 brno = " + to_string(st.quantifier.atleast) + "; brno <= " + to_string(st.quantifier.atmost) + "; ++brno)\n"
+			+ indent + "{\n"
+			+ indent + "\tsubmatch_type &inner_bracket = ss.bracket[brno];\n\n"
+			+ indent + "\tss.capture_stack.push_back(inner_bracket.core);\n"
+			+ indent + "\tss.counter_stack.push_back(inner_bracket.counter);\n"
+			+ indent + "\tinner_bracket.core.open_at = inner_bracket.core.close_at = ss.srchend;\n"
+			+ indent + "\tinner_bracket.counter = 0;\n"
+			+ indent + "}\n";
+	}
+
+	static std::string pop_inner(const state_type &st, const std::string &indent)
+	{
+		if (st.quantifier.atleast > st.quantifier.atmost)
+			return std::string();
+
+		return indent + "for (srell::re_detail::ui_l32 brno = " + to_string(st.quantifier.atmost) + "; brno >= " + to_string(st.quantifier.atleast) + "; --brno)\n"
+			+ indent + "{\n"
+			+ indent + "\tsubmatch_type &inner_bracket = ss.bracket[brno];\n\n"
+			+ indent + "\tinner_bracket.counter = ss.counter_stack.back();\n"
+			+ indent + "\tinner_bracket.core = ss.capture_stack.back();\n"
+			+ indent + "\tss.counter_stack.pop_back();\n"
+			+ indent + "\tss.capture_stack.pop_back();\n"
+			+ indent + "}\n";
+	}
+
+	//  The bounded form of st_repeat_atom. The minimum and maximum are in
+	//  the repeat_atom_pop that follows, and only what exceeds the minimum
+	//  is given back.
+	void write_bounded_repeat_atom(std::string &s, const state_type &st, const ui_l32 no, const std::string &mismatch)
+	{
+		const srell::re_detail::re_quantifier &bounds = st.next_state2()->quantifier;
+		const std::string atleast = to_string(bounds.atleast);
+		//  minpos is needed only for the frame pushed below.
+		const bool greedy = st.quantifier.is_greedy;
+
+		s += "\t\t{\n";
+		if (greedy)
+			s += "\t\t\tBidirectionalIterator minpos = ss.ssc.iter;\n";
+		s += "\t\t\tsrell::re_detail::ui_l32 count = 0;\n\n";
+		s += "\t\t\tfor (; count < " + to_string(bounds.atmost) + "u; ++count)\n\t\t\t{\n";
+		if (greedy)
+			s += "\t\t\t\tif (count == " + atleast + "u)\n\t\t\t\t\tminpos = ss.ssc.iter;\n";
+		s += "\t\t\t\tif (ss.is_at_srchend())\n\t\t\t\t\tbreak;\n\n";
+		s += "\t\t\t\tconst BidirectionalIterator prevpos = ss.ssc.iter;\n";
+		s += "\t\t\t\tconst srell::re_detail::ui_l32 uchar = utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend);\n\n";
+		s += "\t\t\t\tif (" + mismatch + ")\n";
+		s += "\t\t\t\t{\n\t\t\t\t\tss.ssc.iter = prevpos;\n\t\t\t\t\tbreak;\n\t\t\t\t}\n\t\t\t}\n";
+		s += "\t\t\tif (count < " + atleast + "u)\n\t\t\t\tgoto NOT_MATCHED;\n";
+		if (greedy)
+		{
+			s += "\t\t\tif (count == " + atleast + "u)\n\t\t\t\tminpos = ss.ssc.iter;\n";
+			add_pusher(no);
+			s += "\t\t\tif (ss.ssc.iter != minpos)\n\t\t\t{\n";
+			s += "\t\t\t\tbt.push_back(frame_type(" + to_string(ref(st.next_state2())) + ", minpos));\n";
+			s += "\t\t\t\tbt.push_back(frame_type(" + to_string(no) + ", ss.ssc.iter));\n\t\t\t}\n";
+		}
+		s += "\t\t}\n\t\t" + go(st.next_state1()) + "\n\n";
+	}
+
+	//  Follows the same steps as re_object::run_automaton() with reverse == false.
+	bool write_state(std::string &out, const ui_l32 no)
+	{
+		const state_type &st = re_.state(no);
+		const std::string n = to_string(no);
+		const std::string k = to_string(st.char_num);
+		std::string s("\t\tS" + n + ":\n");
+
+		switch (st.type)
+		{
+		case srell::re_detail::st_character:
+			{
+				//  Characters chained by next_state2 are tested against the
+				//  same uchar. The chain either ends or leads to another type.
+				const state_type *last = st.next2 ? st.next_state2() : NULL;
+				std::size_t count = 0;
+
+				for (; last && last->type == srell::re_detail::st_character && count < 256; ++count)
+					last = last->next2 ? last->next_state2() : NULL;
+
+				s += "\t\tif (!ss.is_at_srchend())\n\t\t{\n";
+				if (last)
+					s += "\t\t\tconst BidirectionalIterator prevpos = ss.ssc.iter;\n";
+				s += "\t\t\tconst srell::re_detail::ui_l32 uchar = " + canonicalise("utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend)") + ";\n\n";
+				s += "\t\t\tif (uchar == " + to_hex(st.char_num) + ")\n\t\t\t\t" + go(st.next_state1()) + "\n";
+				for (const state_type *alt = st.next2 ? st.next_state2() : NULL; alt != last; alt = alt->next2 ? alt->next_state2() : NULL)
+					s += "\t\t\tif (uchar == " + to_hex(alt->char_num) + ")\n\t\t\t\t" + go(alt->next_state1()) + "\n";
+				if (last)
+					s += "\t\t\tss.ssc.iter = prevpos;\n\t\t\t" + go(last) + "\n";
+			}
+			if (st.next2)
+				s += "\t\t}\n\t\telse\n\t\t\t" + go(st.next_state2()) + "\n";
+			else
+				s += "\t\t}\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_string:
+			{
+				const std::vector<ui_l32> cps(re_.string_codepoints(st));
+
+				for (std::size_t i = 0; i < cps.size(); ++i)
+					s += "\t\tif (ss.is_at_srchend() || " + canonicalise("utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend)") + " != " + to_hex(cps[i]) + ")\n\t\t\tgoto NOT_MATCHED;\n";
+			}
+			s += "\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_repeat_atom:
+			{
+				std::string mismatch;
+
+				if ((st.flags & 9u) == 0u)
+					mismatch = canonicalise("uchar") + " != " + to_hex(st.char_num);
+				else if ((st.flags & 9u) == 1u)
+					mismatch = "uchar == " + to_hex(st.char_num) + " || uchar > 0x10ffff";
+				else
+					mismatch = "!" + class_call(st.char_num, "uchar");
+
+				if (st.flags & 16u)
+				{
+					write_bounded_repeat_atom(s, st, no, mismatch);
+					break;
+				}
+				s += "\t\t{\n\t\t\tconst BidirectionalIterator orgpos = ss.ssc.iter;\n\n";
+				s += "\t\t\twhile (!ss.is_at_srchend())\n\t\t\t{\n";
+				s += "\t\t\t\tconst BidirectionalIterator prevpos = ss.ssc.iter;\n";
+				s += "\t\t\t\tconst srell::re_detail::ui_l32 uchar = utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend);\n\n";
+				s += "\t\t\t\tif (" + mismatch + ")\n";
+			}
+			s += "\t\t\t\t{\n\t\t\t\t\tss.ssc.iter = prevpos;\n\t\t\t\t\tbreak;\n\t\t\t\t}\n\t\t\t}\n";
+			if (st.quantifier.is_greedy)
+			{
+				//  The lower frame keeps where the run began. Only the pop
+				//  state removes it, so it needs no case of its own.
+				add_pusher(no);
+				s += "\t\t\tif (ss.ssc.iter != orgpos)\n\t\t\t{\n";
+				s += "\t\t\t\tbt.push_back(frame_type(" + to_string(ref(st.next_state2())) + ", orgpos));\n";
+				s += "\t\t\t\tbt.push_back(frame_type(" + n + ", ss.ssc.iter));\n\t\t\t}\n";
+			}
+			else
+				s += "\t\t\tstatic_cast<void>(orgpos);\n";
+			s += "\t\t}\n\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_character_switch:
+			{
+				const std::vector<srell::re_detail::range_pair> cases(re_.cases_of(st));
+
+				s += "\t\tif (!ss.is_at_srchend())\n\t\t{\n";
+				s += "\t\t\tconst BidirectionalIterator prevpos = ss.ssc.iter;\n\n";
+				s += "\t\t\tswitch (" + canonicalise("utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend)") + ")\n\t\t\t{\n";
+				for (std::size_t i = 0; i < cases.size(); ++i)
+					s += "\t\t\tcase " + to_hex(cases[i].first) + ": " + go(&re_.state(cases[i].second)) + "\n";
+				s += "\t\t\tdefault:\n\t\t\t\tss.ssc.iter = prevpos;\n\t\t\t}\n\t\t}\n";
+			}
+			if (st.next2)
+				s += "\t\t" + go(st.next_state2()) + "\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_repeat_atom_pop:
+			s += "\t\t{\n\t\t\tconst BidirectionalIterator orgpos = bt.back().iter;\n\n";
+			s += "\t\t\tutf_traits::dec_codepoint(ss.ssc.iter, orgpos);\n";
+			s += "\t\t\tif (ss.ssc.iter != orgpos)\n\t\t\t\tbt.push_back(frame_type(" + to_string(ref(st.next_state2())) + ", ss.ssc.iter));\n";
+			s += "\t\t\telse\n\t\t\t\tbt.pop_back();\n\t\t}\n";
+			s += "\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_character_class:
+			s += "\t\tif (!ss.is_at_srchend())\n\t\t{\n";
+			if (st.next2)
+				s += "\t\t\tconst BidirectionalIterator prevpos = ss.ssc.iter;\n\n";
+			s += "\t\t\tif (" + class_call(st.char_num, "utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend)") + ")\n\t\t\t\t" + go(st.next_state1()) + "\n";
+			if (st.next2)
+			{
+				s += "\t\t\tss.ssc.iter = prevpos;\n\t\t\t" + go(st.next_state2()) + "\n";
+				s += "\t\t}\n\t\telse\n\t\t\t" + go(st.next_state2()) + "\n";
+			}
+			else
+				s += "\t\t}\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_epsilon:
+			if (st.next2)
+				s += "\t\t" + push(no) + "\n";
+			s += "\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_check_counter:
+			uses_counter_ = true;
+			s += "\t\t{\n\t\t\tcounter_type &counter = ss.counter[" + k + "];\n\n";
+			s += "\t\t\tif (counter < " + to_string(st.quantifier.atmost) + "u)\n\t\t\t{\n";
+			s += "\t\t\t\tif (++counter > " + to_string(st.quantifier.atleast) + "u)\n\t\t\t\t{\n";
+			s += "\t\t\t\t\t" + push(no) + "\n\t\t\t\t\t" + go(st.next_state1()) + "\n\t\t\t\t}\n";
+			s += "\t\t\t\t" + go(st.quantifier.is_greedy ? st.next_state1() : st.next_state2()) + "\n\t\t\t}\n\t\t}\n";
+			if (st.quantifier.is_infinity())
+				s += "\t\t" + push(no) + "\n\t\t" + go(st.next_state1()) + "\n\n";
+			else
+				s += "\t\t" + go(st.quantifier.is_greedy ? st.next_state2() : st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_decrement_counter:
+			s += "\t\t--ss.counter[" + k + "];\n\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_save_and_reset_counter:
+			s += "\t\tss.counter_stack.push_back(ss.counter[" + k + "]);\n";
+			s += "\t\t" + push(no) + "\n";
+			s += "\t\tss.counter[" + k + "] = 0;\n";
+			s += "\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_restore_counter:
+			s += "\t\tss.counter[" + k + "] = ss.counter_stack.back();\n\t\tss.counter_stack.pop_back();\n\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_roundbracket_open:
+			uses_submatch_ = true;
+			s += "\t\t{\n\t\t\tsubmatch_type &bracket = ss.bracket[" + k + "];\n\n";
+			s += "\t\t\t++bracket.counter;\n\t\t\tss.capture_stack.push_back(bracket.core);\n\t\t\tbracket.core.open_at = ss.ssc.iter;\n";
+			s += push_inner(st, "\t\t\t");
+			s += "\t\t\t" + push(no) + "\n\t\t}\n\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_roundbracket_pop:
+			uses_submatch_ = true;
+			s += pop_inner(st, "\t\t");
+			s += "\t\t{\n\t\t\tsubmatch_type &bracket = ss.bracket[" + k + "];\n\n";
+			s += "\t\t\tbracket.core = ss.capture_stack.back();\n\t\t\tss.capture_stack.pop_back();\n\t\t\t--bracket.counter;\n\t\t}\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_roundbracket_close:
+			uses_submatch_ = true;
+			s += "\t\t{\n\t\t\tsubmatch_type &bracket = ss.bracket[" + k + "];\n\n";
+			s += "\t\t\tif (bracket.core.open_at != ss.ssc.iter)\n\t\t\t{\n";
+			s += "\t\t\t\tbracket.core.close_at = ss.ssc.iter;\n\t\t\t\t" + go(st.next_state1()) + "\n\t\t\t}\n";
+			//  0 width match.
+			if (st.next_state1()->type != srell::re_detail::st_check_counter)
+			{
+				s += "\t\t\tif (bracket.counter > 1)\n\t\t\t\tgoto NOT_MATCHED;\n";
+				s += "\t\t\tbracket.core.close_at = ss.ssc.iter;\n\t\t}\n\t\t" + go(st.next_state2()) + "\n\n";
+			}
+			else
+			{
+				s += "\t\t\tif (ss.counter[" + to_string(st.next_state1()->char_num) + "] > " + to_string(st.next_state1()->quantifier.atleast) + "u)\n\t\t\t\tgoto NOT_MATCHED;\n";
+				s += "\t\t\tbracket.core.close_at = ss.ssc.iter;\n\t\t}\n\t\t" + go(st.next_state1()) + "\n\n";
+			}
+			break;
+
+		case srell::re_detail::st_repeat_in_push:
+			s += "\t\tss.repeat_stack.push_back(ss.repeat[" + k + "]);\n\t\tss.repeat[" + k + "] = ss.ssc.iter;\n";
+			if (st.quantifier.atleast <= st.quantifier.atmost)
+				uses_submatch_ = true;
+			s += push_inner(st, "\t\t");
+			s += "\t\t" + push(no) + "\n\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_repeat_in_pop:
+			if (st.quantifier.atleast <= st.quantifier.atmost)
+				uses_submatch_ = true;
+			s += pop_inner(st, "\t\t");
+			s += "\t\tss.repeat[" + k + "] = ss.repeat_stack.back();\n\t\tss.repeat_stack.pop_back();\n\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_check_0_width_repeat:
+			s += "\t\tif (ss.ssc.iter != ss.repeat[" + k + "])\n\t\t\t" + go(st.next_state1()) + "\n";
+			if (st.next_state1()->type == srell::re_detail::st_check_counter)
+			{
+				s += "\t\tif (ss.counter[" + to_string(st.next_state1()->char_num) + "] > " + to_string(st.next_state1()->quantifier.atleast) + "u)\n\t\t\tgoto NOT_MATCHED;\n";
+				s += "\t\t" + go(st.next_state1()) + "\n\n";
+			}
+			else
+				s += "\t\t" + go(st.next_state2()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_backreference:
+			uses_submatch_ = true;
+			s += "\t\t{\n\t\t\tconst submatch_type &bracket = ss.bracket[" + k + "];\n\n";
+			s += "\t\t\tif (bracket.counter == 0 || bracket.core.open_at == bracket.core.close_at)\n\t\t\t\t" + go(st.next_state2()) + "\n\n";
+			s += "\t\t\tfor (BidirectionalIterator backrefpos = bracket.core.open_at; backrefpos != bracket.core.close_at;)\n\t\t\t{\n";
+			if (!st.flags)
+			{
+				s += "\t\t\t\tif (ss.is_at_srchend() || *ss.ssc.iter++ != *backrefpos++)\n\t\t\t\t\tgoto NOT_MATCHED;\n";
+			}
+			else
+			{
+				s += "\t\t\t\tif (ss.is_at_srchend())\n\t\t\t\t\tgoto NOT_MATCHED;\n\n";
+				s += "\t\t\t\tconst srell::re_detail::ui_l32 uchartxt = utf_traits::codepoint_inc(ss.ssc.iter, ss.srchend);\n";
+				s += "\t\t\t\tconst srell::re_detail::ui_l32 ucharref = utf_traits::codepoint_inc(backrefpos, bracket.core.close_at);\n\n";
+				s += "\t\t\t\tif (srell::re_detail::unicode_case_folding::do_casefolding(uchartxt) != srell::re_detail::unicode_case_folding::do_casefolding(ucharref))\n\t\t\t\t\tgoto NOT_MATCHED;\n";
+			}
+			s += "\t\t\t}\n\t\t}\n\t\t" + go(st.next_state1()) + "\n\n";
+			break;
+
+		case srell::re_detail::st_bol:
+			s += "\t\tif (ss.is_at_lookbehindlimit() && !ss.is_prev_avail())\n\t\t{\n";
+			s += "\t\t\tif (!ss.match_not_bol_flag())\n\t\t\t\t" + go(st.next_state1()) + "\n\t\t}\n";
+			if (st.flags)	//  Multiline.
+				s += "\t\telse if (" + class_call(srell::re_detail::re_character_class::newline, "utf_traits::prevcodepoint(ss.ssc.iter, ss.reallblim)") + ")\n\t\t\t" + go(st.next_state1()) + "\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_eol:
+			s += "\t\tif (ss.is_at_srchend())\n\t\t{\n";
+			s += "\t\t\tif (!ss.match_not_eol_flag())\n\t\t\t\t" + go(st.next_state1()) + "\n\t\t}\n";
+			if (st.flags)	//  Multiline.
+				s += "\t\telse if (" + class_call(srell::re_detail::re_character_class::newline, "utf_traits::codepoint(ss.ssc.iter, ss.srchend)") + ")\n\t\t\t" + go(st.next_state1()) + "\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_boundary:
+			s += "\t\t{\n\t\t\tbool is_matched = " + std::string(st.flags ? "true" : "false") + ";\n\n";
+			s += "\t\t\tif (ss.is_at_srchend())\n\t\t\t{\n\t\t\t\tif (ss.match_not_eow_flag())\n\t\t\t\t\tis_matched = !is_matched;\n\t\t\t}\n";
+			s += "\t\t\telse if (" + class_call(st.char_num, "utf_traits::codepoint(ss.ssc.iter, ss.srchend)") + ")\n\t\t\t\tis_matched = !is_matched;\n\n";
+			s += "\t\t\tif (ss.is_at_lookbehindlimit() && !ss.is_prev_avail())\n\t\t\t{\n\t\t\t\tif (ss.match_not_bow_flag())\n\t\t\t\t\tis_matched = !is_matched;\n\t\t\t}\n";
+			s += "\t\t\telse if (" + class_call(st.char_num, "utf_traits::prevcodepoint(ss.ssc.iter, ss.reallblim)") + ")\n\t\t\t\tis_matched = !is_matched;\n\n";
+			s += "\t\t\tif (is_matched)\n\t\t\t\t" + go(st.next_state1()) + "\n\t\t}\n\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		case srell::re_detail::st_success:
+			s += "\t\tif ((!ss.match_not_null_flag() || !ss.is_null()) && (!ss.match_match_flag() || ss.is_at_srchend()))\n\t\t\treturn 1;\n";
+			s += "\t\tgoto NOT_MATCHED;\n\n";
+			break;
+
+		default:
+			message_ = st.type == srell::re_detail::st_lookaround_open || st.type == srell::re_detail::st_lookaround_pop
+				? "lookarounds are not supported"
+				: "unsupported state type " + to_string(st.type);
+			return false;
+		}
+		out += s;
+		return true;
+	}
+
+	std::string write_names() const
+	{
+		std::string body;
+
+		for (ui_l32 no = 1; no < re_.brackets(); ++no)
+		{
+			const std::vector<ui_l32> name(re_.group_name(no));
+
+			if (name.size())
+			{
+				std::string array;
+
+				for (std::size_t i = 0; i < name.size(); ++i)
+					array += (i ? ", " : "") + to_hex(name[i]);
+
+				body += "\t\tstatic const srell::re_detail::ui_l32 name" + to_string(no) + "[] = { " + array + " };\n";
+				body += "\t\tregexgen_detail::push_name<utf_traits>(gnames, name" + to_string(no) + ", " + to_string(static_cast<unsigned long>(name.size())) + ", " + to_string(no) + ");\n";
+			}
+		}
+
+		std::string out("#if !defined(SRELL_NO_NAMEDCAPTURE)\n\ttemplate <typename utf_traits, typename charT>\n");
+
+		out += "\tstatic void set_names_(srell::re_detail::groupname_mapper<charT> &" + std::string(body.size() ? "gnames" : "/* gnames */") + ")\n\t{\n";
+		out += body;
+		out += "\t}\n#endif\n\n";
+		return out;
+	}
+
+	std::string write_class(const ui_l32 no) const
+	{
+		const srell::re_detail::range_pairs ranges(re_.class_ranges(no));
+		std::string out("\tstatic bool class" + to_string(no) + "_(const srell::re_detail::ui_l32 c)\n\t{\n");
+
+		if (ranges.size() <= 8)
+		{
+			for (srell::re_detail::range_pairs::size_type i = 0; i < ranges.size(); ++i)
+			{
+				const srell::re_detail::range_pair &rp = ranges[i];
+
+				if (rp.first)
+					out += "\t\tif (c < " + to_hex(rp.first) + ")\n\t\t\treturn false;\n";
+				out += "\t\tif (c <= " + to_hex(rp.second) + ")\n\t\t\treturn true;\n";
+			}
+			out += "\t\treturn false;\n\t}\n\n";
+			return out;
+		}
+
+		out += "\t\tstatic const srell::re_detail::ui_l32 ranges[] = {";
+		for (srell::re_detail::range_pairs::size_type i = 0; i < ranges.size(); ++i)
+			out += std::string(i % 4 ? " " : "\n\t\t\t") + to_hex(ranges[i].first) + ", " + to_hex(ranges[i].second) + ",";
+		out.erase(out.size() - 1);
+		out += "\n\t\t};\n";
+		out += "\t\treturn regexgen_detail::is_included(ranges, " + to_string(static_cast<unsigned long>(ranges.size())) + ", c);\n\t}\n\n";
+		return out;
+	}
+
+	const compiled_regex &re_;
+	const pattern_entry &pe_;
+	std::vector<bool> queued_;
+	std::vector<ui_l32> queue_;
+	std::vector<ui_l32> pushers_;
+	std::vector<ui_l32> classes_;
+	std::string message_;
+	bool uses_counter_;
+	bool uses_submatch_;
+};
+//  matcher_writer
+
+//  Code shared by the matchers, written once at the top of the header.
+static const char *const prelude =
+	"namespace regexgen_detail\n"
+	"{\n"
+	"template <typename BidirectionalIterator>\n"
+	"struct frame\n"
+	"{\n"
+	"\tsrell::re_detail::ui_l32 state;\n"
+	"\tBidirectionalIterator iter;\n"
+	"\n"
+	"\tframe(const srell::re_detail::ui_l32 s, const BidirectionalIterator i) : state(s), iter(i)\n"
+	"\t{\n"
+	"\t}\n"
+	"};\n"
+	"\n"
+	"//  The encoding is chosen by the size of a code unit, as u8cregex,\n"
+	"//  u16regex and u32regex do.\n"
+	"template <typename charT, std::size_t = sizeof (charT)>\n"
+	"struct utf_traits_for\n"
+	"{\n"
+	"\ttypedef srell::re_detail::utf_traits<charT> type;\n"
+	"};\n"
+	"\n"
+	"template <typename charT>\n"
+	"struct utf_traits_for<charT, 1>\n"
+	"{\n"
+	"\ttypedef srell::re_detail::utf8_traits<charT> type;\n"
+	"};\n"
+	"\n"
+	"template <typename charT>\n"
+	"struct utf_traits_for<charT, 2>\n"
+	"{\n"
+	"\ttypedef srell::re_detail::utf16_traits<charT> type;\n"
+	"};\n"
+	"\n"
+	"inline bool is_included(const srell::re_detail::ui_l32 *const ranges, std::size_t size, const srell::re_detail::ui_l32 c)\n"
+	"{\n"
+	"\tfor (std::size_t base = 0; size;)\n"
+	"\t{\n"
+	"\t\tconst std::size_t mid = base + size / 2;\n"
+	"\n"
+	"\t\tif (c < ranges[mid * 2])\n"
+	"\t\t\tsize = mid - base;\n"
+	"\t\telse if (c > ranges[mid * 2 + 1])\n"
+	"\t\t{\n"
+	"\t\t\tsize -= mid + 1 - base;\n"
+	"\t\t\tbase = mid + 1;\n"
+	"\t\t}\n"
+	"\t\telse\n"
+	"\t\t\treturn true;\n"
+	"\t}\n"
+	"\treturn false;\n"
+	"}\n"
+	"\n"
+	"//  Returns 0, or the error to stop the search with.\n"
+	"template <typename SearchState>\n"
+	"int count_failure(SearchState &ss)\n"
+	"{\n"
+	"#if !defined(SRELL_NO_LIMIT_COUNTER)\n"
+	"\tif (--ss.failure_counter == 0)\n"
+	"\t{\n"
+	"\t\tif (!ss.failure_reserve)\n"
+	"#if defined(SRELL_NO_THROW)\n"
+	"\t\t\treturn static_cast<int>(srell::regex_constants::error_complexity);\n"
+	"#else\n"
+	"\t\t\tthrow srell::regex_error(srell::regex_constants::error_complexity);\n"
+	"#endif\n"
+	"\t\tif (ss.interrupter->interrupted())\n"
+	"#if defined(SRELL_NO_THROW)\n"
+	"\t\t\treturn static_cast<int>(srell::regex_constants::error_timeout);\n"
+	"#else\n"
+	"\t\t\tthrow srell::regex_error(srell::regex_constants::error_timeout);\n"
+	"#endif\n"
+	"\t\tss.refill_failure_counter();\n"
+	"\t}\n"
+	"#else\n"
+	"\tstatic_cast<void>(ss);\n"
+	"#endif\n"
+	"\treturn 0;\n"
+	"}\n"
+	"\n"
+	"#if !defined(SRELL_NO_NAMEDCAPTURE)\n"
+	"template <typename utf_traits, typename charT>\n"
+	"void push_name(srell::re_detail::groupname_mapper<charT> &gnames, const srell::re_detail::ui_l32 *const name, const std::size_t len, const srell::re_detail::ui_l32 number)\n"
+	"{\n"
+	"\ttypename srell::re_detail::groupname_mapper<charT>::gname_string gname;\n"
+	"\tcharT seq[utf_traits::maxseqlen];\n"
+	"\n"
+	"\tfor (std::size_t i = 0; i < len; ++i)\n"
+	"\t{\n"
+	"\t\tconst srell::re_detail::ui_l32 seqlen = utf_traits::to_codeunits(seq, name[i]);\n"
+	"\n"
+	"\t\tfor (srell::re_detail::ui_l32 j = 0; j < seqlen; ++j)\n"
+	"\t\t\tgname.push_back(seq[j]);\n"
+	"\t}\n"
+	"\tgnames.push_back(gname, number);\n"
+	"}\n"
+	"#endif\n"
+	"\n"
+	"//  Does what re_object::search() does, with Pattern::run_() in place of\n"
+	"//  the automaton.\n"
+	"template <typename Pattern, typename BidirectionalIterator, typename Allocator>\n"
+	"bool search(\n"
+	"\tconst BidirectionalIterator begin,\n"
+	"\tconst BidirectionalIterator end,\n"
+	"\tconst BidirectionalIterator lookbehind_limit,\n"
+	"\tsrell::match_results<BidirectionalIterator, Allocator> &m,\n"
+	"\tconst srell::regex_constants::match_flag_type flags)\n"
+	"{\n"
+	"\ttypedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;\n"
+	"\ttypedef typename utf_traits_for<char_type>::type utf_traits;\n"
+	"\tsrell::re_detail::re_search_state<BidirectionalIterator> &ss = m.sstate_;\n"
+	"\tstd::vector<frame<BidirectionalIterator> > bt;\n"
+	"\tint reason = 0;\n"
+	"\n"
+	"\tm.clear_();\n"
+	"\tss.init(begin, end, lookbehind_limit, flags);\n"
+	"\tss.init_for_automaton(Pattern::number_of_brackets, Pattern::number_of_counters, Pattern::number_of_repeats);\n"
+	"\tss.entry_state = NULL;\n"
+	"\n"
+	"\tfor (;;)\n"
+	"\t{\n"
+	"\t\tconst bool final = ss.nextpos == ss.srchend || ss.match_continuous_flag();\n"
+	"\n"
+	"\t\tss.ssc.iter = ss.nextpos;\n"
+	"\t\tif (!final)\n"
+	"\t\t\tutf_traits::codepoint_inc(ss.nextpos, ss.srchend);\n"
+	"\n"
+	"\t\tif (ss.is_interrupted())\n"
+	"#if defined(SRELL_NO_THROW)\n"
+	"\t\t\treturn m.mark_as_failed_(static_cast<int>(srell::regex_constants::error_timeout));\n"
+	"#else\n"
+	"\t\t\tthrow srell::regex_error(srell::regex_constants::error_timeout);\n"
+	"#endif\n"
+	"\n"
+	"#if defined(SRELL_NO_LIMIT_COUNTER)\n"
+	"\t\tss.reset();\n"
+	"#else\n"
+	"\t\tss.reset(Pattern::limit_counter);\n"
+	"#endif\n"
+	"\t\treason = Pattern::template run_<utf_traits>(ss, bt, ss.match_continuous_flag());\n"
+	"\t\tif (reason || final)\n"
+	"\t\t\tbreak;\n"
+	"\t}\n"
+	"\n"
+	"\tif (reason == 1)\n"
+	"\t{\n"
+	"#if !defined(SRELL_NO_NAMEDCAPTURE)\n"
+	"\t\tsrell::re_detail::groupname_mapper<char_type> gnames;\n"
+	"\n"
+	"\t\tPattern::template set_names_<utf_traits>(gnames);\n"
+	"\t\treturn m.set_match_results_(gnames);\n"
+	"#else\n"
+	"\t\treturn m.set_match_results_();\n"
+	"#endif\n"
+	"\t}\n"
+	"\treturn m.mark_as_failed_(reason);\n"
+	"}\n"
+	"\n"
+	"//  The interface of basic_regex for searching, given to each pattern.\n"
+	"template <typename Pattern>\n"
+	"struct matcher\n"
+	"{\n"
+	"\ttemplate <typename BidirectionalIterator, typename Allocator>\n"
+	"\tstatic bool search(\n"
+	"\t\tconst BidirectionalIterator begin,\n"
+	"\t\tconst BidirectionalIterator end,\n"
+	"\t\tconst BidirectionalIterator lookbehind_limit,\n"
+	"\t\tsrell::match_results<BidirectionalIterator, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn regexgen_detail::search<Pattern>(begin, end, lookbehind_limit, m, flags);\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename BidirectionalIterator, typename Allocator>\n"
+	"\tstatic bool search(\n"
+	"\t\tconst BidirectionalIterator begin,\n"
+	"\t\tconst BidirectionalIterator end,\n"
+	"\t\tsrell::match_results<BidirectionalIterator, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn regexgen_detail::search<Pattern>(begin, end, begin, m, flags);\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename charT, typename Allocator>\n"
+	"\tstatic bool search(\n"
+	"\t\tconst charT *const str,\n"
+	"\t\tsrell::match_results<const charT *, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn search(str, str + std::char_traits<charT>::length(str), m, flags);\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename charT, typename ST, typename SA, typename Allocator>\n"
+	"\tstatic bool search(\n"
+	"\t\tconst std::basic_string<charT, ST, SA> &s,\n"
+	"\t\tsrell::match_results<typename std::basic_string<charT, ST, SA>::const_iterator, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn search(s.begin(), s.end(), m, flags);\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename BidirectionalIterator, typename Allocator>\n"
+	"\tstatic bool match(\n"
+	"\t\tconst BidirectionalIterator begin,\n"
+	"\t\tconst BidirectionalIterator end,\n"
+	"\t\tsrell::match_results<BidirectionalIterator, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn regexgen_detail::search<Pattern>(begin, end, begin, m, flags | srell::regex_constants::match_continuous | srell::regex_constants::match_match_);\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename charT, typename ST, typename SA, typename Allocator>\n"
+	"\tstatic bool match(\n"
+	"\t\tconst std::basic_string<charT, ST, SA> &s,\n"
+	"\t\tsrell::match_results<typename std::basic_string<charT, ST, SA>::const_iterator, Allocator> &m,\n"
+	"\t\tconst srell::regex_constants::match_flag_type flags = srell::regex_constants::match_default)\n"
+	"\t{\n"
+	"\t\treturn match(s.begin(), s.end(), m, flags);\n"
+	"\t}\n"
+	"};\n"
+	"}\n"
+	"//  namespace regexgen_detail\n"
+	"\n";
+
+bool is_identifier(const std::string &name)
+{
+	if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+		return false;
+
+	for (std::string::size_type i = 0; i < name.size(); ++i)
+	{
+		const char c = name[i];
+
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+			return false;
+	}
+	return true;
+}
+
+//  Each line is "name /expression/flags". Empty lines and lines beginning
+//  with '#' are ignored.
+bool parse_list(std::vector<pattern_entry> &entries, const std::string &list)
+{
+	unsigned int line = 0;
+
+	for (std::string::size_type pos = 0; pos < list.size();)
+	{
+		std::string::size_type eol = list.find('\n', pos);
+
+		if (eol == std::string::npos)
+			eol = list.size();
+
+		std::string text(list, pos, eol - pos);
+
+		pos = eol + 1;
+		++line;
+
+		if (text.size() && text[text.size() - 1] == '\r')
+			text.erase(text.size() - 1);
+
+		if (text.empty() || text[0] == '#')
+			continue;
+
+		const std::string::size_type namelen = text.find_first_of(" \t");
+		const std::string::size_type open = text.find('/', namelen);
+		const std::string::size_type close = text.rfind('/');
+		pattern_entry pe;
+
+		if (namelen == std::string::npos || open == std::string::npos || close == open)
+		{
+			std::fprintf(stdout, "[Error] line %u: \"name /expression/flags\" expected.\n", line);
+			return false;
+		}
+
+		pe.name.assign(text, 0, namelen);
+		pe.source.assign(text, open, std::string::npos);
+		pe.expression.assign(text, open + 1, close - open - 1);
+		pe.options = srell::regex_constants::ECMAScript;
+		pe.line = line;
+
+		if (!is_identifier(pe.name))
+		{
+			std::fprintf(stdout, "[Error] line %u: \"%s\" is not an identifier.\n", line, pe.name.c_str());
+			return false;
+		}
+
+		for (std::vector<pattern_entry>::size_type i = 0; i < entries.size(); ++i)
+		{
+			if (entries[i].name == pe.name)
+			{
+				std::fprintf(stdout, "[Error] line %u: \"%s\" already appeared in line %u.\n", line, pe.name.c_str(), entries[i].line);
+				return false;
+			}
+		}
+
+		for (std::string::size_type i = close + 1; i < text.size(); ++i)
+		{
+			switch (text[i])
+			{
+			case 'i':
+				pe.options |= srell::regex_constants::icase;
+				break;
+			case 'm':
+				pe.options |= srell::regex_constants::multiline;
+				break;
+			case 's':
+				pe.options |= srell::regex_constants::dotall;
+				break;
+			case 'v':
+				pe.options |= srell::regex_constants::unicodesets;
+				break;
+			case 'a':
+				pe.options |= srell::regex_constants::atomic;
+				break;
+			default:
+				std::fprintf(stdout, "[Error] line %u: unknown flag '%c'.\n", line, text[i]);
+				return false;
+			}
+		}
+		entries.push_back(pe);
+	}
+	return true;
+}
+
+struct regexgen_options
+{
+	const char *infilename;
+	const char *outfilename;
+	const char *nsname;
+	const char *srellpath;
+	int errorno;
+
+	regexgen_options(const int argc, const char *const *const argv)
+		: infilename(NULL)
+		, outfilename("srell_patterns.h")
+		, nsname("srell_patterns")
+		, srellpath("srell.hpp")
+		, errorno(0)
+	{
+		for (int index = 1; index < argc; ++index)
+		{
+			const char firstchar = argv[index][0];
+
+			if (firstchar == '-' || firstchar == '/')
+			{
+				const char *const option = argv[index] + 1;
+
+				if (++index >= argc)
+				{
+					std::fprintf(stdout, "[Error] No argument for \"%s\" specified.\n", argv[index - 1]);
+					goto PRINT_USAGE;
+				}
+
+				if (std::strcmp(option, "o") == 0)
+					outfilename = argv[index];
+				else if (std::strcmp(option, "n") == 0)
+					nsname = argv[index];
+				else if (std::strcmp(option, "I") == 0)
+					srellpath = argv[index];
+				else
+				{
+					std::fprintf(stdout, "[Error] Unknown option \"%s\" found.\n", argv[index - 1]);
+					goto PRINT_USAGE;
+				}
+			}
+			else
+				infilename = argv[index];
+		}
+
+		if (infilename && is_identifier(nsname))
+			return;
+
+		PRINT_USAGE:
+		std::fputs("Usage: regexgen [options] listfile\n", stdout);
+		std::fputs("    -o file       output file (default: srell_patterns.h)\n", stdout);
+		std::fputs("    -n namespace  namespace of the matchers (default: srell_patterns)\n", stdout);
+		std::fputs("    -I path       path written in #include for srell.hpp (default: srell.hpp)\n", stdout);
+		errorno = 1;
+	}
+};
+//  regexgen_options
+
+int generate(std::string &out, const regexgen_options &opts)
+{
+	std::string list;
+	std::vector<pattern_entry> entries;
+
+	if (!read_file(list, opts.infilename))
+		return 2;
+
+	if (!parse_list(entries, list))
+		return 1;
+
+	std::string guard(opts.nsname);
+
+	for (std::string::size_type i = 0; i < guard.size(); ++i)
+		if (guard[i] >= 'a' && guard[i] <= 'z')
+			guard[i] = static_cast<char>(guard[i] - 'a' + 'A');
+	guard += "_H_INCLUDED";
+
+	out = "//  Generated by regexgen from \"";
+	out += opts.infilename;
+	out += "\". Do not edit.\n\n#ifndef " + guard + "\n#define " + guard + "\n\n";
+	out += "#include <cstddef>\n#include <iterator>\n#include <string>\n#include <vector>\n";
+	out += "#include \"" + std::string(opts.srellpath) + "\"\n\n";
+	out += "namespace " + std::string(opts.nsname) + "\n{\n";
+	out += prelude;
+
+	for (std::vector<pattern_entry>::size_type i = 0; i < entries.size(); ++i)
+	{
+		const pattern_entry &pe = entries[i];
+		compiled_regex re;
+		std::string message;
+
+#if defined(SRELL_NO_THROW)
+		re.assign(pe.expression, pe.options);
+		if (re.ecode())
+		{
+			std::fprintf(stdout, "[Error] line %u: error %d in compiling %s.\n", pe.line, re.ecode(), pe.source.c_str());
+			return 1;
+		}
+#else
+		try
+		{
+			re.assign(pe.expression, pe.options);
+		}
+		catch (const srell::regex_error &e)
+		{
+			std::fprintf(stdout, "[Error] line %u: error %d in compiling %s.\n", pe.line, e.code(), pe.source.c_str());
+			return 1;
+		}
+#endif
+
+		const std::string matcher(matcher_writer(re, pe).write(message));
+
+		if (matcher.empty())
+		{
+			std::fprintf(stdout, "[Error] line %u: %s: %s.\n", pe.line, pe.source.c_str(), message.c_str());
+			return 1;
+		}
+		out += matcher;
+	}
+
+	out += "}\n//  namespace " + std::string(opts.nsname) + "\n#endif\t//  " + guard + "\n";
+	return 0;
+}
+
+}	//  namespace regexgen
+
+int main(const int argc, const char *const *const argv)
+{
+	regexgen::regexgen_options opts(argc, argv);
+	std::string outdata;
+	int errorno = opts.errorno;
+
+	if (errorno == 0)
+		errorno = regexgen::generate(outdata, opts);
+
+	if (errorno == 0)
+	{
+		if (!regexgen::write_file(opts.outfilename, outdata))
+			errorno = 2;
+	}
+	return errorno;
+}
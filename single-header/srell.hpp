@@ -47,6 +47,10 @@
 #include <iterator>
 #include <memory>
 #include <algorithm>
+#if (defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#include <atomic>
+#include <chrono>
+#endif
 
 #ifdef __cpp_unicode_characters
   #ifndef SRELL_CPP11_CHAR1632_ENABLED
@@ -69,6 +73,17 @@
   #else
   #define SRELL_NOEXCEPT noexcept
   #endif
+  #define SRELL_FORWARDING_REF &&
+#else
+  #define SRELL_FORWARDING_REF const &
+#endif
+#if (defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+  #ifndef SRELL_CPP11_ATOMIC_ENABLED
+  #define SRELL_CPP11_ATOMIC_ENABLED
+  #endif
+  #ifndef SRELL_CPP11_CHRONO_ENABLED
+  #define SRELL_CPP11_CHRONO_ENABLED
+  #endif
 #endif
 #ifdef __cpp_char8_t
   #ifndef SRELL_CPP20_CHAR8_ENABLED
@@ -79,6 +94,14 @@
 	#endif
   #endif
 #endif
+//  Labels as values of GCC and Clang let the automaton jump to the code
+//  for the next state directly, not via the bounds check and the single
+//  indirect branch of switch.
+#if defined(__GNUC__) && !defined(SRELL_NO_COMPUTED_GOTO)
+  #ifndef SRELL_GNU_COMPUTED_GOTO_ENABLED
+  #define SRELL_GNU_COMPUTED_GOTO_ENABLED
+  #endif
+#endif
 
 //  The following SRELL_NO_* macros would be useful when wanting to
 //  reduce the size of a binary by turning off some feature(s).
@@ -142,7 +165,9 @@ namespace srell
 
 			//  SRELL's extension.
 			dotall      = 1 << 11,	//  singleline.
-			unicodesets = 1 << 12
+			unicodesets = 1 << 12,
+			noredos     = 1 << 13,	//  Rejects expressions at risk of exponential backtracking.
+			atomic      = 1 << 14	//  Enables (?>...) and possessive quantifiers (*+, ++, ?+, {n,m}+).
 		};
 
 		inline syntax_option_type operator&(const syntax_option_type left, const syntax_option_type right)
@@ -276,10 +301,29 @@ namespace srell
 			//  A specific flag modifier appeared more then once, or the un-bounded form
 			//  ((?ism-ism)) appeared at a position other than the beginning of the expression.
 
+		static const error_type error_timeout    = 119;
+			//  A search was stopped because the interrupt_checker passed to it returned true
+			//  (the deadline was reached or the search was cancelled).
+
 #if defined(SRELL_FIXEDWIDTHLOOKBEHIND)
 		static const error_type error_lookbehind = 200;
 #endif
 		static const error_type error_internal   = 999;
+
+		//  SRELL's extension.
+		//  Levels returned by basic_regex::backtracking_risk().
+		typedef int risk_type;
+
+		static const risk_type risk_none        = 0;
+			//  No loop in the expression was found to backtrack excessively.
+
+		static const risk_type risk_polynomial  = 1;
+			//  Two adjacent loops can split the same run of characters in many ways,
+			//  such as .*.*= or \d+\d+. The cost of a failing match grows polynomially.
+
+		static const risk_type risk_exponential = 2;
+			//  A loop contains a nested loop or alternatives that can match the same
+			//  characters, such as (a+)+ or (\w|\d)*. The cost grows exponentially.
 	}
 	//  namespace regex_constants
 
@@ -308,6 +352,148 @@ private:
 };
 
 //  ... "regex_error.hpp"]
+//  ["regex_interrupt.hpp" ...
+
+//  Base class of objects that tell a running search to give up.
+//  interrupted() is called at intervals during the search, and once it
+//  returns true the search is stopped with regex_constants::error_timeout.
+//  The regex object itself is not affected and can be used continuously.
+class interrupt_checker
+{
+public:
+
+	virtual ~interrupt_checker()
+	{
+	}
+
+	virtual bool interrupted() = 0;
+};
+
+//  Stops searches after cancel() is called, possibly by another thread.
+class cancellation_token : public interrupt_checker
+{
+public:
+
+	cancellation_token() : cancelled_(false)
+	{
+	}
+
+	void cancel()
+	{
+		cancelled_ = true;
+	}
+
+	void reset()
+	{
+		cancelled_ = false;
+	}
+
+	bool interrupted()
+	{
+#if defined(SRELL_CPP11_ATOMIC_ENABLED)
+		return cancelled_.load(std::memory_order_relaxed);
+#else
+		return cancelled_;
+#endif
+	}
+
+private:
+
+#if defined(SRELL_CPP11_ATOMIC_ENABLED)
+	std::atomic<bool> cancelled_;
+#else
+	volatile bool cancelled_;
+#endif
+};
+
+#if defined(SRELL_CPP11_CHRONO_ENABLED)
+
+//  Stops searches once std::chrono::steady_clock reaches the deadline.
+class search_deadline : public interrupt_checker
+{
+public:
+
+	typedef std::chrono::steady_clock clock_type;
+
+	explicit search_deadline(const clock_type::time_point tp) : deadline_(tp)
+	{
+	}
+
+	template <class Rep, class Period>
+	explicit search_deadline(const std::chrono::duration<Rep, Period> &budget)
+		: deadline_(clock_type::now() + std::chrono::duration_cast<clock_type::duration>(budget))
+	{
+	}
+
+	bool interrupted()
+	{
+		return clock_type::now() >= deadline_;
+	}
+
+private:
+
+	clock_type::time_point deadline_;
+};
+
+#endif	//  defined(SRELL_CPP11_CHRONO_ENABLED)
+
+//  ... "regex_interrupt.hpp"]
+//  ["regex_stats.hpp" ...
+
+#if defined(SRELL_ENABLE_STATS)
+
+//  Counters collected during a search, returned by match_results::stats().
+//  The number of the steps counted against limit_counter is returned by
+//  match_results::steps_consumed().
+struct search_statistics
+{
+	std::size_t firstchar_skips;	//  Positions skipped by the first character check.
+	std::size_t bmh_skips;	//  Positions skipped by the Boyer-Moore-Horspool search.
+	std::size_t automaton_runs;	//  Positions at which the automaton was run.
+	std::size_t backtracks;
+	std::size_t max_btstack_depth;
+	std::size_t lookarounds;	//  Lookaround assertions evaluated.
+
+	search_statistics()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		firstchar_skips = 0;
+		bmh_skips = 0;
+		automaton_runs = 0;
+		backtracks = 0;
+		max_btstack_depth = 0;
+		lookarounds = 0;
+	}
+};
+
+#endif	//  defined(SRELL_ENABLE_STATS)
+
+#if defined(SRELL_ENABLE_PROFILER)
+
+//  How many times each state of the automaton was entered and how many
+//  times it failed, indexed by the state number. Returned by
+//  match_results::profile() and accumulated over the searches done with
+//  the same match_results until clear_profile() is called.
+//  basic_regex::profile_report() maps the states to the expression.
+struct search_profile
+{
+	std::vector<std::size_t> entries;
+	std::vector<std::size_t> failures;
+
+	void clear()
+	{
+		entries.clear();
+		failures.clear();
+	}
+};
+
+#endif	//  defined(SRELL_ENABLE_PROFILER)
+
+//  ... "regex_stats.hpp"]
 //  ["rei_type.h" ...
 
 	namespace re_detail
@@ -328,6 +514,16 @@ private:
 #else
 #error could not find a suitable type for 32-bit Unicode integer values.
 #endif	//  defined(SRELL_CPP11_CHAR1632_ENABLED)
+
+#if defined(INT_MAX) && INT_MAX >= 0x7FFFFFFF
+
+		typedef int si_l32;	//  int_least32.
+
+#else
+
+		typedef long si_l32;
+
+#endif
 	}	//  namespace re_detail
 
 //  ... "rei_type.h"]
@@ -368,8 +564,15 @@ private:
 
 			st_success,                 //  0x13
 
+			st_string,                  //  0x14
+
+			st_repeat_atom,             //  0x15
+			st_repeat_atom_pop,         //  0x16
+
+			st_character_switch,        //  0x17
+
 #if defined(SRELLTEST_NEXTPOS_OPT)
-			st_move_nextpos,            //  0x14
+			st_move_nextpos,            //  0x18
 #endif
 
 			st_lookaround_close        = st_success,
@@ -385,6 +588,9 @@ private:
 			static const ui_l32 ccstr_empty = static_cast<ui_l32>(-1);
 			static const ui_l32 infinity = static_cast<ui_l32>(~0);
 			static const ui_l32 pos_charbits = 21;
+			static const std::size_t interrupt_interval = 0x1000;
+			static const std::size_t interrupt_scanblock = 0x10000;
+			static const ui_l32 risky_repeat_count = 10;
 		}
 		//  constants
 
@@ -402,8 +608,13 @@ private:
 			static const ui_l32 icase = 1;
 			static const ui_l32 multiline = 1;
 			static const ui_l32 backrefno_unresolved = 1 << 1;
+			static const ui_l32 eol_anchored = 1 << 1;
 			static const ui_l32 hooking = 1 << 2;
+			static const ui_l32 leading_dotstar = 1 << 2;
 			static const ui_l32 hooked = 1 << 3;
+			static const ui_l32 leading_anystar = 1 << 3;
+			static const ui_l32 within_line = 1 << 4;
+			static const ui_l32 loopno_shift = 4;
 		}
 		//  sflags
 
@@ -14656,6 +14867,51 @@ public:
 		return srcsize;
 	}
 
+#if !defined(SRELLDBG_NO_SMALLCC)
+
+	//  For small class functions. Each range is kept as (first, second - first)
+	//  and the ranges are padded to 1, 2, 4, or 8 with copies of the last one,
+	//  so that all of them are tested at once without branching.
+
+	bool is_included_sm(const ui_l32 pos, const ui_l32 len, const ui_l32 c) const
+	{
+		const range_pair *const base = &rparray_[pos];
+
+		switch (len)
+		{
+		case 1:
+			return c - base[0].first <= base[0].second;
+		case 2:
+			return is_included_sm<2>(base, c);
+		case 4:
+			return is_included_sm<4>(base, c);
+		default:
+			return is_included_sm<8>(base, c);
+		}
+	}
+
+	ui_l32 create_sm(const range_pair *srcbase, const ui_l32 srcsize)
+	{
+		const ui_l32 basepos = static_cast<ui_l32>(rparray_.size());
+		ui_l32 padded = 1;
+
+		while (padded < srcsize)
+			padded <<= 1;
+
+		rparray_.resize(basepos + padded);
+		for (ui_l32 i = 0; i < padded; ++i)
+		{
+			const range_pair &src = srcbase[i < srcsize ? i : srcsize - 1];
+			range_pair &dest = rparray_[basepos + i];
+
+			dest.first = src.first;
+			dest.second = src.second - src.first;
+		}
+		return padded;
+	}
+
+#endif	//  !defined(SRELLDBG_NO_SMALLCC)
+
 #endif	//  !defined(SRELLDBG_NO_CCPOS)
 
 	ui_l32 total_codepoints() const
@@ -14675,6 +14931,21 @@ private:
 
 #if !defined(SRELLDBG_NO_CCPOS)
 
+#if !defined(SRELLDBG_NO_SMALLCC)
+
+	template <const ui_l32 N>
+	static bool is_included_sm(const range_pair *const base, const ui_l32 c)
+	{
+		ui_l32 hits = 0u;
+
+		for (ui_l32 i = 0; i < N; ++i)
+			hits |= (c - base[i].first <= base[i].second) ? 1u : 0u;
+
+		return hits != 0u;
+	}
+
+#endif
+
 	ui_l32 set_eytzinger_layout(ui_l32 srcpos, const range_pair *const srcbase, const ui_l32 srclen,
 		range_pair *const destbase, const ui_l32 destpos)
 	{
@@ -14813,6 +15084,9 @@ public:
 #if !defined(SRELLDBG_NO_CCPOS)
 			this->char_class_el_ = that.char_class_el_;
 			this->char_class_pos_el_ = that.char_class_pos_el_;
+#if !defined(SRELLDBG_NO_SMALLCC)
+			this->char_class_bm_ = that.char_class_bm_;
+#endif
 #endif
 		}
 		return *this;
@@ -14828,6 +15102,9 @@ public:
 #if !defined(SRELLDBG_NO_CCPOS)
 			this->char_class_el_ = std::move(that.char_class_el_);
 			this->char_class_pos_el_ = std::move(that.char_class_pos_el_);
+#if !defined(SRELLDBG_NO_SMALLCC)
+			this->char_class_bm_ = std::move(that.char_class_bm_);
+#endif
 #endif
 		}
 		return *this;
@@ -14843,9 +15120,17 @@ public:
 	}
 
 #if !defined(SRELLDBG_NO_CCPOS)
+	//  pos and len are what charclasspos() returns.
 	bool is_included(const ui_l32 pos, const ui_l32 len, const ui_l32 c) const
 	{
-			return char_class_el_.is_included_el(pos, len, c);
+#if !defined(SRELLDBG_NO_SMALLCC)
+		if (len & bitmap_layout)
+			return c < 0x100 && ((char_class_bm_[pos + (c >> 5)] >> (c & 31)) & 1u) != 0u;
+
+		if (len & smallrange_layout)
+			return char_class_el_.is_included_sm(pos, len & ~smallrange_layout, c);
+#endif
+		return char_class_el_.is_included_el(pos, len, c);
 	}
 #endif
 
@@ -14888,6 +15173,9 @@ public:
 #if !defined(SRELLDBG_NO_CCPOS)
 		char_class_el_.clear();
 		char_class_pos_el_.clear();
+#if !defined(SRELLDBG_NO_SMALLCC)
+		char_class_bm_.clear();
+#endif
 #endif
 	}
 
@@ -14928,8 +15216,34 @@ public:
 
 			if (posinfo.second > 0)
 			{
-				elpos.first = static_cast<ui_l32>(char_class_el_.size());
-				elpos.second = char_class_el_.create_el(&char_class_[posinfo.first], posinfo.second);
+				const range_pair *const ranges = &char_class_[posinfo.first];
+
+#if !defined(SRELLDBG_NO_SMALLCC)
+				//  A class within Latin-1 consisting of more than one range
+				//  is tested with a bitmap, one consisting of up to 8 ranges
+				//  with the ranges all at once, and any other class with a
+				//  binary search on the Eytzinger layout.
+				if (posinfo.second > 1 && ranges[posinfo.second - 1].second < 0x100)
+				{
+					elpos.first = static_cast<ui_l32>(char_class_bm_.size());
+					elpos.second = bitmap_layout;
+					char_class_bm_.resize(elpos.first + 8, 0u);
+
+					for (ui_l32 i = 0; i < posinfo.second; ++i)
+						for (ui_l32 c = ranges[i].first; c <= ranges[i].second; ++c)
+							char_class_bm_[elpos.first + (c >> 5)] |= static_cast<ui_l32>(1) << (c & 31);
+				}
+				else if (posinfo.second <= 8)
+				{
+					elpos.first = static_cast<ui_l32>(char_class_el_.size());
+					elpos.second = char_class_el_.create_sm(ranges, posinfo.second) | smallrange_layout;
+				}
+				else
+#endif
+				{
+					elpos.first = static_cast<ui_l32>(char_class_el_.size());
+					elpos.second = char_class_el_.create_el(ranges, posinfo.second);
+				}
 			}
 		}
 		return elpos;
@@ -14938,6 +15252,9 @@ public:
 	void finalise()
 	{
 		char_class_el_.clear();
+#if !defined(SRELLDBG_NO_SMALLCC)
+		char_class_bm_.clear();
+#endif
 		char_class_pos_el_.resize(char_class_pos_.size());
 		std::memset(&char_class_pos_el_[0], 0, char_class_pos_el_.size() * sizeof (range_pairs::array_type::value_type));
 	}
@@ -15014,6 +15331,9 @@ public:
 #if !defined(SRELLDBG_NO_CCPOS)
 			this->char_class_el_.swap(right.char_class_el_);
 			this->char_class_pos_el_.swap(right.char_class_pos_el_);
+#if !defined(SRELLDBG_NO_SMALLCC)
+			this->char_class_bm_.swap(right.char_class_bm_);
+#endif
 #endif
 		}
 	}
@@ -15118,6 +15438,13 @@ private:
 	range_pairs char_class_el_;
 	range_pairs::array_type char_class_pos_el_;
 
+#if !defined(SRELLDBG_NO_SMALLCC)
+	simple_array<ui_l32> char_class_bm_;
+
+	//  Flags set in the length returned by charclasspos().
+	static const ui_l32 smallrange_layout = 0x40000000;
+	static const ui_l32 bitmap_layout = 0x80000000;
+#endif
 #endif
 
 #if !defined(SRELL_NO_UNICODE_PROPERTY)
@@ -15295,6 +15622,11 @@ struct re_quantifier
 	//    minimum and maximum bracket numbers respectively inside the repetition.
 	//  (Special case 4) in lookaround_open and lookaround_pop atleast and atmost represent the
 	//    minimum and maximum bracket numbers respectively inside the lookaround.
+	//  (Special case 5) in string atleast and atmost represent the number of its code units.
+	//  (Special case 6) in repeat_atom atleast and atmost are as in character_class, and
+	//    is_greedy is 0 if the repeat never gives back what it has consumed.
+	//    In repeat_atom_pop of a bounded one, they are the minimum and maximum.
+	//  (Special case 7) in character_switch atleast and atmost represent the number of its cases.
 
 	ui_l32 atleast;
 
@@ -15412,32 +15744,39 @@ struct re_state
 	ui_l32 char_num;
 		//  character: for character.
 		//  number: for character_class, brackets, counter, repeat, backreference.
+		//  offset: for string, of its code units in re_object_core::strings.
+		//  offset: for character_switch, of its cases in re_object_core::switch_cases.
+		//  character, excluded character, or class number: for repeat_atom.
 		//  (Special case) in [0] represents a code unit for finding an entry point if
 		//    the firstchar class consists of a single code unit; otherwise invalid_u32value.
 
 	re_state_type type;
 
-	union
-	{
-		std::ptrdiff_t next1;
-		re_state *next_state1;
+	//  Jumps are relative to the state itself and 32-bit, so that the four
+	//  members read for every state fit in 16 bytes, followed by the ones
+	//  read only for some types.
+
+	si_l32 next1;
+		//  0 means none, except in character and character_class where it is
+		//    a loop to the state itself.
 		//  (Special case 1) in lookaround_open points to the next of lookaround_close.
 		//  (Special case 2) in lookaround_pop points to the content of brackets instead of lookaround_open.
-	};
-	union
-	{
-		std::ptrdiff_t next2;
-		re_state *next_state2;
+
+	si_l32 next2;
+		//  0 means none.
 		//  character and character_class: points to another possibility, non-backtracking.
 		//  epsilon: points to another possibility, backtracking.
 		//  save_and_reset_counter, roundbracket_open, and repeat_in_push: points to a
 		//    restore state, backtracking.
 		//  check_counter: complementary to next1 based on quantifier.is_greedy.
+		//  repeat_atom: points to repeat_atom_pop, backtracking.
+		//  repeat_atom_pop: points back to repeat_atom.
+		//  character_switch: points to another possibility when no case matches,
+		//    non-backtracking.
 		//  (Special case 1) roundbracket_close, check_0_width_repeat, and backreference:
 		//    points to the next state as an exit after 0 width match.
 		//  (Special case 2) in NFA_states[0] holds the entry point for match_continuous/regex_match.
 		//  (Special case 3) in lookaround_open points to the contents of brackets.
-	};
 
 	re_quantifier quantifier;	//  For check_counter, roundbrackets, repeasts, (?<=...) and (?<!...),
 		//  and character_class.
@@ -15445,11 +15784,24 @@ struct re_state
 	ui_l32 flags;
 		//  Bit
 		//    0: is_not; for \B, (?!...) and (?<!...).
+		//       [^char_num]; for repeat_atom.
 		//       icase; for [0], backreference.
 		//       multiline; for bol, eol.
-		//       (Only bit used across compiler and algorithm).
+		//       (Only bit used across compiler and algorithm, except bit 1 in [0]).
 		//    1: backrefno_unresolved. Used only in compiler.
+		//       eol_anchored; for [0], every match ends at $ without multiline.
 		//    2: hooking. Used only in compiler.
+		//       leading_dotstar; for [0], the expression begins with .* or .+ without dotall.
+		//    3: char_num is a class; for repeat_atom.
+		//       leading_anystar; for [0], it begins with .* or .+ with dotall, or [\s\S]*.
+		//    4: min and max are in its repeat_atom_pop; for repeat_atom.
+		//       within_line; for [0] with leading_dotstar, no match contains a line terminator.
+		//    4-31: loop number for the risk analysis. Used only in compiler.
+
+#if defined(SRELL_ENABLE_PROFILER)
+	range_pair srcspan;	//  Part of the expression the state was made from, in code points.
+		//  srcspan.second == 0 if unknown.
+#endif
 
 	void reset(const re_state_type t = st_character, const ui_l32 c = char_ctrl::cc_nul)
 	{
@@ -15459,6 +15811,9 @@ struct re_state
 		next2 = 0;
 		flags = 0u;
 		quantifier.reset();
+#if defined(SRELL_ENABLE_PROFILER)
+		srcspan.set(0);
+#endif
 	}
 
 	bool is_character_or_class() const
@@ -15476,12 +15831,8 @@ struct re_state
 		//  -- assertions boundary --
 		//  6. lookaround: size == ? && type == lookaround_open,
 		//  7. assertion:  size == 0 && type == one of assertions (^, $, \b and \B).
-#if !defined(SRELL_ENABLE_GT)
-		return type < st_zero_width_boundary;
-#else
 		//  5.5. independent: size == ? && type == lookaround && char_num == '>',
 		return type < st_zero_width_boundary || (type == st_lookaround_open && char_num == meta_char::mc_gt);
-#endif
 	}
 
 	bool is_noncapturinggroup() const
@@ -15514,6 +15865,16 @@ struct re_state
 		return type == right.type && char_num == right.char_num;
 	}
 
+	const re_state *next_state1() const
+	{
+		return this + next1;
+	}
+
+	const re_state *next_state2() const
+	{
+		return this + next2;
+	}
+
 	std::ptrdiff_t nearnext() const
 	{
 		return quantifier.is_greedy ? next1 : next2;
@@ -15573,12 +15934,22 @@ struct re_compiler_state : public re_flags
 	identifier_charclass idchecker;
 #endif
 
+#if !defined(SRELL_NO_RISKCHECK)
+	simple_array<ui_l32> loopspans;
+		//  [(n - 1) * 2] and [(n - 1) * 2 + 1] hold the offsets of the beginning and end
+		//  of the unbounded loop numbered n.
+#endif
+
 	void reset(const regex_constants::syntax_option_type flags, const ui_l32 *const b)
 	{
 		re_flags::reset(flags);
 
 		begin = b;
 
+#if !defined(SRELL_NO_RISKCHECK)
+		loopspans.clear();
+#endif
+
 #if !defined(SRELL_NO_NAMEDCAPTURE)
 		unresolved_gnames.clear();
 #endif
@@ -15718,6 +16089,10 @@ public:
 
 #if !defined(SRELL_NO_LIMIT_COUNTER)
 	std::size_t failure_counter;
+	std::size_t failure_reserve;
+	std::size_t failure_limit;
+	std::size_t failure_steps;
+	std::size_t limit_counter;	//  If not 0, used instead of basic_regex::limit_counter.
 #endif
 
 	BidirectionalIterator lblim;
@@ -15744,8 +16119,36 @@ public:
 	regex_constants::match_flag_type flags;
 	const re_state/* <charT> */ *entry_state;
 
+	interrupt_checker *interrupter;
+	std::size_t interrupt_countdown;
+
+#if defined(SRELL_ENABLE_STATS)
+	search_statistics stats;
+#endif
+
+#if defined(SRELL_ENABLE_PROFILER)
+	search_profile profile;
+#endif
+
 public:
 
+	re_search_state() :
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+		failure_counter(0), failure_reserve(0), failure_limit(0), failure_steps(0), limit_counter(0),
+#endif
+		interrupter(NULL), interrupt_countdown(constants::interrupt_interval)
+	{
+	}
+
+	//  The countdown is not reset by init(), so that a scan made of many
+	//  searches (for_each_match(), search_lines(), ...) consults ic as
+	//  often as one long search does.
+	void set_interrupter(interrupt_checker *const ic)
+	{
+		interrupter = ic;
+		interrupt_countdown = constants::interrupt_interval;
+	}
+
 	void init
 	(
 		const BidirectionalIterator begin,
@@ -15758,6 +16161,12 @@ public:
 		nextpos = srchbegin = begin;
 		srchend = end;
 		flags = f;
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+		failure_counter = failure_reserve = failure_limit = failure_steps = 0;
+#endif
+#if defined(SRELL_ENABLE_STATS)
+		stats.clear();
+#endif
 	}
 
 	void init_for_automaton
@@ -15794,9 +16203,70 @@ public:
 
 		bracket[0].core.open_at = ssc.iter;
 
+#if defined(SRELL_ENABLE_STATS)
+		++stats.automaton_runs;
+#endif
+
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+		failure_steps = steps_consumed();
+		failure_limit = limit_counter ? limit_counter : limit;
+
+		//  When interrupter is set, the limit is split into chunks so that
+		//  interrupter can be checked each time failure_counter runs out.
+		failure_counter = interrupter && failure_limit > constants::interrupt_interval ? constants::interrupt_interval : failure_limit;
+		failure_reserve = failure_limit - failure_counter;
+#endif
+	}
+
+#if !defined(SRELL_NO_LIMIT_COUNTER)
+	//  Total of the failures counted since init().
+	std::size_t steps_consumed() const
+	{
+		return failure_steps + failure_limit - failure_counter - failure_reserve;
+	}
+#endif
+
 #if !defined(SRELL_NO_LIMIT_COUNTER)
-		failure_counter = limit;
+	void refill_failure_counter()
+	{
+		failure_counter = failure_reserve > constants::interrupt_interval ? constants::interrupt_interval : failure_reserve;
+		failure_reserve -= failure_counter;
+	}
+#endif
+
+#if defined(SRELL_ENABLE_PROFILER)
+	void prepare_profile(const std::size_t numof_states)
+	{
+		if (profile.entries.size() != numof_states)
+		{
+			profile.entries.assign(numof_states, 0);
+			profile.failures.assign(numof_states, 0);
+		}
+	}
+#endif
+
+#if defined(SRELL_ENABLE_STATS)
+	//  The stack only shrinks by backtracking or at the end of a lookaround,
+	//  so its depth is sampled at those points.
+	void sample_btstack_depth()
+	{
+		if (stats.max_btstack_depth < bt_stack.size())
+			stats.max_btstack_depth = bt_stack.size();
+	}
 #endif
+
+	//  Called before each search, before each attempt of the automaton at a
+	//  new position, and for each position that the first character check
+	//  skips. The scans of re_bmh and the single character finder call
+	//  interrupter directly per constants::interrupt_scanblock code units.
+	bool is_interrupted()
+	{
+		if (interrupter && --interrupt_countdown == 0)
+		{
+			interrupt_countdown = constants::interrupt_interval;
+			return interrupter->interrupted();
+		}
+		return false;
 	}
 
 	bool is_at_lookbehindlimit() const
@@ -15918,6 +16388,43 @@ public:
 	namespace re_detail
 	{
 
+#if !defined(SRELLDBG_NO_RAREUNIT)
+
+//  Rough guess at how often a code unit appears in ordinary text, such as
+//  logs, source code and prose in Latin script. Only the order matters:
+//  the lower, the rarer. Used to choose which unit a search scans for.
+struct unit_frequency
+{
+	static unsigned int rank(const ui_l32 cu)
+	{
+		static const unsigned char ascii[128] =
+		{
+			  8,   4,   4,   4,   4,   4,   4,   4,   4, 150, 170,   4,   4, 120,   4,   4,	//  00-0f
+			  4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,   4,	//  10-1f
+			255,  60, 150,  60,  50,  50,  70, 110, 140, 140,  80,  70, 170, 175, 185, 160,	//  20-2f
+			200, 195, 185, 170, 165, 165, 160, 155, 155, 155, 165, 120, 100, 140, 100,  60,	//  30-3f
+			 60, 130, 100, 120, 110, 130, 100,  90,  95, 125,  60,  65, 110, 105, 115, 115,	//  40-4f
+			110,  45, 120, 130, 130, 100,  75,  85,  55,  70,  45, 100,  60, 100,  30, 140,	//  50-5f
+			 30, 240, 180, 205, 215, 250, 195, 190, 220, 235, 125, 160, 210, 200, 230, 238,	//  60-6f
+			185, 110, 225, 228, 245, 202, 170, 188, 135, 186, 115,  90,  50,  90,  30,   2	//  70-7f
+		};
+
+		if (cu < 0x80)
+			return ascii[cu];
+
+		if (cu < 0xc0)
+			return 100;	//  Trailing units of UTF-8.
+
+		if (cu < 0xc2 || (cu > 0xf4 && cu < 0x100))
+			return 1;	//  Never appear in UTF-8.
+
+		return cu < 0xf0 ? 90 : (cu < 0x100 ? 40 : 80);
+	}
+};
+//  unit_frequency
+
+#endif	//  !defined(SRELLDBG_NO_RAREUNIT)
+
 #if !defined(SRELLDBG_NO_BMH)
 
 template <typename charT, typename utf_traits>
@@ -15926,6 +16433,9 @@ class re_bmh
 public:
 
 	re_bmh()
+#if !defined(SRELLDBG_NO_RAREUNIT)
+		: rarepos_(0)
+#endif
 	{
 	}
 
@@ -15949,6 +16459,9 @@ public:
 
 			this->bmtable_ = that.bmtable_;
 			this->repseq_ = that.repseq_;
+#if !defined(SRELLDBG_NO_RAREUNIT)
+			this->rarepos_ = that.rarepos_;
+#endif
 		}
 		return *this;
 	}
@@ -15962,6 +16475,9 @@ public:
 
 			this->bmtable_ = std::move(that.bmtable_);
 			this->repseq_ = std::move(that.repseq_);
+#if !defined(SRELLDBG_NO_RAREUNIT)
+			this->rarepos_ = that.rarepos_;
+#endif
 		}
 		return *this;
 	}
@@ -15975,6 +16491,12 @@ public:
 		repseq_.clear();
 	}
 
+	//  Upper bound of the code units that a match can span.
+	std::size_t maxlength() const
+	{
+		return static_cast<std::size_t>(u32string_.size()) * utf_traits::maxseqlen;
+	}
+
 	void setup(const simple_array<ui_l32> &u32s, const bool icase)
 	{
 		u32string_ = u32s;
@@ -15989,29 +16511,7 @@ public:
 	template <typename RandomAccessIterator>
 	bool do_casesensitivesearch(re_search_state<RandomAccessIterator> &sstate, const std::random_access_iterator_tag) const
 	{
-		RandomAccessIterator begin = sstate.srchbegin;
-		const RandomAccessIterator end = sstate.srchend;
-		std::size_t offset = static_cast<std::size_t>(repseq_.size() - 1);
-		const charT *const relastchar = &repseq_[offset];
-
-		for (; static_cast<std::size_t>(end - begin) > offset;)
-		{
-			begin += offset;
-
-			if (*begin == *relastchar)
-			{
-				const charT *re = relastchar;
-				RandomAccessIterator tail = begin;
-
-				for (; *--re == *--tail;)
-				{
-					if (re == repseq_.data())
-						return sstate.set_bracket0(tail, ++begin);
-				}
-			}
-			offset = bmtable_[*begin & 0xff];
-		}
-		return false;
+		return do_casesensitivesearch(sstate, sstate.srchbegin);
 	}
 
 	template <typename BidirectionalIterator>
@@ -16043,13 +16543,79 @@ public:
 		}
 	}
 
-	template <typename RandomAccessIterator>
-	bool do_icasesearch(re_search_state<RandomAccessIterator> &sstate, const std::random_access_iterator_tag) const
+#if !defined(SRELLDBG_NO_RAREUNIT)
+
+	//  For contiguous sequences of single-byte units. Lets memchr (through
+	//  char_traits::find) look for the rarest unit of repseq_ and compares
+	//  the rest in place. Goes back to the skip loop once hits turn out to
+	//  be too frequent for the calls to pay.
+	template <typename ContiguousIterator>
+	bool do_rareunitsearch(re_search_state<ContiguousIterator> &sstate, const std::random_access_iterator_tag) const
 	{
-		const RandomAccessIterator begin = sstate.srchbegin;
-		const RandomAccessIterator end = sstate.srchend;
-		std::size_t offset = bmtable_[256];
-		const ui_l32 entrychar = u32string_[u32string_.size() - 1];
+		typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
+		const ContiguousIterator begin = sstate.srchbegin;
+		const std::size_t len = static_cast<std::size_t>(sstate.srchend - begin);
+		const std::size_t seqlen = static_cast<std::size_t>(repseq_.size());
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+		if (sizeof (char_type) != 1)
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+			return do_casesensitivesearch(sstate, begin);
+			//  char_traits::find of wider types is usually a plain loop,
+			//  which the skip loop outruns.
+
+		if (len < seqlen)
+			return false;
+
+		const char_type *const text = &*begin;
+		const char_type rareunit = static_cast<char_type>(repseq_[rarepos_]);
+		const std::size_t limit = len - seqlen + rarepos_ + 1;
+		std::size_t pos = rarepos_;
+		std::size_t misses = 0;
+
+		while (pos < limit)
+		{
+			const char_type *const found = std::char_traits<char_type>::find(text + pos, limit - pos, rareunit);
+
+			if (!found)
+				break;
+
+			const std::size_t start = static_cast<std::size_t>(found - text) - rarepos_;
+			std::size_t i = 0;
+
+			for (; i < seqlen && text[start + i] == static_cast<char_type>(repseq_[i]); ++i);
+
+			if (i == seqlen)
+				return sstate.set_bracket0(begin + start, begin + (start + seqlen));
+
+			pos = start + rarepos_ + 1;
+
+			if (++misses * 32 > pos + 256)
+				return do_casesensitivesearch(sstate, begin + (start + 1));
+		}
+		return false;
+	}
+
+	template <typename BidirectionalIterator>
+	bool do_rareunitsearch(re_search_state<BidirectionalIterator> &sstate, const std::bidirectional_iterator_tag) const
+	{
+		return do_casesensitivesearch(sstate, std::bidirectional_iterator_tag());
+	}
+
+#endif	//  !defined(SRELLDBG_NO_RAREUNIT)
+
+	template <typename RandomAccessIterator>
+	bool do_icasesearch(re_search_state<RandomAccessIterator> &sstate, const std::random_access_iterator_tag) const
+	{
+		const RandomAccessIterator begin = sstate.srchbegin;
+		const RandomAccessIterator end = sstate.srchend;
+		std::size_t offset = bmtable_[256];
+		const ui_l32 entrychar = u32string_[u32string_.size() - 1];
 		const ui_l32 *const re2ndlastchar = &u32string_[u32string_.size() - 2];
 		RandomAccessIterator curpos = begin;
 
@@ -16133,6 +16699,33 @@ public:
 
 private:
 
+	template <typename RandomAccessIterator>
+	bool do_casesensitivesearch(re_search_state<RandomAccessIterator> &sstate, RandomAccessIterator begin) const
+	{
+		const RandomAccessIterator end = sstate.srchend;
+		std::size_t offset = static_cast<std::size_t>(repseq_.size() - 1);
+		const charT *const relastchar = &repseq_[offset];
+
+		for (; static_cast<std::size_t>(end - begin) > offset;)
+		{
+			begin += offset;
+
+			if (*begin == *relastchar)
+			{
+				const charT *re = relastchar;
+				RandomAccessIterator tail = begin;
+
+				for (; *--re == *--tail;)
+				{
+					if (re == repseq_.data())
+						return sstate.set_bracket0(tail, ++begin);
+				}
+			}
+			offset = bmtable_[*begin & 0xff];
+		}
+		return false;
+	}
+
 	void setup_()
 	{
 		bmtable_.resize(257);
@@ -16160,6 +16753,17 @@ private:
 
 		for (std::size_t i = 0; i < repseq_lastcharpos_; ++i)
 			bmtable_[repseq_[i] & 0xff] = repseq_lastcharpos_ - i;
+
+#if !defined(SRELLDBG_NO_RAREUNIT)
+		rarepos_ = repseq_lastcharpos_;
+
+		for (std::size_t i = repseq_lastcharpos_; i;)
+		{
+			--i;
+			if (unit_frequency::rank(repseq_[i] & utf_traits::bitsetmask) < unit_frequency::rank(repseq_[rarepos_] & utf_traits::bitsetmask))
+				rarepos_ = i;
+		}
+#endif
 	}
 
 	void setup_for_icase()
@@ -16212,6 +16816,9 @@ private:
 //	std::size_t bmtable_[256];
 	simple_array<std::size_t> bmtable_;
 	simple_array<charT> repseq_;
+#if !defined(SRELLDBG_NO_RAREUNIT)
+	std::size_t rarepos_;	//  Position in repseq_ of the unit do_rareunitsearch() looks for.
+#endif
 };
 //  re_bmh
 
@@ -16586,6 +17193,10 @@ protected:
 
 	state_array NFA_states;
 	re_character_class character_class;
+	simple_array<charT> strings;	//  Code units of st_string, concatenated.
+	simple_array<range_pair> switch_cases;	//  Pairs of a character and a state number
+		//  for st_character_switch, sorted by character in each table.
+	simple_array<charT> required_units;	//  Code units that every match contains.
 
 #if !defined(SRELLDBG_NO_1STCHRCLS)
 	#if !defined(SRELLDBG_NO_BITSET)
@@ -16619,6 +17230,11 @@ protected:
 	re_bmh<charT, utf_traits> *bmdata;
 #endif
 
+#if !defined(SRELL_NO_RISKCHECK)
+	regex_constants::risk_type risk_level;
+	range_pair risk_span;	//  Offsets in the expression, counted in code points.
+#endif
+
 #if !defined(SRELL_NO_LIMIT_COUNTER)
 private:
 
@@ -16635,8 +17251,14 @@ protected:
 		number_of_repeats(0u)
 #if !defined(SRELLDBG_NO_BMH)
 		, bmdata(NULL)
+#endif
+#if !defined(SRELL_NO_RISKCHECK)
+		, risk_level(regex_constants::risk_none)
 #endif
 	{
+#if !defined(SRELL_NO_RISKCHECK)
+		risk_span.set(0);
+#endif
 	}
 
 	re_object_core(const re_object_core &right)
@@ -16669,6 +17291,9 @@ protected:
 	{
 		NFA_states.clear();
 		character_class.clear();
+		strings.clear();
+		switch_cases.clear();
+		required_units.clear();
 
 #if !defined(SRELLDBG_NO_1STCHRCLS)
 	#if !defined(SRELLDBG_NO_BITSET)
@@ -16696,6 +17321,11 @@ protected:
 			delete bmdata;
 		bmdata = NULL;
 #endif
+
+#if !defined(SRELL_NO_RISKCHECK)
+		risk_level = regex_constants::risk_none;
+		risk_span.set(0);
+#endif
 	}
 
 	re_object_core &operator=(const re_object_core &that)
@@ -16704,6 +17334,9 @@ protected:
 		{
 			this->NFA_states = that.NFA_states;
 			this->character_class = that.character_class;
+			this->strings = that.strings;
+			this->switch_cases = that.switch_cases;
+			this->required_units = that.required_units;
 
 #if !defined(SRELLDBG_NO_1STCHRCLS)
 	#if !defined(SRELLDBG_NO_BITSET)
@@ -16726,6 +17359,11 @@ protected:
 			this->namedcaptures = that.namedcaptures;
 #endif
 
+#if !defined(SRELL_NO_RISKCHECK)
+			this->risk_level = that.risk_level;
+			this->risk_span = that.risk_span;
+#endif
+
 #if !defined(SRELLDBG_NO_BMH)
 			if (that.bmdata)
 			{
@@ -16740,9 +17378,6 @@ protected:
 				this->bmdata = NULL;
 			}
 #endif
-
-			if (that.NFA_states.size())
-				repair_nextstates(&that.NFA_states[0]);
 		}
 		return *this;
 	}
@@ -16754,6 +17389,9 @@ protected:
 		{
 			this->NFA_states = std::move(that.NFA_states);
 			this->character_class = std::move(that.character_class);
+			this->strings = std::move(that.strings);
+			this->switch_cases = std::move(that.switch_cases);
+			this->required_units = std::move(that.required_units);
 
 #if !defined(SRELLDBG_NO_1STCHRCLS)
 	#if !defined(SRELLDBG_NO_BITSET)
@@ -16776,6 +17414,11 @@ protected:
 			this->namedcaptures = std::move(that.namedcaptures);
 #endif
 
+#if !defined(SRELL_NO_RISKCHECK)
+			this->risk_level = that.risk_level;
+			this->risk_span = that.risk_span;
+#endif
+
 #if !defined(SRELLDBG_NO_BMH)
 			if (this->bmdata)
 				delete this->bmdata;
@@ -16793,6 +17436,9 @@ protected:
 		{
 			this->NFA_states.swap(right.NFA_states);
 			this->character_class.swap(right.character_class);
+			this->strings.swap(right.strings);
+			this->switch_cases.swap(right.switch_cases);
+			this->required_units.swap(right.required_units);
 
 #if !defined(SRELLDBG_NO_1STCHRCLS)
 	#if !defined(SRELLDBG_NO_BITSET)
@@ -16835,6 +17481,15 @@ protected:
 			this->namedcaptures.swap(right.namedcaptures);
 #endif
 
+#if !defined(SRELL_NO_RISKCHECK)
+			{
+				const regex_constants::risk_type tmp_risk_level = this->risk_level;
+				this->risk_level = right.risk_level;
+				right.risk_level = tmp_risk_level;
+			}
+			this->risk_span.swap(right.risk_span);
+#endif
+
 #if !defined(SRELLDBG_NO_BMH)
 			{
 				re_bmh<charT, utf_traits> *const tmp_bmdata = this->bmdata;
@@ -16858,23 +17513,6 @@ protected:
 		return NFA_states.size() ? 0 : static_cast<regex_constants::error_type>(number_of_repeats);
 	}
 
-private:
-
-	void repair_nextstates(const state_type *const oldbase)
-	{
-		state_type *const newbase = &this->NFA_states[0];
-
-		for (typename state_array::size_type i = 0; i < this->NFA_states.size(); ++i)
-		{
-			state_type &state = this->NFA_states[i];
-
-			if (state.next_state1)
-				state.next_state1 = state.next_state1 - oldbase + newbase;
-
-			if (state.next_state2)
-				state.next_state2 = state.next_state2 - oldbase + newbase;
-		}
-	}
 };
 //  re_object_core
 
@@ -16928,7 +17566,7 @@ protected:
 	bool is_ricase() const
 	{
 #if !defined(SRELL_NO_ICASE)
-		return /* this->NFA_states.size() && */ this->NFA_states[0].flags ? true : false;	//  icase.
+		return /* this->NFA_states.size() && */ (this->NFA_states[0].flags & sflags::icase) ? true : false;
 #else
 		return false;
 #endif
@@ -16956,6 +17594,15 @@ protected:
 
 	}
 
+	bool is_atomic() const
+	{
+#if !defined(SRELL_ENABLE_GT)
+		return (this->soflags & regex_constants::atomic) ? true : false;
+#else
+		return true;
+#endif
+	}
+
 	bool is_optimize() const
 	{
 		return (this->soflags & regex_constants::optimize) ? true : false;
@@ -17004,6 +17651,11 @@ private:
 		if (begin != end)
 			return this->set_error(regex_constants::error_paren);	//  ')'s are too many.
 
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+		//  Before the optimisations, which can rewrite the leading .*.
+		const ui_l32 leadingstar = find_leading_star();
+#endif
+
 		if (!check_backreferences(cvars))
 			return this->set_error(regex_constants::error_backref);
 
@@ -17017,7 +17669,38 @@ private:
 		this->NFA_states.push_back(flstate);
 
 		optimise();
-		relativejump_to_absolutejump();
+
+#if !defined(SRELL_NO_RISKCHECK)
+		if (!check_backtracking_risk(cvars, end))
+			return this->set_error(regex_constants::error_complexity);
+#endif
+
+#if !defined(SRELLDBG_NO_GROUP_ASTERISK_OPT) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+		group_asterisk_optimisation();
+#endif
+
+#if !defined(SRELLDBG_NO_REPEAT_ATOM)
+		//  After all the analyses, which know nothing about st_repeat_atom.
+		repeat_atom_optimisation();
+#endif
+
+#if !defined(SRELLDBG_NO_CHARSWITCH) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+		character_switch_optimisation();
+#endif
+
+#if !defined(SRELLDBG_NO_STRING_OPT)
+		//  After all the analyses, which know nothing about st_string.
+		string_optimisation();
+#endif
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+		check_eol_anchoring();
+		this->NFA_states[0].flags |= leadingstar;
+#endif
+
+#if !defined(SRELLDBG_NO_REQUIREDCHARS)
+		gather_required_units();
+#endif
 
 		return true;
 	}
@@ -17097,6 +17780,12 @@ private:
 			piece.clear();
 			piece_with_quantifier.clear();
 
+#if !defined(SRELL_NO_RISKCHECK) || defined(SRELL_ENABLE_PROFILER)
+			const ui_l32 *const piecebegin = curpos;
+#endif
+			const ui_l32 brnobegin = this->number_of_brackets;
+			bool possessive = false;
+
 			astate.reset(st_character, *curpos++);
 
 			switch (astate.char_num)
@@ -17369,10 +18058,18 @@ private:
 						goto AFTER_GREEDINESS_CHECK;
 					}
 
-					if (++curpos != end && *curpos == meta_char::mc_query)	//  '?'
+					if (++curpos != end)
 					{
-						quantifier.is_greedy = 0u;
-						++curpos;
+						if (*curpos == meta_char::mc_query)	//  '?'
+						{
+							quantifier.is_greedy = 0u;
+							++curpos;
+						}
+						else if (*curpos == meta_char::mc_plus && this->is_atomic())	//  '+'
+						{
+							possessive = true;
+							++curpos;
+						}
 					}
 					AFTER_GREEDINESS_CHECK:;
 				}
@@ -17386,6 +18083,24 @@ private:
 				else
 					combine_piece_with_quantifier(piece_with_quantifier, piece, quantifier, piecesize);
 
+#if !defined(SRELL_NO_RISKCHECK)
+				register_loopspan(piece_with_quantifier, piecebegin, curpos, cvars);
+#endif
+
+				if (possessive)
+					make_possessive(piece_with_quantifier, brnobegin, cvars);
+
+#if defined(SRELL_ENABLE_PROFILER)
+				//  States made by inner pieces keep their own spans.
+				for (state_size_type i = 0; i < piece_with_quantifier.size(); ++i)
+				{
+					range_pair &srcspan = piece_with_quantifier[i].srcspan;
+
+					if (srcspan.second == 0)
+						srcspan.set(static_cast<ui_l32>(piecebegin - cvars.begin), static_cast<ui_l32>(curpos - cvars.begin));
+				}
+#endif
+
 				piecesize.multiply(quantifier);
 				branchsize.add(piecesize);
 
@@ -17459,6 +18174,16 @@ private:
 
 			switch (rbstate.char_num)
 			{
+			case meta_char::mc_gt:	//  '>': atomic group.
+				if (!this->is_atomic())
+					return this->set_error(regex_constants::error_paren);
+
+#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND)
+				//  In lookbehinds it is matched backwards as its neighbours are.
+				rbstate.quantifier.is_greedy = cvars.back ? 1u : 0u;
+#endif
+				goto LOOKAROUND_OPEN;
+
 			case meta_char::mc_exclam:	//  '!':
 				rbstate.flags = sflags::is_not;
 				//@fallthrough@
@@ -17470,10 +18195,7 @@ private:
 //				rbstate.reverse = lookbehind;
 #endif
 
-#if defined(SRELL_ENABLE_GT)
-				//@fallthrough@
-			case meta_char::mc_gt:
-#endif
+				LOOKAROUND_OPEN:
 				rbstate.type = st_lookaround_open;
 				rbstate.next2 = 1;
 				rbstate.quantifier.atleast = this->number_of_brackets;
@@ -17647,9 +18369,7 @@ private:
 			}
 #endif
 
-#if defined(SRELL_ENABLE_GT)
 			if (firststate.char_num != meta_char::mc_gt)
-#endif
 				piecesize.reset(0);
 
 			firststate.next1 = static_cast<std::ptrdiff_t>(piece.size()) + 1;
@@ -17698,6 +18418,7 @@ private:
 				{
 					qstate.next1 = qstate.next2;
 					qstate.next2 = 1;
+					qstate.quantifier.is_greedy = 0u;
 				}
 
 				piece[piece.size() - 1].quantifier = quantifier;
@@ -17737,6 +18458,7 @@ private:
 			{
 				qstate.next1 = qstate.next2;
 				qstate.next2 = 1;
+				qstate.quantifier.is_greedy = 0u;
 			}
 
 			for (ui_l32 i = quantifier.atleast; i < quantifier.atmost; ++i)
@@ -17859,6 +18581,107 @@ private:
 		piece_with_quantifier += piece;
 	}
 
+	//  X*+, X++, X?+, and X{n,m}+ never give back what they have consumed,
+	//  as (?>X*), (?>X+), (?>X?), and (?>X{n,m}) do.
+	void make_possessive(state_array &piece, const ui_l32 brnobegin, const cvars_type &cvars) const
+	{
+		if (piece.size() == 0)
+			return;
+
+#if !defined(SRELLDBG_NO_ASTERISK_OPT)
+		//  A character or character class needs no lookaround. Its loops take
+		//  the form asterisk_optimisation() gives to exclusive ones.
+		if (make_possessive_corcc(piece))
+			return;
+#endif
+
+		state_type lastate;
+
+		lastate.reset(st_lookaround_open, meta_char::mc_gt);
+		lastate.next1 = static_cast<std::ptrdiff_t>(piece.size()) + 3;
+		lastate.next2 = 1;
+		lastate.quantifier.atleast = brnobegin;
+		lastate.quantifier.atmost = this->number_of_brackets - 1;
+#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND)
+		lastate.quantifier.is_greedy = cvars.back ? 1u : 0u;
+#else
+		lastate.quantifier.is_greedy = 0u;
+		static_cast<void>(cvars);
+#endif
+		piece.insert(0, lastate);
+
+		lastate.type = st_lookaround_pop;
+		lastate.next1 = 1;
+		lastate.next2 = 0;
+		piece.insert(1, lastate);
+
+		lastate.type = st_lookaround_close;
+		lastate.next1 = 0;
+		piece.push_back(lastate);
+	}
+
+#if !defined(SRELLDBG_NO_ASTERISK_OPT)
+
+	bool make_possessive_corcc(state_array &piece) const
+	{
+		for (state_size_type pos = 0; pos < piece.size(); ++pos)
+		{
+			const state_type &state = piece[pos];
+
+			if (state.type == st_epsilon)
+			{
+				if (state.char_num != epsilon_type::et_ccastrsk || state.next2 == 0 || pos + 1 == piece.size()
+						|| !piece[pos + 1].is_character_or_class())
+					return false;
+			}
+			else if (!state.is_character_or_class())
+				return false;
+		}
+
+		for (state_size_type pos = 0; pos < piece.size(); ++pos)
+		{
+			state_type &estate = piece[pos];
+
+			if (estate.type == st_epsilon)
+			{
+				state_type &corccstate = piece[pos + 1];
+
+				corccstate.next2 = estate.next2 - 1;
+				if (corccstate.next1 < 0)
+					corccstate.next1 = 0;
+
+				estate.next1 = 1;
+				estate.next2 = 0;
+				estate.char_num = epsilon_type::et_aofmrast;
+			}
+		}
+		return true;
+	}
+
+#endif	//  !defined(SRELLDBG_NO_ASTERISK_OPT)
+
+#if !defined(SRELL_NO_RISKCHECK)
+
+	//  Remembers where a loop came from, by tagging its head state with a
+	//  loop number. The tags are removed by check_backtracking_risk().
+	void register_loopspan(state_array &piece_with_quantifier, const ui_l32 *const begin, const ui_l32 *const end, cvars_type &cvars) const
+	{
+		if (piece_with_quantifier.size())
+		{
+			const state_size_type tailpos = piece_with_quantifier.size() - 1;
+			const std::ptrdiff_t tonext = piece_with_quantifier[tailpos].next1;
+
+			if (tonext < 0)
+			{
+				cvars.loopspans.push_back(static_cast<ui_l32>(begin - cvars.begin));
+				cvars.loopspans.push_back(static_cast<ui_l32>(end - cvars.begin));
+				piece_with_quantifier[tailpos + tonext].flags |= static_cast<ui_l32>(cvars.loopspans.size() / 2) << sflags::loopno_shift;
+			}
+		}
+	}
+
+#endif	//  !defined(SRELL_NO_RISKCHECK)
+
 	//  '['.
 
 	bool register_character_class(state_type &castate, const ui_l32 *&curpos, const ui_l32 *const end, const cvars_type & /* cvars */)
@@ -19091,10 +19914,11 @@ private:
 #else
 			for (ui_l32 ucp = range.first; ucp <= utf_traits::maxcpvalue; ++ucp)
 			{
-				const ui_l32 firstcu = utf_traits::firstcodeunit(ucp) & utf_traits::bitsetmask;
+				//  Not masked, as do_search_sc() compares whole code units.
+				const ui_l32 firstcu = utf_traits::firstcodeunit(ucp);
 
 #if !defined(SRELLDBG_NO_BITSET)
-				this->firstchar_class_bs.set(firstcu);
+				this->firstchar_class_bs.set(firstcu & utf_traits::bitsetmask);
 #endif
 
 #if !defined(SRELLDBG_NO_SCFINDER)
@@ -19241,1910 +20065,3501 @@ private:
 		return 0;
 	}
 
-	void relativejump_to_absolutejump()
-	{
-		for (state_size_type pos = 0; pos < this->NFA_states.size(); ++pos)
-		{
-			state_type &state = this->NFA_states[pos];
-
-#if !defined(SRELLDBG_NO_ASTERISK_OPT)
-			if (state.next1 || state.type == st_character || state.type == st_character_class)
-#else
-			if (state.next1)
-#endif
-				state.next_state1 = &this->NFA_states[pos + state.next1];
-			else
-				state.next_state1 = NULL;
+#if !defined(SRELL_NO_RISKCHECK)
+
+	//  Looks for loops that can backtrack excessively and records the worst one
+	//  found in risk_level and risk_span. Returns false if the expression should
+	//  be rejected because of regex_constants::noredos.
+	//  A loop is treated as a backtracking one unless asterisk_optimisation()
+	//  has made it possessive. An unbounded loop is rated exponential only if
+	//  its body contains another loop that can stop at the characters it
+	//  consumes, or alternatives that can begin with the same character.
+	//  A counted loop is rated by its body alone: if a choice in the body can
+	//  go two ways that begin with the same character, each repetition can
+	//  split the input differently, and the loop is rated polynomial, or
+	//  exponential if it can repeat constants::risky_repeat_count times or
+	//  more.
+	bool check_backtracking_risk(const cvars_type &cvars, const ui_l32 *const end)
+	{
+		simple_array<state_size_type> heads;
+		simple_array<state_size_type> tails;
+		simple_array<ui_l32> loopnos;
+		simple_array<ui_l32> counts;	//  0 for unbounded loops.
+		simple_array<bool> ambiguous;	//  Possessive and counted loops are never ambiguous.
+		std::vector<range_pairs> consumed;
+		std::vector<range_pairs> followers;
+		range_pairs alt1stch;
+		range_pairs alt2ndch;
 
-			if (state.next2)
-				state.next_state2 = &this->NFA_states[pos + state.next2];
-			else
-				state.next_state2 = NULL;
-		}
-	}
+		for (state_size_type pos = 1; pos < this->NFA_states.size(); ++pos)
+		{
+			const state_type &state = this->NFA_states[pos];
+			state_size_type headpos = pos;
 
-	void optimise()
-	{
-#if !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
-		branch_optimisation2();
-#endif
+			if (state.next1 < 0)
+			{
+				headpos = pos + state.next1;
 
-#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
-		if (!this->bmdata)
-			find_entrypoint();
-#endif
+				const state_type &headstate = this->NFA_states[headpos];
 
-#if !defined(SRELLDBG_NO_ASTERISK_OPT)
-		asterisk_optimisation();
-#endif
+				if (headstate.type == st_epsilon)
+				{
+					if (!headstate.quantifier.is_infinity())
+						continue;
+				}
+				else if (headstate.type != st_check_counter && (!headstate.is_character_or_class() || headstate.next1 != 0))
+					continue;
+				//  Otherwise a counted loop, or a loop split by is_exclusive_sequence() that begins with a possessive one.
+			}
+			else if (!state.is_character_or_class() || state.next1 != 0 || state.next2 == 0)
+				continue;
 
-#if !defined(SRELLDBG_NO_BRANCH_OPT) && !defined(SRELLDBG_NO_ASTERISK_OPT)
-		branch_optimisation();
-#endif
+			//  Every alternative in a group, and the end of the group, jumps
+			//  back to the head on its own. They all belong to one loop, which
+			//  ends at the last of them.
+			state_size_type no = 0;
 
-#if !defined(SRELLDBG_NO_1STCHRCLS)
-		create_firstchar_class();
-#endif
+			for (; no < heads.size() && heads[no] != headpos; ++no);
 
-#if !defined(SRELLDBG_NO_SKIP_EPSILON)
-		skip_epsilon();
-#endif
+			if (no < heads.size())
+			{
+				tails[no] = pos;
+				continue;
+			}
 
-#if !defined(SRELLDBG_NO_CCPOS)
-		set_charclass_posinfo();
-#endif
-	}
+			const state_type &tagstate = this->NFA_states[this->NFA_states[headpos].is_character_or_class() ? headpos - 1 : headpos];
 
-#if !defined(SRELLDBG_NO_SKIP_EPSILON)
+			heads.push_back(headpos);
+			tails.push_back(pos);
+			loopnos.push_back(tagstate.flags >> sflags::loopno_shift);
+			counts.push_back(tagstate.type == st_check_counter && !tagstate.quantifier.is_infinity() ? tagstate.quantifier.atmost : 0u);
+		}
 
-	void skip_epsilon()
-	{
-		for (state_size_type pos = 0; pos < this->NFA_states.size(); ++pos)
+		for (state_size_type i = 0; i < heads.size(); ++i)
 		{
-			state_type &state = this->NFA_states[pos];
+			consumed.push_back(range_pairs());
+			followers.push_back(range_pairs());
 
-			if (state.next1)
-				state.next1 = static_cast<std::ptrdiff_t>(skip_nonbranch_epsilon(pos + state.next1)) - pos;
+			range_pairs &chars = consumed.back();
 
-			if (state.next2)
-				state.next2 = static_cast<std::ptrdiff_t>(skip_nonbranch_epsilon(pos + state.next2)) - pos;
-		}
-	}
+			for (state_size_type pos = heads[i]; pos <= tails[i]; ++pos)
+				gather_consumablechars(chars, this->NFA_states[pos]);
 
-	state_size_type skip_nonbranch_epsilon(state_size_type pos) const
-	{
-		for (;;)
-		{
-			const state_type &state = this->NFA_states[pos];
-
-			if (state.type == st_epsilon && state.next2 == 0)
+			if (heads[i] != tails[i])
 			{
-				pos += state.next1;
-				continue;
+				gather_nextchars(followers.back(), tails[i] + 1, 0u, true);
+				ambiguous.push_back(counts[i] == 0 && chars.is_overlap(followers.back()));
 			}
-			break;
+			else
+				ambiguous.push_back(false);
 		}
-		return pos;
-	}
-
-#endif
 
-#if !defined(SRELLDBG_NO_ASTERISK_OPT)
+		this->risk_level = regex_constants::risk_none;
+		this->risk_span.set(0);
 
-	void asterisk_optimisation()
-	{
-		for (state_size_type pos = 1u; pos < this->NFA_states.size(); ++pos)
+		for (state_size_type i = 0; i < heads.size() && this->risk_level != regex_constants::risk_exponential; ++i)
 		{
-			state_type &curstate = this->NFA_states[pos];
+			if (heads[i] == tails[i])
+				continue;
 
-			switch (curstate.type)
+			if (counts[i])
 			{
-			case st_character:
-			case st_character_class:
-				if (this->NFA_states[pos - 1].is_question_or_asterisk_before_corcc())
-				{
-					state_type &estate = this->NFA_states[pos - 1];
-					const state_size_type nextno = pos + estate.farnext() - 1;
-
-					if (is_exclusive_sequence(estate.quantifier, pos, nextno))
-					{
-						state_type &estate2 = this->NFA_states[pos - 1];
-						state_type &corccstate = this->NFA_states[pos];
+				//  (.*a){10}, (?:a|a){10}, (?:a?){10}: each repetition can
+				//  match the same characters in more than one way.
+				if (has_ambiguous_branch(heads[i] + 1, tails[i] + 1, alt1stch, alt2ndch))
+					set_backtracking_risk(counts[i] >= constants::risky_repeat_count ? regex_constants::risk_exponential : regex_constants::risk_polynomial, loopnos[i], loopnos[i], cvars, end);
 
-						estate2.next1 = 1;
-						estate2.next2 = 0;
-						estate2.char_num = epsilon_type::et_aofmrast;
+				continue;
+			}
 
-						if (corccstate.next1 < 0)
-							corccstate.next1 = 0;
+			for (state_size_type j = 0; j < heads.size(); ++j)
+			{
+				if (j == i)
+					continue;
 
-						corccstate.next2 = nextno - pos;
+				if (heads[i] <= heads[j] && tails[j] <= tails[i])
+				{
+					//  (a+)+: a loop nested in another one can stop at the same
+					//  characters that it consumes.
+					if (ambiguous[j])
+					{
+						set_backtracking_risk(regex_constants::risk_exponential, loopnos[i], loopnos[i], cvars, end);
+						break;
 					}
 				}
-				continue;
+				else if (heads[j] > tails[i] && ambiguous[i])
+				{
+					//  \d+\d+: the loop that follows can take over the characters.
+					if (consumed[j].is_overlap(followers[i]) && consumed[j].is_overlap(consumed[i]))
+						set_backtracking_risk(regex_constants::risk_polynomial, loopnos[i], loopnos[j], cvars, end);
+				}
+			}
 
-			default:;
+			//  The head of the loop is its own exit, not an alternative.
+			for (state_size_type pos = heads[i] + 1; pos <= tails[i] && this->risk_level != regex_constants::risk_exponential; ++pos)
+			{
+				const state_type &state = this->NFA_states[pos];
+
+				alt1stch.clear();
+				alt2ndch.clear();
+
+				if (state.is_branch())
+					gather_nextchars(alt1stch, pos + state.next1, 0u, true);
+				else if (state.is_character_or_class() && state.next1 != 0 && state.next2 != 0)
+					gather_consumablechars(alt1stch, state);	//  a|b folded into a character that branches to b.
+				else
+					continue;
+
+				//  (\w|\d)*: alternatives in a loop that can begin with the same character.
+				gather_nextchars(alt2ndch, pos + state.next2, 0u, true);
+
+				if (alt1stch.is_overlap(alt2ndch))
+					set_backtracking_risk(regex_constants::risk_exponential, loopnos[i], loopnos[i], cvars, end);
 			}
 		}
+
+		for (state_size_type pos = 0; pos < this->NFA_states.size(); ++pos)
+			this->NFA_states[pos].flags &= (1u << sflags::loopno_shift) - 1;
+
+		return this->risk_level != regex_constants::risk_exponential || !(this->soflags & regex_constants::noredos);
 	}
 
-	bool is_exclusive_sequence(const re_quantifier &eq, const state_size_type curno, const state_size_type nextno)	//  const
+	//  Returns true if a state in [begin, end) chooses between two ways that
+	//  can begin with the same character: the alternatives of '|', going into
+	//  or past a quantified piece, or one more repetition of a counted loop
+	//  or leaving it.
+	bool has_ambiguous_branch(const state_size_type begin, const state_size_type end, range_pairs &alt1stch, range_pairs &alt2ndch) const
 	{
-		const state_type &curstate = this->NFA_states[curno];
-		range_pairs curchar_class;
-		range_pairs nextchar_class;
-
-		if (curstate.type == st_character)
-		{
-			curchar_class.join(range_pair_helper(curstate.char_num));
-		}
-		else if (curstate.type == st_character_class)
-		{
-			curchar_class = this->character_class[curstate.char_num];
-			if (curchar_class.size() == 0)	//  Means [], which always makes matching fail.
-				return true;	//  For preventing the automaton from pushing bt data.
-		}
-		else
+		for (state_size_type pos = begin; pos < end; ++pos)
 		{
-			return false;
-		}
+			const state_type &state = this->NFA_states[pos];
+			const bool branches = state.type == st_epsilon
+				? (state.char_num == epsilon_type::et_alt || state.char_num == epsilon_type::et_ccastrsk || state.char_num == epsilon_type::et_dfastrsk)
+				: (state.type == st_check_counter && state.quantifier.atleast < state.quantifier.atmost);
 
-		const bool canbe0length = gather_nextchars(nextchar_class, nextno, 0u, true);
+			alt1stch.clear();
+			alt2ndch.clear();
 
-		if (nextchar_class.size())
+			if (branches && state.next1 != 0 && state.next2 != 0)
+				gather_nextchars(alt1stch, pos + state.next1, 0u, true);
+			else if (state.is_character_or_class() && state.next1 != 0 && state.next2 != 0)
+				gather_consumablechars(alt1stch, state);
+			else
+				continue;
+
+			gather_nextchars(alt2ndch, pos + state.next2, 0u, true);
+
+			if (alt1stch.is_overlap(alt2ndch))
+				return true;
+		}
+		return false;
+	}
+
+	void gather_consumablechars(range_pairs &chars, const state_type &state) const
+	{
+		switch (state.type)
 		{
-			if (!canbe0length || eq.is_greedy)
+		case st_character:
+			if (!this->is_ricase())
 			{
-#if !defined(SRELLDBG_NO_SPLITCC)
-
-				range_pairs kept;
-				range_pairs removed;
+				chars.join(range_pair_helper(state.char_num));
+			}
+			else
+			{
+				ui_l32 table[ucf_constants::rev_maxset] = {};
+				const ui_l32 setnum = unicode_case_folding::do_caseunfolding(table, state.char_num);
 
-				curchar_class.split_ranges(kept, removed, nextchar_class);
+				for (ui_l32 j = 0; j < setnum; ++j)
+					chars.join(range_pair_helper(table[j]));
+			}
+			break;
 
-				if (removed.size() == 0)	//  !curchar_class.is_overlap(nextchar_class)
-					return true;
+		case st_character_class:
+			chars.merge(this->character_class[state.char_num]);
+			break;
 
-				if (curstate.type == st_character_class && kept.size() && eq.is_infinity())
-				{
-					{
-						state_type &curstate2 = this->NFA_states[curno];
+		case st_backreference:
+			chars.set_solerange(range_pair_helper(0, constants::unicode_max_codepoint));
+			break;
 
-						curstate2.char_num = kept.consists_of_one_character(this->is_icase());
-						if (curstate2.char_num != constants::invalid_u32value)
-							curstate2.type = st_character;
-						else
-							curstate2.char_num = this->character_class.register_newclass(kept);
-					}
-					const re_quantifier backupeq(eq);
+		default:;
+		}
+	}
 
-					insert_at(nextno, 2);
-					state_type &n0 = this->NFA_states[nextno];
-					state_type &n1 = this->NFA_states[nextno + 1];
+	void set_backtracking_risk(const regex_constants::risk_type level, const ui_l32 firstloopno, const ui_l32 lastloopno, const cvars_type &cvars, const ui_l32 *const end)
+	{
+		if (level > this->risk_level)
+		{
+			const ui_l32 *const spans = cvars.loopspans.data();
+			const ui_l32 begin1 = firstloopno ? spans[firstloopno * 2 - 2] : 0u;
+			const ui_l32 begin2 = lastloopno ? spans[lastloopno * 2 - 2] : 0u;
+			const ui_l32 end1 = firstloopno ? spans[firstloopno * 2 - 1] : static_cast<ui_l32>(end - cvars.begin);
+			const ui_l32 end2 = lastloopno ? spans[lastloopno * 2 - 1] : static_cast<ui_l32>(end - cvars.begin);
+
+			//  In lookbehinds loops are placed in the reverse order.
+			this->risk_level = level;
+			this->risk_span.set(begin1 < begin2 ? begin1 : begin2, end1 > end2 ? end1 : end2);
+		}
+	}
 
-					n0.reset(st_epsilon, epsilon_type::et_ccastrsk);
-					n0.quantifier = backupeq;
-//					n0.next2 = 1;
-					n0.next2 = 2;
-					if (!n0.quantifier.is_greedy)
-					{
-						n0.next1 = n0.next2;
-						n0.next2 = 1;
-					}
+#endif	//  !defined(SRELL_NO_RISKCHECK)
 
-					n1.reset(st_character_class, removed.consists_of_one_character(this->is_icase()));
+	void optimise()
+	{
+#if !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
+		branch_optimisation2();
+#endif
 
-					if (n1.char_num != constants::invalid_u32value)
-						n1.type = st_character;
-					else
-						n1.char_num = this->character_class.register_newclass(removed);
+#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
+		if (!this->bmdata)
+			find_entrypoint();
+#endif
 
-					n1.next1 = -2;
-//					n1.next2 = 0;
-					return true;
-				}
+#if !defined(SRELLDBG_NO_ASTERISK_OPT)
+		asterisk_optimisation();
+#endif
 
-#else	//  defined(SRELLDBG_NO_SPLITCC)
+#if !defined(SRELLDBG_NO_BRANCH_OPT) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+		branch_optimisation();
+#endif
 
-				if (!curchar_class.is_overlap(nextchar_class))
-				{
-					return true;
-				}
+#if !defined(SRELLDBG_NO_1STCHRCLS)
+		create_firstchar_class();
+#endif
 
-#endif	//  !defined(SRELLDBG_NO_SPLITCC)
-			}
-		}
-		else if (/* nextchar_class.size() == 0 && */ (!canbe0length || only_success_left(nextno)))
-		{
-			//  (size() == 0 && !canbe0length) means [].
-			return eq.is_greedy ? true : false;
-		}
+#if !defined(SRELLDBG_NO_SKIP_EPSILON)
+		skip_epsilon();
+#endif
 
-		return false;
+#if !defined(SRELLDBG_NO_CCPOS)
+		set_charclass_posinfo();
+#endif
 	}
 
-	bool only_success_left(state_size_type pos) const
+#if !defined(SRELLDBG_NO_GROUP_ASTERISK_OPT) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+
+	//  Extends what asterisk_optimisation() does for a character or
+	//  character class to the epsilon of a quantified group, such as
+	//  (?:ab)*c or (?:\w+,)+x. When one of its two ways begins with a
+	//  character or character class that nothing the other way can begin
+	//  with matches, at most one of them can go on at any position. That
+	//  first state is given the other way as its next2, which the automaton
+	//  follows without pushing anything when it fails, and the epsilon is
+	//  bypassed. Backtracking into earlier iterations is kept as is.
+	void group_asterisk_optimisation()
 	{
-		for (;;)
+		state_array &NFAs = this->NFA_states;
+
+		for (state_size_type pos = 1; pos < NFAs.size(); ++pos)
 		{
-			const state_type &state = this->NFA_states[pos];
+			const state_type &estate = NFAs[pos];
 
-			switch (state.type)
+			if (estate.type != st_epsilon || estate.char_num != epsilon_type::et_dfastrsk || estate.next1 == 0 || estate.next2 == 0)
+				continue;
+
+			state_size_type atomno = pos + estate.next1;
+			state_size_type otherno = pos + estate.next2;
+
+			if (!is_exclusive_way(atomno, otherno))
 			{
-			case st_success:
-				return true;
+				atomno = otherno;
+				otherno = pos + estate.next1;
 
-			case st_roundbracket_close:
-			case st_backreference:
-				if (state.next2 != 0 && state.next1 != state.next2)
-					return false;
-				break;
+				if (!is_exclusive_way(atomno, otherno))
+					continue;
+			}
 
-			case st_epsilon:
-				if (state.next2 != 0 && !only_success_left(pos + state.next2))
-					return false;
-				break;
+			if (count_referrers(atomno) > 1u)
+			{
+				//  Something other than the epsilon jumps to the atom too
+				//  (e.g. the jump into the loop made for a group with '+'),
+				//  and must not take the way out when it fails. That one is
+				//  given a copy of the atom without next2.
+				insert_at(atomno, 1);
+				if (pos >= atomno)
+					++pos;
+				if (otherno >= atomno)
+					++otherno;
 
-			case st_roundbracket_open:
-				break;	//  /a*()/
+				state_type &copy = NFAs[atomno];
 
-			default:
-				return false;
+				copy = NFAs[atomno + 1];
+				copy.next1 += 1;
+				copy.next2 = 0;
+				redirect_referrers(atomno + 1, atomno, pos);
+				++atomno;
 			}
-			if (state.next1)
-				pos += state.next1;
-			else
-				return false;
+
+			NFAs[atomno].next2 = static_cast<si_l32>(otherno) - static_cast<si_l32>(atomno);
+			redirect_referrers(pos, atomno, pos);
+
+			state_type &estate2 = NFAs[pos];
+
+			estate2.next1 = static_cast<si_l32>(atomno) - static_cast<si_l32>(pos);
+			estate2.next2 = 0;
 		}
 	}
-#endif	//  !defined(SRELLDBG_NO_ASTERISK_OPT)
 
-	void insert_at(const state_size_type pos, const std::ptrdiff_t len)
+	bool is_exclusive_way(const state_size_type atomno, const state_size_type otherno) const
 	{
-		state_type newstate;
+		const state_type &atom = this->NFA_states[atomno];
+		range_pairs atomchars;
+		range_pairs otherchars;
 
-		for (state_size_type cur = 0; cur < pos; ++cur)
+		if (atom.type == st_character)
+			atomchars.join(range_pair_helper(atom.char_num));
+		else if (atom.type == st_character_class)
+			atomchars = this->character_class[atom.char_num];
+		else
+			return false;
+
+		if (atom.next1 == 0 || atom.next2 != 0)
+			return false;
+
+		const bool canbe0length = gather_nextchars(otherchars, otherno, 0u, true);
+
+		return !canbe0length && otherchars.size() && !atomchars.is_overlap(otherchars);
+	}
+
+	//  NFA_states[0].next1 and next2 are absolute but they are counted and
+	//  redirected correctly as seen from position 0.
+	ui_l32 count_referrers(const state_size_type target) const
+	{
+		const state_array &NFAs = this->NFA_states;
+		simple_array<bool> reachable;
+		ui_l32 count = 0u;
+
+		mark_reachable(reachable);
+
+		for (state_size_type pos = 0; pos < NFAs.size(); ++pos)
 		{
-			state_type &state = this->NFA_states[cur];
+			const state_type &state = NFAs[pos];
 
-			if (state.next1 && (cur + state.next1) >= pos)
-				state.next1 += len;
+			if (!reachable[pos])
+				continue;
 
-			if (state.next2 && (cur + state.next2) >= pos)
-				state.next2 += len;
+			if (state.next1 && pos + state.next1 == target)
+				++count;
+			if (state.next2 && pos + state.next2 == target)
+				++count;
 		}
+		return count;
+	}
 
-		for (state_size_type cur = pos; cur < this->NFA_states.size(); ++cur)
+	void redirect_referrers(const state_size_type from, const state_size_type to, const state_size_type except)
+	{
+		for (state_size_type pos = 0; pos < this->NFA_states.size(); ++pos)
 		{
-			state_type &state = this->NFA_states[cur];
+			state_type &state = this->NFA_states[pos];
 
-			if ((cur + state.next1) < pos)
-				state.next1 -= len;
+			if (pos == except)
+				continue;
 
-			if ((cur + state.next2) < pos)
-				state.next2 -= len;
+			if (state.next1 && pos + state.next1 == from)
+				state.next1 = static_cast<si_l32>(to) - static_cast<si_l32>(pos);
+			if (state.next2 && pos + state.next2 == from)
+				state.next2 = static_cast<si_l32>(to) - static_cast<si_l32>(pos);
 		}
-
-		newstate.reset(st_epsilon);
-		for (std::ptrdiff_t count = 0; count < len; ++count)
-			this->NFA_states.insert(pos, newstate);
 	}
 
-#if !defined(SRELLDBG_NO_STATEHOOK)
+#endif	//  !defined(SRELLDBG_NO_GROUP_ASTERISK_OPT) && !defined(SRELLDBG_NO_ASTERISK_OPT)
 
-	void reorder_piece(state_array &piece) const
+#if !defined(SRELLDBG_NO_REPEAT_ATOM)
+
+	//  Replaces a loop over one character or character class with one
+	//  repeat_atom state, which consumes the whole run at a time:
+	//  1. A self-looping character or character_class, made possessive
+	//     by asterisk_optimisation().
+	//  2. A greedy epsilon followed by a character or character_class that
+	//     jumps back to it. Its second state becomes repeat_atom_pop, which
+	//     gives back one character each time the automaton backtracks to it.
+	//  3. A greedy counter over a character or character_class, such as
+	//     [0-9a-f]{64} or .{0,1000}. The minimum and maximum are moved to
+	//     the quantifier of repeat_atom_pop, made out of restore_counter,
+	//     and the run is given back only down to the minimum.
+	void repeat_atom_optimisation()
 	{
-		simple_array<ui_l32> newpos;
-		ui_l32 offset = 0;
+		state_array &NFAs = this->NFA_states;
+		simple_array<ui_l32> refcounts;
+		simple_array<bool> reachable;
 
-		newpos.resize(piece.size() + 1, 0);
-		newpos[piece.size()] = piece.size();
+		refcounts.resize(NFAs.size(), 0u);
+		mark_reachable(reachable);
 
-		for (ui_l32 indx = 0; indx < piece.size(); ++indx)
+		for (state_size_type pos = 0; pos < NFAs.size(); ++pos)
 		{
-			if (newpos[indx] == 0)
+			const state_type &state = NFAs[pos];
+
+			if (!reachable[pos])
+				continue;
+
+			if (state.next1)
+				++refcounts[pos + state.next1];
+			if (state.next2)
+				++refcounts[pos + state.next2];
+		}
+
+		for (state_size_type pos = 1; pos < NFAs.size(); ++pos)
+		{
+			state_type &state = NFAs[pos];
+
+			if (state.is_character_or_class() && state.next1 == 0 && state.next2 != 0)
 			{
-				newpos[indx] = indx + offset;
+				set_repeat_atom(state, state);
+				state.next1 = state.next2;
+				state.next2 = 0;
+				state.quantifier.is_greedy = 0u;
+			}
+			else if (state.type == st_epsilon && state.next1 == 1 && state.next2 != 0 && pos + 1 < NFAs.size())
+			{
+				state_type &atom = NFAs[pos + 1];
 
-				state_type &st = piece[indx];
+				if (atom.is_character_or_class() && atom.next1 == -1 && atom.next2 == 0 && refcounts[pos + 1] == 1u)
+				{
+					set_repeat_atom(state, atom);
+					state.next1 = state.next2;
+					state.next2 = 1;
+					state.quantifier.is_greedy = 1u;
+
+					atom.type = st_repeat_atom_pop;
+					atom.next1 = state.next1 - 1;
+					atom.next2 = -1;
+				}
+			}
+#if !defined(SRELLDBG_NO_BOUNDED_REPEAT)
+			else if (state.type == st_save_and_reset_counter && state.next2 == 1)
+			{
+				//  1.save_and_reset_counter(3|2), 2.restore_counter,
+				//  3.check_counter(ATOM|OutOfLoop), ATOM(3).
+				const state_size_type checkno = pos + state.next1;
+				const state_type &check = NFAs[checkno];
 
-				if (st.flags & sflags::hooking)
+				if (check.type != st_check_counter || check.char_num != state.char_num || !check.quantifier.is_greedy
+						|| refcounts[checkno] != 2u || refcounts[pos + 1] != 1u)
+					continue;
+
+				const state_size_type atomno = checkno + check.next1;
+				const state_type &atom = NFAs[atomno];
+
+				if (atom.is_character_or_class() && atom.next2 == 0 && atomno + atom.next1 == checkno && refcounts[atomno] == 1u)
 				{
-					st.flags ^= sflags::hooking;
-					++offset;
-					newpos[indx + st.next1] = indx + offset;
+					const re_quantifier bounds(check.quantifier);
+					const si_l32 outofloop = static_cast<si_l32>(checkno + check.next2) - static_cast<si_l32>(pos);
+					state_type &pop = NFAs[pos + 1];
+
+					set_repeat_atom(state, atom);
+					state.flags |= 16u;
+					state.next1 = outofloop;
+					state.next2 = 1;
+					state.quantifier.is_greedy = bounds.atleast < bounds.atmost ? 1u : 0u;
+
+					pop.reset(st_repeat_atom_pop);
+					pop.quantifier = bounds;
+					pop.next1 = outofloop - 1;
+					pop.next2 = -1;
 				}
 			}
-			else
-				--offset;
+#endif
 		}
+	}
 
-		state_array newpiece(piece.size());
+	void set_repeat_atom(state_type &state, const state_type &atom) const
+	{
+		const re_quantifier ccpos(atom.quantifier);
+		ui_l32 flags = 0u;
+		ui_l32 char_num = atom.char_num;
 
-		for (state_size_type indx = 0; indx < piece.size(); ++indx)
+		if (atom.type == st_character_class)
 		{
-			state_type &st = piece[indx];
-
-			if (st.next1 != 0)
-				st.next1 = static_cast<std::ptrdiff_t>(newpos[indx + st.next1]) - newpos[indx];
+			const range_pairs ranges(this->character_class[atom.char_num]);
 
-			if (st.next2 != 0)
-				st.next2 = static_cast<std::ptrdiff_t>(newpos[indx + st.next2]) - newpos[indx];
-
-			newpiece[newpos[indx]] = piece[indx];
+			//  [^c] where c is in the ASCII range can be searched for
+			//  as a code unit.
+			if (ranges.size() == 2 && ranges[0].first == 0 && ranges[1].second == constants::unicode_max_codepoint
+				&& ranges[0].second + 2 == ranges[1].first && ranges[0].second < 0x7f)
+			{
+				flags = 1u;
+				char_num = ranges[0].second + 1;
+			}
+			else
+				flags = 8u;
 		}
-		newpiece.swap(piece);
+		state.type = st_repeat_atom;
+		state.char_num = char_num;
+		state.quantifier = ccpos;
+		state.flags = flags;
 	}
 
-#endif	//  !defined(SRELLDBG_NO_STATEHOOK)
+#endif	//  !defined(SRELLDBG_NO_REPEAT_ATOM)
 
-	bool check_if_backref_used(state_size_type pos, const ui_l32 number) const
+#if !defined(SRELLDBG_NO_CHARSWITCH) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+
+	//  Replaces the first state of each long chain of characters linked by
+	//  next2, which branch_optimisation2() makes out of an alternation, with
+	//  a character_switch state. It looks the character up in a sorted table
+	//  of the chain instead of comparing it with each state in turn. As the
+	//  characters in a chain are exclusive, the order of the alternatives
+	//  does not matter; when a character appears twice, the first one wins.
+	void character_switch_optimisation()
 	{
-		for (; pos < this->NFA_states.size(); ++pos)
+		static const ui_l32 minchainlen = 4u;
+		state_array &NFAs = this->NFA_states;
+		simple_array<bool> chained;
+		simple_array<range_pair> cases;
+
+		chained.resize(NFAs.size(), false);
+
+		for (state_size_type pos = 1; pos < NFAs.size(); ++pos)
 		{
-			const state_type &state = this->NFA_states[pos];
+			const state_type &state = NFAs[pos];
 
-			if (state.type == st_backreference && state.char_num == number)
-				return true;
+			if (state.type == st_character && state.next2)
+				chained[pos + state.next2] = true;
 		}
-		return false;
-	}
-
-#if !defined(SRELLDBG_NO_BRANCH_OPT) || !defined(SRELLDBG_NO_BRANCH_OPT2)
 
-	state_size_type gather_if_char_or_charclass(range_pairs &charclass, state_size_type pos) const
-	{
-		for (;;)
+		for (state_size_type pos = 1; pos < NFAs.size(); ++pos)
 		{
-			const state_type &cst = this->NFA_states[pos];
+			state_type &state = NFAs[pos];
 
-			if (cst.next2 != 0)
-				break;
+			if (state.type != st_character || state.next1 == 0 || state.next2 == 0 || chained[pos])
+				continue;
 
-			if (cst.type == st_character)
-			{
-				charclass.set_solerange(range_pair_helper(cst.char_num));
-				return pos;
-			}
-			else if (cst.type == st_character_class)
-			{
-				charclass = this->character_class[cst.char_num];
-				return pos;
-			}
-			else if (cst.type == st_epsilon && cst.char_num != epsilon_type::et_jmpinlp)
+			state_size_type member = pos;
+
+			cases.clear();
+			for (;;)
 			{
-				pos += cst.next1;
+				const state_type &mstate = NFAs[member];
+
+				//  The chain may end with a state of another type, to which
+				//  the automaton goes with the character given back.
+				if (mstate.type != st_character || mstate.next1 == 0)
+					break;
+
+				add_switch_case(cases, mstate.char_num, static_cast<ui_l32>(member + mstate.next1));
+
+				if (mstate.next2 == 0)
+				{
+					member = 0;
+					break;
+				}
+				member += mstate.next2;
 			}
-			else
-				break;
+
+			if (cases.size() < minchainlen)
+				continue;
+
+			const ui_l32 offset = static_cast<ui_l32>(this->switch_cases.size());
+
+			for (state_size_type i = 0; i < cases.size(); ++i)
+				this->switch_cases.push_back(cases[i]);
+
+			//  The other states of the chain are left as they are, for the
+			//  states that may jump into the middle of it.
+			state.type = st_character_switch;
+			state.char_num = offset;
+			state.quantifier.reset(static_cast<ui_l32>(cases.size()));
+			state.next1 = 0;
+			state.next2 = member ? static_cast<si_l32>(member - pos) : 0;
 		}
-		return 0;
 	}
-#endif	//  !defined(SRELLDBG_NO_BRANCH_OPT) || !defined(SRELLDBG_NO_BRANCH_OPT2)
 
-#if !defined(SRELLDBG_NO_BRANCH_OPT)
-	void branch_optimisation()
+	static void add_switch_case(simple_array<range_pair> &cases, const ui_l32 ch, const ui_l32 target)
 	{
-		range_pairs nextcharclass1;
+		state_size_type i = cases.size();
 
-		for (state_size_type pos = 1; pos < this->NFA_states.size(); ++pos)
+		for (; i && cases[i - 1].first >= ch; --i)
+			if (cases[i - 1].first == ch)
+				return;
+
+		range_pair newcase;
+
+		newcase.set(ch, target);
+		cases.insert(i, newcase);
+	}
+
+#endif	//  !defined(SRELLDBG_NO_CHARSWITCH) && !defined(SRELLDBG_NO_ASTERISK_OPT)
+
+#if !defined(SRELLDBG_NO_STRING_OPT)
+
+	//  Replaces each run of character states through which the automaton
+	//  can only go straight with one string state, and removes the rest of
+	//  the run.
+	void string_optimisation()
+	{
+		const state_array &NFAs = this->NFA_states;
+		simple_array<ui_l32> refcounts;
+		simple_array<state_size_type> newpos;
+		state_array newNFAs;
+		charT seq[utf_traits::maxseqlen];
+
+		refcounts.resize(NFAs.size(), 0u);
+		newpos.resize(NFAs.size(), 0);
+
+		for (state_size_type pos = 0; pos < NFAs.size(); ++pos)
 		{
-			const state_type &state = this->NFA_states[pos];
+			const state_type &state = NFAs[pos];
 
-			if (state.is_branch())
+			if (state.next1)
+				++refcounts[pos + state.next1];
+			if (state.next2)
+				++refcounts[pos + state.next2];
+		}
+
+		for (state_size_type i = 0; i < this->switch_cases.size(); ++i)
+			++refcounts[this->switch_cases[i].second];
+
+		newNFAs.push_back(NFAs[0]);
+
+		for (state_size_type pos = 1; pos < NFAs.size();)
+		{
+			state_size_type last = pos;
+
+			//  A state can join the run only if nothing but its predecessor
+			//  in the run jumps to it.
+			for (; is_string_member(NFAs[last]) && NFAs[last].next1 == 1; ++last)
+				if (refcounts[last + 1] != 1u || !is_string_member(NFAs[last + 1]))
+					break;
+
+			newpos[pos] = newNFAs.size();
+			newNFAs.push_back(NFAs[pos]);
+
+			if (last != pos)
 			{
-				const state_size_type nextcharpos = gather_if_char_or_charclass(nextcharclass1, pos + state.next1);
+				state_type &strstate = newNFAs.back();
+				const ui_l32 offset = static_cast<ui_l32>(this->strings.size());
 
-				if (nextcharpos)
+				for (state_size_type i = pos; i <= last; ++i)
 				{
-					range_pairs nextcharclass2;
-					const bool canbe0length = gather_nextchars(nextcharclass2, pos + state.next2, 0u /* bracket_number */, true);
+					const ui_l32 seqlen = utf_traits::to_codeunits(seq, NFAs[i].char_num);
 
-					if (!canbe0length && !nextcharclass1.is_overlap(nextcharclass2))
-					{
-						state_type &branch = this->NFA_states[pos];
-						state_type &next1 = this->NFA_states[nextcharpos];
+					for (ui_l32 j = 0; j < seqlen; ++j)
+						this->strings.push_back(seq[j]);
 
-						next1.next2 = pos + branch.next2 - nextcharpos;
-						branch.next2 = 0;
-						branch.char_num = epsilon_type::et_bo1fmrbr;
-					}
+					newpos[i] = newpos[pos];
 				}
+
+				strstate.type = st_string;
+				strstate.char_num = offset;
+				strstate.quantifier.reset(static_cast<ui_l32>(this->strings.size()) - offset);
+				strstate.next1 = static_cast<si_l32>(last - pos) + NFAs[last].next1;
+#if defined(SRELL_ENABLE_PROFILER)
+				strstate.srcspan = merge_srcspans(strstate.srcspan, NFAs[last].srcspan);
+#endif
 			}
+			pos = last + 1;
 		}
-	}
-#endif	//  !defined(SRELLDBG_NO_BRANCH_OPT)
 
-#if !defined(SRELLDBG_NO_BMH)
-	void setup_bmhdata()
-	{
-		simple_array<ui_l32> u32s;
+		if (newNFAs.size() == NFAs.size())
+			return;
 
-		for (state_size_type i = 1; i < this->NFA_states.size(); ++i)
+		for (state_size_type pos = 1, newno = 1; pos < NFAs.size(); ++pos)
 		{
-			const state_type &state = this->NFA_states[i];
+			if (newpos[pos] != newno)
+				continue;	//  Removed.
 
-			if (state.type == st_character)
-				u32s.push_backncr(state.char_num);
-			else
-			{
-				u32s.clear();
-				break;
-			}
+			state_type &state = newNFAs[newno];
+
+			//  next1 == 0 in character, character_class, and character_switch remains 0.
+			state.next1 = static_cast<si_l32>(newpos[pos + state.next1]) - static_cast<si_l32>(newno);
+			if (state.next2)
+				state.next2 = static_cast<si_l32>(newpos[pos + state.next2]) - static_cast<si_l32>(newno);
+			++newno;
 		}
 
-		if (u32s.size() > 1)
-//		if ((u32s.size() > 1 && !this->is_ricase()) || (u32s.size() > 2 && this->is_ricase()))
+		state_type &entry = newNFAs[0];
+
+		entry.next1 = static_cast<si_l32>(newpos[entry.next1]);
+		entry.next2 = static_cast<si_l32>(newpos[entry.next2]);
+
+		for (state_size_type i = 0; i < this->switch_cases.size(); ++i)
+			this->switch_cases[i].second = static_cast<ui_l32>(newpos[this->switch_cases[i].second]);
+
+		this->NFA_states.swap(newNFAs);
+	}
+
+	bool is_string_member(const state_type &state) const
+	{
+		//  Surrogates are left alone, as a code unit sequence containing them
+		//  can compare equal to a sequence decoded into another code point.
+		return state.type == st_character && state.next1 != 0 && state.next2 == 0
+			&& (state.char_num < 0xd800 || state.char_num > 0xdfff);
+	}
+
+#if defined(SRELL_ENABLE_PROFILER)
+	static range_pair merge_srcspans(const range_pair &left, const range_pair &right)
+	{
+		range_pair merged;
+
+		if (left.second == 0 || right.second == 0)
+			merged.set(0);
+		else
+			merged.set(left.first < right.first ? left.first : right.first, left.second > right.second ? left.second : right.second);
+		return merged;
+	}
+#endif
+
+#endif	//  !defined(SRELLDBG_NO_STRING_OPT)
+
+#if !defined(SRELLDBG_NO_SKIP_EPSILON)
+
+	void skip_epsilon()
+	{
+		for (state_size_type pos = 0; pos < this->NFA_states.size(); ++pos)
 		{
-			if (this->bmdata)
-				this->bmdata->clear();
-			else
-				this->bmdata = new re_bmh<charT, utf_traits>;
+			state_type &state = this->NFA_states[pos];
 
-			this->bmdata->setup(u32s, this->is_ricase());
-			return /* false */;
-		}
+			if (state.next1)
+				state.next1 = static_cast<std::ptrdiff_t>(skip_nonbranch_epsilon(pos + state.next1)) - pos;
 
-		if (this->bmdata)
-			delete this->bmdata;
-		this->bmdata = NULL;
-//		return true;
+			if (state.next2)
+				state.next2 = static_cast<std::ptrdiff_t>(skip_nonbranch_epsilon(pos + state.next2)) - pos;
+		}
 	}
-#endif	//  !defined(SRELLDBG_NO_BMH)
 
-#if !defined(SRELLDBG_NO_CCPOS)
-	void set_charclass_posinfo()
+	state_size_type skip_nonbranch_epsilon(state_size_type pos) const
 	{
-		this->character_class.finalise();
-		for (state_size_type i = 1; i < this->NFA_states.size(); ++i)
+		for (;;)
 		{
-			state_type &state = this->NFA_states[i];
+			const state_type &state = this->NFA_states[pos];
 
-			if (state.type == st_character_class || state.type == st_bol || state.type == st_eol || state.type == st_boundary)
+			if (state.type == st_epsilon && state.next2 == 0)
 			{
-				const range_pair &posinfo = this->character_class.charclasspos(state.char_num);
-				state.quantifier.set(posinfo.first, posinfo.second);
+				pos += state.next1;
+				continue;
 			}
+			break;
 		}
+		return pos;
 	}
-#endif	//  !defined(SRELLDBG_NO_CCPOS)
 
-#if !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
+#endif
 
-	void branch_optimisation2()
-	{
-		bool hooked = false;
-		range_pairs basealt1stch;
-		range_pairs nextalt1stch;
+#if !defined(SRELLDBG_NO_ASTERISK_OPT)
 
-		for (state_size_type pos = 1; pos < this->NFA_states.size(); ++pos)
+	void asterisk_optimisation()
+	{
+		for (state_size_type pos = 1u; pos < this->NFA_states.size(); ++pos)
 		{
-			const state_type &curstate = this->NFA_states[pos];
+			state_type &curstate = this->NFA_states[pos];
 
-			if (curstate.type == st_epsilon && curstate.next2 != 0 && curstate.char_num == epsilon_type::et_alt)	//  '|'
+			switch (curstate.type)
 			{
-				const state_size_type next1pos = pos + curstate.next1;
-				state_size_type precharchainpos = pos;
-
-				if (gather_if_char_or_charclass(basealt1stch, next1pos) != 0)
+			case st_character:
+			case st_character_class:
+				if (this->NFA_states[pos - 1].is_question_or_asterisk_before_corcc())
 				{
-					state_type &next1ref = this->NFA_states[next1pos];
-					state_size_type next2pos = precharchainpos + curstate.next2;
-					state_size_type postcharchainpos = 0;
+					state_type &estate = this->NFA_states[pos - 1];
+					const state_size_type nextno = pos + estate.farnext() - 1;
 
-					for (;;)
+					if (is_exclusive_sequence(estate.quantifier, pos, nextno))
 					{
-						state_size_type next2next1pos = next2pos;
-						state_type &nstate2 = this->NFA_states[next2pos];
-						state_size_type next2next2pos = 0;
+						state_type &estate2 = this->NFA_states[pos - 1];
+						state_type &corccstate = this->NFA_states[pos];
 
-						if (nstate2.type == st_epsilon)
-						{
-							if (nstate2.next2 != 0)
-							{
-								if (nstate2.char_num == epsilon_type::et_alt)	//  '|'
-									next2next2pos = next2pos + nstate2.next2;
-							}
-							next2next1pos += nstate2.next1;
-						}
+						estate2.next1 = 1;
+						estate2.next2 = 0;
+						estate2.char_num = epsilon_type::et_aofmrast;
 
-						if (gather_if_char_or_charclass(nextalt1stch, next2next1pos) != 0)
-						{
-							const int relation = basealt1stch.relationship(nextalt1stch);
+						if (corccstate.next1 < 0)
+							corccstate.next1 = 0;
 
-							if (relation == 0)
-							{
-								state_type &prechainalt = this->NFA_states[precharchainpos];
-								state_type &becomes_unused = this->NFA_states[next2next1pos];
-								const state_size_type next1next1pos = next1pos + next1ref.next1;
+						corccstate.next2 = nextno - pos;
+					}
+				}
+				continue;
 
-								becomes_unused.type = st_epsilon;
+			default:;
+			}
+		}
+	}
 
-								if (next2next2pos)
-								{
-									becomes_unused.char_num = epsilon_type::et_bo2fmrbr;	//  '2'
+	bool is_exclusive_sequence(const re_quantifier &eq, const state_size_type curno, const state_size_type nextno)	//  const
+	{
+		const state_type &curstate = this->NFA_states[curno];
+		range_pairs curchar_class;
+		range_pairs nextchar_class;
 
-									if (postcharchainpos == 0)
-									{
-										nstate2.next1 = next1next1pos - next2pos;
-										nstate2.next2 = next2next1pos - next2pos;
+		if (curstate.type == st_character)
+		{
+			curchar_class.join(range_pair_helper(curstate.char_num));
+		}
+		else if (curstate.type == st_character_class)
+		{
+			curchar_class = this->character_class[curstate.char_num];
+			if (curchar_class.size() == 0)	//  Means [], which always makes matching fail.
+				return true;	//  For preventing the automaton from pushing bt data.
+		}
+		else
+		{
+			return false;
+		}
 
-										next1ref.next1 = next2pos - next1pos;
-										next1ref.flags |= sflags::hooking;
-										hooked = true;
-									}
-									else
-									{
-										state_type &becomes_alt = this->NFA_states[postcharchainpos];
+		const bool canbe0length = gather_nextchars(nextchar_class, nextno, 0u, true);
 
-										becomes_alt.char_num = epsilon_type::et_alt;	//  '|' <- '2'
-										becomes_alt.next2 = next2next1pos - postcharchainpos;
+		if (nextchar_class.size())
+		{
+			if (!canbe0length || eq.is_greedy)
+			{
+#if !defined(SRELLDBG_NO_SPLITCC)
 
-										nstate2.next2 = 0;
-										nstate2.char_num = epsilon_type::et_bo2skpd;	//  '!'
-									}
-									postcharchainpos = next2next1pos;
-									prechainalt.next2 = next2next2pos - precharchainpos;
-								}
-								else
-								{
-									if (postcharchainpos == 0)
-									{
-										becomes_unused.char_num = epsilon_type::et_alt;	//  '|'
-										becomes_unused.next2 = becomes_unused.next1;
-										becomes_unused.next1 = next1next1pos - next2next1pos;
+				range_pairs kept;
+				range_pairs removed;
 
-										next1ref.next1 = next2next1pos - next1pos;
-										next1ref.flags |= sflags::hooking;
-										hooked = true;
-									}
-									else
-									{
-										state_type &becomes_alt = this->NFA_states[postcharchainpos];
+				curchar_class.split_ranges(kept, removed, nextchar_class);
 
-										becomes_alt.char_num = epsilon_type::et_alt;	//  '|' <- '2'
-										becomes_alt.next2 = next2next1pos + becomes_unused.next1 - postcharchainpos;
+				if (removed.size() == 0)	//  !curchar_class.is_overlap(nextchar_class)
+					return true;
 
-										becomes_unused.char_num = epsilon_type::et_bo2skpd;	//  '!'
-									}
-									prechainalt.next2 = 0;
-									prechainalt.char_num = epsilon_type::et_bo2fmrbr;	//  '2'
-								}
-							}
-							else if (relation == 1)
-							{
-								break;
-							}
-							else
-								precharchainpos = next2pos;
-						}
+				if (curstate.type == st_character_class && kept.size() && eq.is_infinity())
+				{
+					{
+						state_type &curstate2 = this->NFA_states[curno];
+
+						curstate2.char_num = kept.consists_of_one_character(this->is_icase());
+						if (curstate2.char_num != constants::invalid_u32value)
+							curstate2.type = st_character;
 						else
-						{
-							//  Fix for bug210428.
-							//  Original: /mm2|m|mm/
-							//  1st step: /m(?:m2||m)/ <- No more optimisation can be performed. Must quit.
-							//  2nd step: /mm(?:2||)/ <- BUG.
-							break;
-						}
+							curstate2.char_num = this->character_class.register_newclass(kept);
+					}
+					const re_quantifier backupeq(eq);
 
-						if (next2next2pos == 0)
-							break;
+					insert_at(nextno, 2);
+					state_type &n0 = this->NFA_states[nextno];
+					state_type &n1 = this->NFA_states[nextno + 1];
 
-						next2pos = next2next2pos;
+					n0.reset(st_epsilon, epsilon_type::et_ccastrsk);
+					n0.quantifier = backupeq;
+//					n0.next2 = 1;
+					n0.next2 = 2;
+					if (!n0.quantifier.is_greedy)
+					{
+						n0.next1 = n0.next2;
+						n0.next2 = 1;
 					}
+
+					n1.reset(st_character_class, removed.consists_of_one_character(this->is_icase()));
+
+					if (n1.char_num != constants::invalid_u32value)
+						n1.type = st_character;
+					else
+						n1.char_num = this->character_class.register_newclass(removed);
+
+					n1.next1 = -2;
+//					n1.next2 = 0;
+					return true;
 				}
-			}
-		}
 
-		if (hooked)
-			reorder_piece(this->NFA_states);
-	}
-#endif	//   !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
+#else	//  defined(SRELLDBG_NO_SPLITCC)
 
-#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
+				if (!curchar_class.is_overlap(nextchar_class))
+				{
+					return true;
+				}
 
-	void find_entrypoint()
-	{
-		if (find_singlechar_ep(1u))
-			return;
+#endif	//  !defined(SRELLDBG_NO_SPLITCC)
+			}
+		}
+		else if (/* nextchar_class.size() == 0 && */ (!canbe0length || only_success_left(nextno)))
+		{
+			//  (size() == 0 && !canbe0length) means [].
+			return eq.is_greedy ? true : false;
+		}
 
-		find_better_ep(1u);
+		return false;
 	}
 
-	bool find_singlechar_ep(state_size_type cur)
+	bool only_success_left(state_size_type pos) const
 	{
-		state_size_type curatompos = 0;
-		state_size_type singlecharpos = 0;
-		state_size_type seqpos = 0;
-		ui_l32 prevchar = constants::invalid_u32value;
-		ui_l32 charcount = 0;
-		bool needs_rerun = false;
-
-		for (; cur < this->NFA_states.size();)
+		for (;;)
 		{
-			const state_type &state = this->NFA_states[cur];
+			const state_type &state = this->NFA_states[pos];
 
 			switch (state.type)
 			{
-			case st_character:
-				curatompos = cur;
-				ST_CHARACTER:
-				if (prevchar != constants::invalid_u32value)
-					seqpos = curatompos;
-
-				singlecharpos = curatompos;
-				++charcount;
-				prevchar = this->NFA_states[cur].char_num;
-				++cur;
-				continue;
+			case st_success:
+				return true;
 
-			case st_character_class:
-				prevchar = constants::invalid_u32value;
-				++cur;
-				continue;
+			case st_roundbracket_close:
+			case st_backreference:
+				if (state.next2 != 0 && state.next1 != state.next2)
+					return false;
+				break;
 
 			case st_epsilon:
-				if (state.next2 == 0)
-				{
-					if (state.char_num == epsilon_type::et_jmpinlp)
-					{
-						const state_size_type rapos = cur + state.next1;
-						const state_type &repatom = this->NFA_states[rapos];
-
-						if (repatom.type == st_character)
-						{
-							curatompos = cur;
-							cur = rapos;
-							needs_rerun = true;
-							goto ST_CHARACTER;
-						}
-						prevchar = constants::invalid_u32value;
-						cur = rapos;
-					}
-					else
-						++cur;
-					continue;
-				}
-
-				if ((state.char_num == epsilon_type::et_ccastrsk)
-					|| ((state.char_num == epsilon_type::et_dfastrsk)
-						&& (is_reversible_atom(cur + state.nearnext(), true))))
-				{
-					cur += state.farnext();
-					needs_rerun = true;
-					prevchar = constants::invalid_u32value;
-					continue;
-				}
+				if (state.next2 != 0 && !only_success_left(pos + state.next2))
+					return false;
 				break;
 
-			case st_check_counter:
-				{
-					const state_size_type rapos = cur + 3;
-					const state_type &repatom = this->NFA_states[rapos];
+			case st_roundbracket_open:
+				break;	//  /a*()/
 
-					if (repatom.type == st_character)
-					{
-						curatompos = cur;
-						cur = rapos;
-						needs_rerun = state.quantifier.is_same();
-						goto ST_CHARACTER;
-					}
-
-					if (is_reversible_atom(rapos, state.quantifier.atleast == 0))
-					{
-						cur += state.farnext();
-						needs_rerun = true;
-						prevchar = constants::invalid_u32value;
-						continue;
-					}
-				}
-				break;
+			default:
+				return false;
+			}
+			if (state.next1)
+				pos += state.next1;
+			else
+				return false;
+		}
+	}
+#endif	//  !defined(SRELLDBG_NO_ASTERISK_OPT)
 
-			case st_roundbracket_open:
-				if (check_if_backref_used(cur + 1, state.char_num))
-					break;
+	void insert_at(const state_size_type pos, const std::ptrdiff_t len)
+	{
+		state_type newstate;
 
-				needs_rerun = true;
-				//@fallthrough@
+		for (state_size_type cur = 0; cur < pos; ++cur)
+		{
+			state_type &state = this->NFA_states[cur];
 
-			case st_save_and_reset_counter:
-			case st_repeat_in_push:
-				cur += state.next1;
-				continue;
+			if (state.next1 && (cur + state.next1) >= pos)
+				state.next1 += len;
 
-			case st_check_0_width_repeat:
-				cur += state.next2;
-				continue;
+			if (state.next2 && (cur + state.next2) >= pos)
+				state.next2 += len;
+		}
 
-			case st_backreference:
-			case st_lookaround_open:
-				break;	//  Gives up.
+		for (state_size_type cur = pos; cur < this->NFA_states.size(); ++cur)
+		{
+			state_type &state = this->NFA_states[cur];
 
-			case st_restore_counter:
-			case st_decrement_counter:
-			case st_roundbracket_pop:
-			case st_repeat_in_pop:
-			case st_lookaround_pop:
-				break;	//  NFA_states broken.
+			if ((cur + state.next1) < pos)
+				state.next1 -= len;
 
-			default:
-				++cur;
-				continue;
-			}
-			break;
+			if ((cur + state.next2) < pos)
+				state.next2 -= len;
 		}
 
-		return seqpos != 0
-			? (create_rewinder(seqpos, needs_rerun), true)
-			: (charcount > 1 ? (create_rewinder(singlecharpos, needs_rerun), true) : false);
+		newstate.reset(st_epsilon);
+		for (std::ptrdiff_t count = 0; count < len; ++count)
+			this->NFA_states.insert(pos, newstate);
 	}
 
-	bool is_reversible_atom(const state_size_type pos, const bool check_optseq) const
+	//  skip_epsilon() and the optimisations after it leave the states they
+	//  have bypassed where they are. Their jumps must not be counted.
+	void mark_reachable(simple_array<bool> &reachable) const
 	{
-		const state_type &s = this->NFA_states[pos];
-		state_size_type end = 0u;
-
-		if (s.type == st_character || s.type == st_character_class)
-			return true;
+		const state_array &NFAs = this->NFA_states;
+		simple_array<state_size_type> pending;
 
-		if (check_optseq)
-			return false;	//  Optional sequence (?, *, {0,m}) found.
-			//  Not only at the beginning but also at any position does
-			//  an optional sequence need measures to be taken:
-			//  "2000-1-1" =~ /\d(\d+-)?\d{1,2}-\d{1,2}/
+		reachable.resize(NFAs.size(), false);
+		reachable[0] = true;
+		pending.push_back(0u);
 
-		switch (s.type)
+		while (pending.size())
 		{
-		case st_epsilon:
-			if (s.next2 == 0 && s.char_num == epsilon_type::et_ncgopen)
-				end = skip_group(this->NFA_states, pos);
-			break;
-
-		case st_roundbracket_open:
-			if (check_if_backref_used(pos + 1, s.char_num))
-				return false;
+			const state_size_type pos = pending.back();
+			const state_type &state = NFAs[pos];
 
-			end = skip_bracket(s.char_num, this->NFA_states, pos);
-			break;
+			pending.pop_back();
 
-		case st_repeat_in_push:
-			end = skip_0width_checker(s.char_num, this->NFA_states, pos);
-			//@fallthrough@
+			if (state.next1 && !reachable[pos + state.next1])
+			{
+				reachable[pos + state.next1] = true;
+				pending.push_back(pos + state.next1);
+			}
+			if (state.next2 && !reachable[pos + state.next2])
+			{
+				reachable[pos + state.next2] = true;
+				pending.push_back(pos + state.next2);
+			}
+			if (state.type == st_character_switch)
+			{
+				for (ui_l32 i = 0; i < state.quantifier.atleast; ++i)
+				{
+					const state_size_type target = this->switch_cases[state.char_num + i].second;
 
-		default:;
+					if (!reachable[target])
+					{
+						reachable[target] = true;
+						pending.push_back(target);
+					}
+				}
+			}
 		}
-
-		return end != 0u && !has_obstacle_to_reverse(pos, end, false);
 	}
 
-	bool has_obstacle_to_reverse(state_size_type pos, const state_size_type end, const bool check_optseq) const
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+
+	//  Sets eol_anchored in NFA_states[0] if only $ without the multiline
+	//  flag leads to the final success, as in /\d+$/ or /a$|b$/. Then
+	//  every match ends at the end of the subject, and the search can
+	//  begin at most the maximum length before it.
+	void check_eol_anchoring()
 	{
-		for (; pos < end;)
-		{
-			const state_type &s = this->NFA_states[pos];
+		state_array &NFAs = this->NFA_states;
+		const state_size_type successno = NFAs.size() - 1;
+		simple_array<bool> reachable;
 
-			if (s.type == st_epsilon)
-			{
-				if (s.char_num == epsilon_type::et_alt)
-					return true;
-					//  The rewinder cannot support Disjunction because forward matching
-					//  and backward matching can go through different routes:
-					//  * In a forward search /(?:.|ab)c/ against "abc" matches "abc",
-					//    while in a backward search from 'c' it matches "bc".
+		if (NFAs[successno].type != st_success || NFAs[0].quantifier.atmost == constants::infinity
+				|| static_cast<state_size_type>(NFAs[0].next1) == successno || static_cast<state_size_type>(NFAs[0].next2) == successno)
+			return;
 
-				//  Because of the same reason, the rewinder cannot support an optional
-				//  group either. Semantically, /(\d+-)?\d{1,2}-\d{1,2}/ is equivalent to
-				//  /(\d+-|)\d{1,2}-\d{1,2}/.
-				if (check_optseq)
-				{
-					if (s.char_num == epsilon_type::et_jmpinlp)
-					{
-						pos += s.next1;
-						continue;
-					}
+		mark_reachable(reachable);
 
-					if (s.char_num == epsilon_type::et_dfastrsk && s.next2 != 0 && !this->NFA_states[pos + s.nearnext()].is_character_or_class())
-						return true;
-				}
+		for (state_size_type pos = 1; pos < successno; ++pos)
+		{
+			const state_type &state = NFAs[pos];
 
+			if (!reachable[pos])
+				continue;
+
+			if ((state.next1 && pos + state.next1 == successno) || (state.next2 && pos + state.next2 == successno))
+			{
+				if (state.type != st_eol || state.flags)
+					return;
 			}
-			else if (s.type == st_backreference)
-				return true;
-			else if (s.type == st_lookaround_open)
-				return true;
-			else if (check_optseq && s.type == st_check_counter)
+
+			//  A case of a switch may also lead to the success.
+			if (state.type == st_character_switch)
 			{
-				if (s.quantifier.atleast == 0 && !this->NFA_states[pos + 3].is_character_or_class())
-					return true;
-				pos += 3;
-				continue;
+				for (ui_l32 i = 0; i < state.quantifier.atleast; ++i)
+					if (this->switch_cases[state.char_num + i].second == successno)
+						return;
 			}
-			++pos;
 		}
-		return false;
+		NFAs[0].flags |= sflags::eol_anchored;
 	}
 
-	state_size_type skip_bracket(const ui_l32 no, const state_array &NFAs, state_size_type pos) const
+	//  Returns leading_dotstar if the expression begins with /.*/ or
+	//  /.+/ without the dotall flag, or leading_anystar if the class of
+	//  the loop contains every code point, as /[\s\S]*/ does. If a match
+	//  begins somewhere in a line, another begins where the line begins,
+	//  so the search needs to try only the beginning of each line, or only
+	//  the first position for leading_anystar. within_line is added if no
+	//  character or class in the expression matches a line terminator.
+	ui_l32 find_leading_star() const
 	{
-		return find_pair(st_roundbracket_close, NFAs, no, pos);
-	}
+		const state_array &NFAs = this->NFA_states;
+		state_size_type pos = 1;
 
-	state_size_type skip_0width_checker(const ui_l32 no, const state_array &NFAs, state_size_type pos) const
-	{
-		return find_pair(st_check_0_width_repeat, NFAs, no, pos);
-	}
+		if (NFAs.size() < 4)
+			return 0u;
 
-	state_size_type find_pair(const re_state_type type, const state_array &NFAs, const ui_l32 no, state_size_type pos) const
-	{
-		for (++pos; pos < NFAs.size(); ++pos)
+		if (NFAs[1].type == st_character_class)
+			++pos;	//  /.+/ -> /..*/.
+
+		const state_type &estate = NFAs[pos];
+		const state_type &ccstate = NFAs[pos + 1];
+
+		if (!estate.is_question_or_asterisk_before_corcc() || !estate.is_asterisk_or_plus_for_onelen_atom() || estate.quantifier.atleast != 0
+				|| ccstate.type != st_character_class || (pos == 2 && ccstate.char_num != NFAs[1].char_num))
+			return 0u;
+
+		if (ccstate.char_num == static_cast<ui_l32>(re_character_class::dotall))
+			return sflags::leading_anystar;
+
+		const range_pairs nlclass = this->character_class[static_cast<ui_l32>(re_character_class::newline)];
+		range_pairs dotclass = nlclass;
+
+		dotclass.negation();
+		if (this->character_class[ccstate.char_num].relationship(dotclass) != 0)
+			return 0u;
+
+		for (pos = 1; pos < NFAs.size(); ++pos)
 		{
-			const state_type &s = NFAs[pos];
+			const state_type &state = NFAs[pos];
 
-			if (s.type == type && s.char_num == no)
-				return pos;
+			if (state.type == st_character ? this->character_class.is_included(re_character_class::newline, state.char_num)
+					: (state.type == st_character_class && this->character_class[state.char_num].is_overlap(nlclass)))
+				return sflags::leading_dotstar;
 		}
-		return 0u;
+		return sflags::leading_dotstar | sflags::within_line;
 	}
 
-	state_size_type skip_group(const state_array &NFAs, state_size_type pos) const
+#endif	//  !defined(SRELLDBG_NO_SEARCH_PLAN)
+
+#if !defined(SRELLDBG_NO_REQUIREDCHARS)
+
+	//  Sets required_units to code units that every match contains. A code
+	//  unit is taken if the final success cannot be reached once the states
+	//  that consume it stop going forward. Assertions are not looked into,
+	//  nor are classes, so the set can be smaller than the real one.
+	void gather_required_units()
 	{
-		ui_l32 depth = 1u;
+		static const std::size_t maxtries = 32;
+		static const std::size_t maxunits = 8;
+		const state_array &NFAs = this->NFA_states;
+		simple_array<charT> units;	//  Consumed by NFAs[pos] in [unitpos[pos], unitpos[pos + 1]).
+		simple_array<state_size_type> unitpos;
+		simple_array<charT> tried;
 
-		for (++pos; pos < NFAs.size(); ++pos)
+		this->required_units.clear();
+
+#if !defined(SRELLDBG_NO_BMH)
+		if (this->bmdata)
+			return;	//  re_bmh looks for the whole string.
+#endif
+		if (NFAs.size() < 2 || NFAs[NFAs.size() - 1].type != st_success)
+			return;
+
+		for (state_size_type pos = 0; pos < NFAs.size(); ++pos)
 		{
-			const state_type &s = NFAs[pos];
+			unitpos.push_back(units.size());
+			append_consumed_units(units, NFAs[pos]);
+		}
+		unitpos.push_back(units.size());
 
-			if (s.type == st_epsilon)
+		for (state_size_type i = 0; i < units.size() && tried.size() < maxtries; ++i)
+		{
+			const charT cu = units[i];
+			state_size_type j = 0;
+
+			for (; j < tried.size() && tried[j] != cu; ++j);
+
+			if (j < tried.size())
+				continue;
+
+			tried.push_back(cu);
+
+			if (!reaches_success_without(cu, units, unitpos))
 			{
-				if (s.char_num == epsilon_type::et_ncgopen)
-					++depth;
-				else if (s.char_num == epsilon_type::et_ncgclose)
-				{
-					if (--depth == 0u)
-						return pos;
-				}
+#if !defined(SRELLDBG_NO_RAREUNIT)
+				//  Keeps the rarer ones first, as they are more likely
+				//  to be missing.
+				const unsigned int rank = unit_frequency::rank(cu & utf_traits::bitsetmask);
+				state_size_type inspos = 0;
+
+				for (; inspos < this->required_units.size() && unit_frequency::rank(this->required_units[inspos] & utf_traits::bitsetmask) <= rank; ++inspos);
+
+				this->required_units.insert(inspos, cu);
+#else
+				this->required_units.push_back(cu);
+#endif
+				if (this->required_units.size() == maxunits)
+					break;
 			}
 		}
-		return 0u;
 	}
 
-	void create_rewinder(const state_size_type end, const bool needs_rerun)
+	//  Appends the code units of the characters that state consumes when it
+	//  goes to next1. With icase, only the characters that have no other
+	//  case are counted.
+	void append_consumed_units(simple_array<charT> &units, const state_type &state) const
 	{
-		state_array newNFAs;
-		state_type rwstate;
-
-		newNFAs.append(this->NFA_states, 1u, end - 1u);
-		if (!reverse_atoms(newNFAs) || newNFAs.size() == 0u)
-			return;
+		charT seq[utf_traits::maxseqlen];
 
-		rwstate.reset(st_lookaround_pop, meta_char::mc_eq);
-		rwstate.quantifier.atmost = 0;
-		newNFAs.insert(0, rwstate);
+		if (state.type == st_character && state.next1 != 0)
+		{
+			if (!this->is_ricase() || unicode_case_folding::try_casefolding(state.char_num) == constants::invalid_u32value)
+			{
+				const ui_l32 seqlen = utf_traits::to_codeunits(seq, state.char_num);
 
-		rwstate.type = st_lookaround_open;
-		rwstate.next1 = static_cast<std::ptrdiff_t>(end + newNFAs.size() + 2) - 1;
-		rwstate.next2 = 1;
-		rwstate.quantifier.is_greedy = needs_rerun ? 3 : 2; //  Match point rewinder.
-			//  "singing" problem: /\w+ing/ against "singing" matches the
-			//  entire "singing". However, if modified like /(?<=\K\w+)ing/
-			//  it matches "sing" only, which is not correct (but correct if
-			//  /\w+?ing/). To avoid this problem, after rewinding is
-			//  finished rerunning the automaton forwards from the found
-			//  point is needed if the reversed states contain a variable
-			//  length (non fixed length) atom.
-			//  TODO: This rerunning can be avoided if the reversed atoms
-			//  are an exclusive sequence, like /\d+[:,]+\d+abcd/.
-		newNFAs.insert(0, rwstate);
+				for (ui_l32 i = 0; i < seqlen; ++i)
+					units.push_back(seq[i]);
+			}
+		}
+		else if (state.type == st_string)
+		{
+			const charT *cu = this->strings.data() + state.char_num;
+			const charT *const cuend = cu + state.quantifier.atleast;
 
-		rwstate.type = st_lookaround_close;
-		rwstate.next1 = 0;
-		rwstate.next2 = 0;
-		newNFAs.append(1, rwstate);
+			while (cu != cuend)
+			{
+				const charT *const begin = cu;
+				const ui_l32 uchar = utf_traits::codepoint_inc(cu, cuend);
 
-		this->NFA_states.insert(1, newNFAs);
-		this->NFA_states[0].next2 = static_cast<std::ptrdiff_t>(newNFAs.size()) + 1;
+				if (!this->is_ricase() || unicode_case_folding::try_casefolding(uchar) == constants::invalid_u32value)
+					for (const charT *p = begin; p != cu; ++p)
+						units.push_back(*p);
+			}
+		}
 	}
 
-	bool reverse_atoms(state_array &NFAs)
+	//  Returns true if a path leads from the entry to the final success
+	//  without going through a state that consumes cu. A lookaround is
+	//  stepped over, as it consumes nothing.
+	bool reaches_success_without(const charT cu, const simple_array<charT> &units, const simple_array<state_size_type> &unitpos) const
 	{
-		state_array revNFAs;
-		state_array atomseq;
-		state_type epsilon;
+		const state_array &NFAs = this->NFA_states;
+		const state_size_type successno = NFAs.size() - 1;
+		simple_array<bool> reached;
+		simple_array<state_size_type> pending;
 
-		epsilon.reset(st_epsilon, epsilon_type::et_rvfmrcg);
+		reached.resize(NFAs.size(), false);
+		pending.push_back(static_cast<state_size_type>(NFAs[0].next2));
+		reached[pending[0]] = true;
 
-		for (state_size_type cur = 0u; cur < NFAs.size();)
+		while (pending.size())
 		{
-			const state_type &state = NFAs[cur];
+			const state_size_type pos = pending.back();
+			const state_type &state = NFAs[pos];
+			state_size_type next[2] = { 0, 0 };
 
-			switch (state.type)
+			pending.pop_back();
+
+			if (pos == successno)
+				return true;
+
+			if (state.next1)
 			{
-			case st_epsilon:
-				if (state.is_noncapturinggroup_begin_or_end())
+				next[0] = pos + state.next1;
+
+				for (state_size_type i = unitpos[pos]; i < unitpos[pos + 1]; ++i)
 				{
-					revNFAs.insert(0, epsilon);
-					++cur;
-					continue;
+					if (units[i] == cu)
+					{
+						next[0] = 0;
+						break;
+					}
 				}
-				break;
+			}
+			if (state.next2 && state.type != st_lookaround_open)
+				next[1] = pos + state.next2;
 
-			case st_roundbracket_open:
-				atomseq.clear();
-				atomseq.push_back(epsilon);
-				atomseq.push_back(epsilon);
-				revNFAs.insert(0, atomseq);
-				cur += 2;
-				continue;
+			for (int i = 0; i < 2; ++i)
+			{
+				if (next[i] && !reached[next[i]])
+				{
+					reached[next[i]] = true;
+					pending.push_back(next[i]);
+				}
+			}
 
-			case st_roundbracket_close:
-				revNFAs.insert(0, epsilon);
-				cur += 1;
-				continue;
+			if (state.type == st_character_switch)
+			{
+				for (ui_l32 i = 0; i < state.quantifier.atleast; ++i)
+				{
+					const state_size_type target = this->switch_cases[state.char_num + i].second;
 
-			default:;
+					if (!reached[target])
+					{
+						reached[target] = true;
+						pending.push_back(target);
+					}
+				}
 			}
+		}
+		return false;
+	}
 
-			const state_size_type boundary = find_atom_boundary(NFAs, cur, NFAs.size());
+#endif	//  !defined(SRELLDBG_NO_REQUIREDCHARS)
 
-			if (boundary == 0u || cur == boundary)
-				return false;
+#if !defined(SRELLDBG_NO_STATEHOOK)
 
-			atomseq.clear();
-			atomseq.append(NFAs, cur, boundary - cur);
+	void reorder_piece(state_array &piece) const
+	{
+		simple_array<ui_l32> newpos;
+		ui_l32 offset = 0;
 
-			if (!mend_for_reverse(atomseq))
+		newpos.resize(piece.size() + 1, 0);
+		newpos[piece.size()] = piece.size();
+
+		for (ui_l32 indx = 0; indx < piece.size(); ++indx)
+		{
+			if (newpos[indx] == 0)
 			{
-				return false;
+				newpos[indx] = indx + offset;
+
+				state_type &st = piece[indx];
+
+				if (st.flags & sflags::hooking)
+				{
+					st.flags ^= sflags::hooking;
+					++offset;
+					newpos[indx + st.next1] = indx + offset;
+				}
 			}
+			else
+				--offset;
+		}
 
-			cur = boundary;
-			revNFAs.insert(0, atomseq);
+		state_array newpiece(piece.size());
+
+		for (state_size_type indx = 0; indx < piece.size(); ++indx)
+		{
+			state_type &st = piece[indx];
+
+			if (st.next1 != 0)
+				st.next1 = static_cast<std::ptrdiff_t>(newpos[indx + st.next1]) - newpos[indx];
+
+			if (st.next2 != 0)
+				st.next2 = static_cast<std::ptrdiff_t>(newpos[indx + st.next2]) - newpos[indx];
+
+			newpiece[newpos[indx]] = piece[indx];
 		}
-		revNFAs.swap(NFAs);
-		return true;
+		newpiece.swap(piece);
 	}
 
-	bool mend_for_reverse(state_array &atoms)
+#endif	//  !defined(SRELLDBG_NO_STATEHOOK)
+
+	bool check_if_backref_used(state_size_type pos, const ui_l32 number) const
 	{
-		for (state_size_type pos = 0; pos < atoms.size(); ++pos)
+		for (; pos < this->NFA_states.size(); ++pos)
 		{
-			state_type &s = atoms[pos];
+			const state_type &state = this->NFA_states[pos];
 
-			switch (s.type)
-			{
-			case st_roundbracket_open:
-				if (!check_if_backref_used(pos + 1, s.char_num))
-				{
-					const state_size_type end = skip_bracket(s.char_num, atoms, pos);
+			if (state.type == st_backreference && state.char_num == number)
+				return true;
+		}
+		return false;
+	}
 
-					if (end != 0u)
-					{
-						pos += 2;
-						state_array rev(atoms, pos, end - pos);
+#if !defined(SRELLDBG_NO_BRANCH_OPT) || !defined(SRELLDBG_NO_BRANCH_OPT2)
 
-						if (reverse_atoms(rev) && (end - pos) == rev.size())
-						{
-							if (s.quantifier.is_greedy)
-							{
-								atoms[pos - 2].reset(st_epsilon, epsilon_type::et_mfrfmrcg);
-								atoms[pos - 1].reset(st_epsilon, epsilon_type::et_mfrfmrcg);
-								atoms[end].type = st_epsilon;
-								atoms[end].char_num = epsilon_type::et_mfrfmrcg;
-								atoms[end].next2 = 0;
-							}
-							else
-							{
-								state_type &bro = atoms[pos - 2];
-								state_type &brp = atoms[pos - 1];
-								state_type &brc = atoms[end];
+	state_size_type gather_if_char_or_charclass(range_pairs &charclass, state_size_type pos) const
+	{
+		for (;;)
+		{
+			const state_type &cst = this->NFA_states[pos];
 
-								bro.type = st_repeat_in_push;
-								brp.type = st_repeat_in_pop;
-								brc.type = st_check_0_width_repeat;
+			if (cst.next2 != 0)
+				break;
 
-								bro.char_num = this->number_of_repeats;
-								brp.char_num = this->number_of_repeats;
-								brc.char_num = this->number_of_repeats;
-								++this->number_of_repeats;
-							}
-							atoms.replace(pos, end - pos, rev);
-							pos += rev.size();
-							continue;
-						}
-					}
-				}
-				return false;
+			if (cst.type == st_character)
+			{
+				charclass.set_solerange(range_pair_helper(cst.char_num));
+				return pos;
+			}
+			else if (cst.type == st_character_class)
+			{
+				charclass = this->character_class[cst.char_num];
+				return pos;
+			}
+			else if (cst.type == st_epsilon && cst.char_num != epsilon_type::et_jmpinlp)
+			{
+				pos += cst.next1;
+			}
+			else
+				break;
+		}
+		return 0;
+	}
+#endif	//  !defined(SRELLDBG_NO_BRANCH_OPT) || !defined(SRELLDBG_NO_BRANCH_OPT2)
 
-			case st_epsilon:
-				if (s.char_num == epsilon_type::et_ncgopen)
-				{
-					state_size_type end = skip_group(atoms, pos);
+#if !defined(SRELLDBG_NO_BRANCH_OPT)
+	void branch_optimisation()
+	{
+		range_pairs nextcharclass1;
 
-					if (end != 0u)
-					{
-						++pos;
-						state_array rev(atoms, pos, end - pos);
+		for (state_size_type pos = 1; pos < this->NFA_states.size(); ++pos)
+		{
+			const state_type &state = this->NFA_states[pos];
 
-						if (reverse_atoms(rev) && (end - pos) == rev.size())
-						{
-							atoms.replace(pos, end - pos, rev);
-							pos += rev.size();
-							continue;
-						}
-					}
-					return false;
-				}
-				else if ((s.char_num == epsilon_type::et_ccastrsk || s.char_num == epsilon_type::et_dfastrsk)
-					&& s.next2 != 0 && !s.quantifier.is_greedy)
-				{
-					s.next2 = s.next1;
-					s.next1 = 1;
-					s.quantifier.is_greedy = 1u;
-				}
-				continue;
+			if (state.is_branch())
+			{
+				const state_size_type nextcharpos = gather_if_char_or_charclass(nextcharclass1, pos + state.next1);
 
-			case st_save_and_reset_counter:
-				if (pos + 5 < atoms.size())
+				if (nextcharpos)
 				{
-					state_type &ccstate = atoms[pos + 2];
+					range_pairs nextcharclass2;
+					const bool canbe0length = gather_nextchars(nextcharclass2, pos + state.next2, 0u /* bracket_number */, true);
 
-					if (!ccstate.quantifier.is_greedy)
+					if (!canbe0length && !nextcharclass1.is_overlap(nextcharclass2))
 					{
-//						for (ui_l32 j = 0; j < 5; ++j)
-//							atoms[pos + j].quantifier.is_greedy = true;
+						state_type &branch = this->NFA_states[pos];
+						state_type &next1 = this->NFA_states[nextcharpos];
 
-						ccstate.next2 = ccstate.next1;
-						ccstate.next1 = 1;
-						ccstate.quantifier.is_greedy = 1u;
+						next1.next2 = pos + branch.next2 - nextcharpos;
+						branch.next2 = 0;
+						branch.char_num = epsilon_type::et_bo1fmrbr;
 					}
-					continue;
 				}
-				return false;
-
-			default:;
 			}
 		}
-		return true;
 	}
+#endif	//  !defined(SRELLDBG_NO_BRANCH_OPT)
 
-	state_size_type find_atom_boundary(const state_array &NFAs, state_size_type cur, const state_size_type end) const
+#if !defined(SRELLDBG_NO_BMH)
+	void setup_bmhdata()
 	{
-		const state_size_type begin = cur;
-		state_size_type charatomseq_endpos = cur;
-		const state_type *charatomseq_begin = NULL;
+		simple_array<ui_l32> u32s;
 
-		for (; cur < end; ++cur)
+		for (state_size_type i = 1; i < this->NFA_states.size(); ++i)
 		{
-			const state_type &state = NFAs[cur];
+			const state_type &state = this->NFA_states[i];
 
-			switch (state.type)
+			if (state.type == st_character)
+				u32s.push_backncr(state.char_num);
+			else
 			{
-			case st_character:
-			case st_character_class:
-				if (charatomseq_begin == NULL)
-					charatomseq_begin = &state;
-				else if (!charatomseq_begin->is_same_character_or_charclass(state))
-					return charatomseq_endpos;
-
-				charatomseq_endpos = cur + 1;
-				continue;
+				u32s.clear();
+				break;
+			}
+		}
 
-			case st_epsilon:
-				if (state.next2 == 0)
-				{
-					if (charatomseq_begin)
-						return charatomseq_endpos;
+		if (u32s.size() > 1)
+//		if ((u32s.size() > 1 && !this->is_ricase()) || (u32s.size() > 2 && this->is_ricase()))
+		{
+			if (this->bmdata)
+				this->bmdata->clear();
+			else
+				this->bmdata = new re_bmh<charT, utf_traits>;
 
-					if (state.char_num == epsilon_type::et_jmpinlp)
-						continue;
-					else if (state.char_num == epsilon_type::et_ncgopen)
-					{
-						const state_size_type gend = skip_group(NFAs, cur);
+			this->bmdata->setup(u32s, this->is_ricase());
+			return /* false */;
+		}
 
-						return gend != 0u ? gend + 1 : 0u;
-					}
-					else if (state.char_num != epsilon_type::et_brnchend)
-						return cur + 1;
+		if (this->bmdata)
+			delete this->bmdata;
+		this->bmdata = NULL;
+//		return true;
+	}
+#endif	//  !defined(SRELLDBG_NO_BMH)
 
-					return 0u;
-				}
+#if !defined(SRELLDBG_NO_CCPOS)
+	void set_charclass_posinfo()
+	{
+		this->character_class.finalise();
+		for (state_size_type i = 1; i < this->NFA_states.size(); ++i)
+		{
+			state_type &state = this->NFA_states[i];
 
-				if (state.char_num == epsilon_type::et_ccastrsk)
+			if (state.type == st_character_class || state.type == st_bol || state.type == st_eol || state.type == st_boundary)
+			{
+				const range_pair &posinfo = this->character_class.charclasspos(state.char_num);
+				state.quantifier.set(posinfo.first, posinfo.second);
+			}
+		}
+	}
+#endif	//  !defined(SRELLDBG_NO_CCPOS)
+
+#if !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
+
+	void branch_optimisation2()
+	{
+		bool hooked = false;
+		range_pairs basealt1stch;
+		range_pairs nextalt1stch;
+
+		for (state_size_type pos = 1; pos < this->NFA_states.size(); ++pos)
+		{
+			const state_type &curstate = this->NFA_states[pos];
+
+			if (curstate.type == st_epsilon && curstate.next2 != 0 && curstate.char_num == epsilon_type::et_alt)	//  '|'
+			{
+				const state_size_type next1pos = pos + curstate.next1;
+				state_size_type precharchainpos = pos;
+
+				if (gather_if_char_or_charclass(basealt1stch, next1pos) != 0)
 				{
-					if (cur + 1 < end)
+					state_type &next1ref = this->NFA_states[next1pos];
+					state_size_type next2pos = precharchainpos + curstate.next2;
+					state_size_type postcharchainpos = 0;
+
+					for (;;)
 					{
-						const state_type &repatom = NFAs[cur + 1];
+						state_size_type next2next1pos = next2pos;
+						state_type &nstate2 = this->NFA_states[next2pos];
+						state_size_type next2next2pos = 0;
 
-						if (charatomseq_begin == NULL)
-							charatomseq_begin = &repatom;
-						else if (!charatomseq_begin->is_same_character_or_charclass(repatom))
-							return charatomseq_endpos;
+						if (nstate2.type == st_epsilon)
+						{
+							if (nstate2.next2 != 0)
+							{
+								if (nstate2.char_num == epsilon_type::et_alt)	//  '|'
+									next2next2pos = next2pos + nstate2.next2;
+							}
+							next2next1pos += nstate2.next1;
+						}
 
-						return cur + state.farnext();
-					}
-					return 0u;
-				}
-				else if (state.char_num == epsilon_type::et_alt)	//  '|'
-				{
-					if (charatomseq_begin)
-						return charatomseq_endpos;
+						if (gather_if_char_or_charclass(nextalt1stch, next2next1pos) != 0)
+						{
+							const int relation = basealt1stch.relationship(nextalt1stch);
 
-					state_size_type altend = cur + state.next2 - 1;
+							if (relation == 0)
+							{
+								state_type &prechainalt = this->NFA_states[precharchainpos];
+								state_type &becomes_unused = this->NFA_states[next2next1pos];
+								const state_size_type next1next1pos = next1pos + next1ref.next1;
 
-					for (; this->NFA_states[altend].type == st_epsilon && this->NFA_states[altend].char_num == epsilon_type::et_brnchend; altend += this->NFA_states[altend].next1);
+								becomes_unused.type = st_epsilon;
 
-					return altend;
-				}
+								if (next2next2pos)
+								{
+									becomes_unused.char_num = epsilon_type::et_bo2fmrbr;	//  '2'
 
-				if (state.char_num == epsilon_type::et_dfastrsk)
-					return charatomseq_begin ? charatomseq_endpos : cur + state.farnext();
+									if (postcharchainpos == 0)
+									{
+										nstate2.next1 = next1next1pos - next2pos;
+										nstate2.next2 = next2next1pos - next2pos;
 
-				return 0u;
+										next1ref.next1 = next2pos - next1pos;
+										next1ref.flags |= sflags::hooking;
+										hooked = true;
+									}
+									else
+									{
+										state_type &becomes_alt = this->NFA_states[postcharchainpos];
 
-			case st_save_and_reset_counter:
-				if (charatomseq_begin)
-					return charatomseq_endpos;
+										becomes_alt.char_num = epsilon_type::et_alt;	//  '|' <- '2'
+										becomes_alt.next2 = next2next1pos - postcharchainpos;
 
-				cur += 2;
-				return cur + NFAs[cur].farnext();
+										nstate2.next2 = 0;
+										nstate2.char_num = epsilon_type::et_bo2skpd;	//  '!'
+									}
+									postcharchainpos = next2next1pos;
+									prechainalt.next2 = next2next2pos - precharchainpos;
+								}
+								else
+								{
+									if (postcharchainpos == 0)
+									{
+										becomes_unused.char_num = epsilon_type::et_alt;	//  '|'
+										becomes_unused.next2 = becomes_unused.next1;
+										becomes_unused.next1 = next1next1pos - next2next1pos;
 
-			case st_bol:
-			case st_eol:
-			case st_boundary:
-			case st_backreference:
-				if (charatomseq_begin)
-					return charatomseq_endpos;
-				return cur + 1;
+										next1ref.next1 = next2next1pos - next1pos;
+										next1ref.flags |= sflags::hooking;
+										hooked = true;
+									}
+									else
+									{
+										state_type &becomes_alt = this->NFA_states[postcharchainpos];
 
-			case st_roundbracket_open:
-				if (charatomseq_begin)
-					return charatomseq_endpos;
-				else
-				{
-					const state_size_type rbend = skip_bracket(state.char_num, NFAs, cur);
+										becomes_alt.char_num = epsilon_type::et_alt;	//  '|' <- '2'
+										becomes_alt.next2 = next2next1pos + becomes_unused.next1 - postcharchainpos;
 
-					if (rbend != 0u)
-						return rbend + 1;
-				}
-				return 0u;
+										becomes_unused.char_num = epsilon_type::et_bo2skpd;	//  '!'
+									}
+									prechainalt.next2 = 0;
+									prechainalt.char_num = epsilon_type::et_bo2fmrbr;	//  '2'
+								}
+							}
+							else if (relation == 1)
+							{
+								break;
+							}
+							else
+								precharchainpos = next2pos;
+						}
+						else
+						{
+							//  Fix for bug210428.
+							//  Original: /mm2|m|mm/
+							//  1st step: /m(?:m2||m)/ <- No more optimisation can be performed. Must quit.
+							//  2nd step: /mm(?:2||)/ <- BUG.
+							break;
+						}
 
-			case st_repeat_in_push:
-				if (charatomseq_begin)
-					return charatomseq_endpos;
-				else
-				{
-					const state_size_type rpend = skip_0width_checker(state.char_num, NFAs, cur);
+						if (next2next2pos == 0)
+							break;
 
-					if (rpend != 0u)
-						return rpend + 1;
+						next2pos = next2next2pos;
+					}
 				}
-				return 0u;
+			}
+		}
 
-			case st_lookaround_open:
-				if (charatomseq_begin)
-					return charatomseq_endpos;
-				return cur + state.next1;
+		if (hooked)
+			reorder_piece(this->NFA_states);
+	}
+#endif	//   !defined(SRELLDBG_NO_BRANCH_OPT2) && !defined(SRELLDBG_NO_STATEHOOK)
 
-			case st_roundbracket_close:
-			case st_check_0_width_repeat:
-			case st_lookaround_close:
-				return charatomseq_endpos;
+#if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
 
-			case st_roundbracket_pop:
-			case st_check_counter:
-			case st_decrement_counter:
-			case st_restore_counter:
-			case st_repeat_in_pop:
-			case st_lookaround_pop:
-				return 0u;
+	void find_entrypoint()
+	{
+		if (find_singlechar_ep(1u))
+			return;
 
-			default:
-				return 0u;
-			}
-		}
-		return begin != charatomseq_endpos ? charatomseq_endpos : 0u;
+		find_better_ep(1u);
 	}
 
-	bool find_better_ep(state_size_type cur)
+	bool find_singlechar_ep(state_size_type cur)
 	{
-		state_size_type betterpos = 0u;
-		ui_l32 bp_cpnum = 0u;
-		ui_l32 charcount = 0u;
-		range_pairs nextcc;
+		state_size_type curatompos = 0;
+		state_size_type singlecharpos = 0;
+		state_size_type seqpos = 0;
+		ui_l32 prevchar = constants::invalid_u32value;
+		ui_l32 charcount = 0;
+		bool needs_rerun = false;
+#if !defined(SRELLDBG_NO_RAREUNIT)
+		unsigned int singlecharrank = 0;
+		unsigned int seqrank = 0;
+		bool singlecharrerun = false;
+		bool seqrerun = false;
+#endif
 
 		for (; cur < this->NFA_states.size();)
 		{
 			const state_type &state = this->NFA_states[cur];
 
-			if (state.type == st_epsilon)
+			if (state.is_character_or_class() && state.next2 != 0)
+				break;	//  Gives up at a possessive one, e.g. a*+.
+
+			switch (state.type)
 			{
-				if (state.char_num == epsilon_type::et_ncgopen || (state.next2 == 0 && state.char_num != epsilon_type::et_jmpinlp))
+			case st_character:
+				curatompos = cur;
+				ST_CHARACTER:
+#if !defined(SRELLDBG_NO_RAREUNIT)
 				{
-					++cur;
-					continue;
-				}
-			}
-			else if (state.type == st_roundbracket_open)
-			{
-				cur += state.next1;
-				continue;
-			}
-			else if (state.type == st_bol || state.type == st_eol || state.type == st_boundary)
-			{
-				cur += state.next1;
-				continue;
-			}
-			else if (state.type == st_roundbracket_close)
-			{
-				cur += state.next2;
-				continue;
-			}
-			else if (state.type == st_backreference || state.type == st_lookaround_open)
-				break;
-
-			const state_size_type boundary = find_atom_boundary(this->NFA_states, cur, this->NFA_states.size());
+					//  Prefers the rarest character as the entry point, as
+					//  the single character finder scans for it. The later
+					//  one is taken between equally rare ones.
+					const unsigned int rank = unit_frequency::rank(utf_traits::firstcodeunit(this->NFA_states[cur].char_num) & utf_traits::bitsetmask);
 
-			if (boundary == 0u || cur == boundary)
-				break;
+					if (prevchar != constants::invalid_u32value && (seqpos == 0 || rank <= seqrank))
+					{
+						seqpos = curatompos;
+						seqrank = rank;
+						seqrerun = needs_rerun;
+					}
 
-			nextcc.clear();
-			const bool canbe0length = gather_nextchars(nextcc, cur, 0u, false);
+					if (singlecharpos == 0 || rank <= singlecharrank)
+					{
+						singlecharpos = curatompos;
+						singlecharrank = rank;
+						singlecharrerun = needs_rerun;
+					}
+				}
+#else
+				if (prevchar != constants::invalid_u32value)
+					seqpos = curatompos;
 
-			if (canbe0length)
-				break;
+				singlecharpos = curatompos;
+#endif
+				++charcount;
+				prevchar = this->NFA_states[cur].char_num;
+				++cur;
+				continue;
 
-			const ui_l32 cpnum = nextcc.total_codepoints();
-			const bool has_obstacle = has_obstacle_to_reverse(cur, boundary, true);
+			case st_character_class:
+				prevchar = constants::invalid_u32value;
+				++cur;
+				continue;
 
-			if (betterpos != 0u)
-			{
-				if (bp_cpnum > cpnum || (bp_cpnum == cpnum && charcount == 1u))
+			case st_epsilon:
+				if (state.next2 == 0)
 				{
-					betterpos = cur;
-					bp_cpnum = cpnum;
-					++charcount;
+					if (state.char_num == epsilon_type::et_jmpinlp)
+					{
+						const state_size_type rapos = cur + state.next1;
+						const state_type &repatom = this->NFA_states[rapos];
+
+						if (repatom.type == st_character)
+						{
+							curatompos = cur;
+							cur = rapos;
+							needs_rerun = true;
+							goto ST_CHARACTER;
+						}
+						prevchar = constants::invalid_u32value;
+						cur = rapos;
+					}
+					else
+						++cur;
+					continue;
 				}
-			}
-			else
-			{
-				betterpos = cur;
-				bp_cpnum = cpnum;
-				++charcount;
-			}
 
-			if (has_obstacle)
+				if ((state.char_num == epsilon_type::et_ccastrsk)
+					|| ((state.char_num == epsilon_type::et_dfastrsk)
+						&& (is_reversible_atom(cur + state.nearnext(), true))))
+				{
+					cur += state.farnext();
+					needs_rerun = true;
+					prevchar = constants::invalid_u32value;
+					continue;
+				}
 				break;
 
-			cur = boundary;
-		}
-
-		return (charcount > 1u) ? (create_rewinder(betterpos, true), true) : false;
-	}
+			case st_check_counter:
+				{
+					const state_size_type rapos = cur + 3;
+					const state_type &repatom = this->NFA_states[rapos];
 
-#endif	//  !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
+					if (repatom.type == st_character)
+					{
+						curatompos = cur;
+						cur = rapos;
+						needs_rerun = state.quantifier.is_same();
+						goto ST_CHARACTER;
+					}
 
-public:	//  For debug.
+					if (is_reversible_atom(rapos, state.quantifier.atleast == 0))
+					{
+						cur += state.farnext();
+						needs_rerun = true;
+						prevchar = constants::invalid_u32value;
+						continue;
+					}
+				}
+				break;
 
-	void print_NFA_states(const int) const;
-};
-//  re_compiler
+			case st_roundbracket_open:
+				if (check_if_backref_used(cur + 1, state.char_num))
+					break;
 
-	}	//  namespace re_detail
+				needs_rerun = true;
+				//@fallthrough@
 
-//  ... "rei_compiler.hpp"]
-//  ["regex_sub_match.hpp" ...
+			case st_save_and_reset_counter:
+			case st_repeat_in_push:
+				cur += state.next1;
+				continue;
 
-//  28.9, class template sub_match:
-template <class BidirectionalIterator>
-class sub_match : public std::pair<BidirectionalIterator, BidirectionalIterator>
-{
-public:
+			case st_check_0_width_repeat:
+				cur += state.next2;
+				continue;
 
-	typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
-	typedef typename std::iterator_traits<BidirectionalIterator>::difference_type difference_type;
-	typedef BidirectionalIterator iterator;
-	typedef std::basic_string<value_type> string_type;
+			case st_backreference:
+			case st_lookaround_open:
+				break;	//  Gives up.
 
-	bool matched;
+			case st_restore_counter:
+			case st_decrement_counter:
+			case st_roundbracket_pop:
+			case st_repeat_in_pop:
+			case st_lookaround_pop:
+				break;	//  NFA_states broken.
 
-//	constexpr sub_match();	//  C++11.
+			default:
+				++cur;
+				continue;
+			}
+			break;
+		}
 
-	sub_match() : matched(false)
-	{
+#if !defined(SRELLDBG_NO_RAREUNIT)
+		return seqpos != 0
+			? (create_rewinder(seqpos, seqrerun || needs_rerun), true)
+			: (charcount > 1 ? (create_rewinder(singlecharpos, singlecharrerun || needs_rerun), true) : false);
+#else
+		return seqpos != 0
+			? (create_rewinder(seqpos, needs_rerun), true)
+			: (charcount > 1 ? (create_rewinder(singlecharpos, needs_rerun), true) : false);
+#endif
 	}
 
-	difference_type length() const
+	bool is_reversible_atom(const state_size_type pos, const bool check_optseq) const
 	{
-		return matched ? std::distance(this->first, this->second) : 0;
-	}
+		const state_type &s = this->NFA_states[pos];
+		state_size_type end = 0u;
 
-	operator string_type() const
-	{
-		return matched ? string_type(this->first, this->second) : string_type();
-	}
+		if (s.type == st_character || s.type == st_character_class)
+			return s.next2 == 0;	//  Not possessive.
 
-	string_type str() const
-	{
-		return matched ? string_type(this->first, this->second) : string_type();
-	}
+		if (check_optseq)
+			return false;	//  Optional sequence (?, *, {0,m}) found.
+			//  Not only at the beginning but also at any position does
+			//  an optional sequence need measures to be taken:
+			//  "2000-1-1" =~ /\d(\d+-)?\d{1,2}-\d{1,2}/
 
-	int compare(const sub_match &s) const
-	{
-		return str().compare(s.str());
-	}
+		switch (s.type)
+		{
+		case st_epsilon:
+			if (s.next2 == 0 && s.char_num == epsilon_type::et_ncgopen)
+				end = skip_group(this->NFA_states, pos);
+			break;
 
-	int compare(const string_type &s) const
-	{
-		return str().compare(s);
-	}
+		case st_roundbracket_open:
+			if (check_if_backref_used(pos + 1, s.char_num))
+				return false;
 
-	int compare(const value_type *const s) const
-	{
-		return str().compare(s);
-	}
+			end = skip_bracket(s.char_num, this->NFA_states, pos);
+			break;
 
-	void swap(sub_match &s)
-	{
-		if (this != &s)
-		{
-			this->std::pair<BidirectionalIterator, BidirectionalIterator>::swap(s);
-			std::swap(matched, s.matched);
-		}
-	}
+		case st_repeat_in_push:
+			end = skip_0width_checker(s.char_num, this->NFA_states, pos);
+			//@fallthrough@
 
-#if !defined(SRELL_NO_APIEXT)
+		default:;
+		}
 
-	template <typename ST, typename SA>
-	operator std::basic_string<value_type, ST, SA>() const
-	{
-		typedef std::basic_string<value_type, ST, SA> string_type2;
-		return matched ? string_type2(this->first, this->second) : string_type2();
+		return end != 0u && !has_obstacle_to_reverse(pos, end, false);
 	}
 
-	template <typename ST, typename SA>
-	std::basic_string<value_type, ST, SA> str() const
+	bool has_obstacle_to_reverse(state_size_type pos, const state_size_type end, const bool check_optseq) const
 	{
-		typedef std::basic_string<value_type, ST, SA> string_type2;
-		return matched ? string_type2(this->first, this->second) : string_type2();
-	}
+		for (; pos < end;)
+		{
+			const state_type &s = this->NFA_states[pos];
 
-#endif	//  !defined(SRELL_NO_APIEXT)
+			if (s.type == st_epsilon)
+			{
+				if (s.char_num == epsilon_type::et_alt)
+					return true;
+					//  The rewinder cannot support Disjunction because forward matching
+					//  and backward matching can go through different routes:
+					//  * In a forward search /(?:.|ab)c/ against "abc" matches "abc",
+					//    while in a backward search from 'c' it matches "bc".
 
-	void set_(const typename re_detail::re_submatch_type<BidirectionalIterator> &br)
+				//  Because of the same reason, the rewinder cannot support an optional
+				//  group either. Semantically, /(\d+-)?\d{1,2}-\d{1,2}/ is equivalent to
+				//  /(\d+-|)\d{1,2}-\d{1,2}/.
+				if (check_optseq)
+				{
+					if (s.char_num == epsilon_type::et_jmpinlp)
+					{
+						pos += s.next1;
+						continue;
+					}
+
+					if (s.char_num == epsilon_type::et_dfastrsk && s.next2 != 0 && !this->NFA_states[pos + s.nearnext()].is_character_or_class())
+						return true;
+				}
+
+			}
+			else if (s.type == st_backreference)
+				return true;
+			else if (s.type == st_lookaround_open)
+				return true;
+			else if (s.is_character_or_class() && s.next2 != 0)
+				return true;	//  Possessive ones never give back, whichever way matched.
+			else if (check_optseq && s.type == st_check_counter)
+			{
+				if (s.quantifier.atleast == 0 && !this->NFA_states[pos + 3].is_character_or_class())
+					return true;
+				pos += 3;
+				continue;
+			}
+			++pos;
+		}
+		return false;
+	}
+
+	state_size_type skip_bracket(const ui_l32 no, const state_array &NFAs, state_size_type pos) const
 	{
-		this->first = br.core.open_at;
-		this->second = br.core.close_at;
-		this->matched = br.counter != 0;
+		return find_pair(st_roundbracket_close, NFAs, no, pos);
 	}
-};
 
-//  28.9.2, sub_match non-member operators:
-//  [7.9.2] sub_match non-member operators
+	state_size_type skip_0width_checker(const ui_l32 no, const state_array &NFAs, state_size_type pos) const
+	{
+		return find_pair(st_check_0_width_repeat, NFAs, no, pos);
+	}
 
-//  Compares sub_match & with sub_match &.
-template <class BiIter>
-bool operator==(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) == 0;	//  1
-}
+	state_size_type find_pair(const re_state_type type, const state_array &NFAs, const ui_l32 no, state_size_type pos) const
+	{
+		for (++pos; pos < NFAs.size(); ++pos)
+		{
+			const state_type &s = NFAs[pos];
 
-template <class BiIter>
-bool operator!=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) != 0;	//  2
-}
+			if (s.type == type && s.char_num == no)
+				return pos;
+		}
+		return 0u;
+	}
 
-template <class BiIter>
-bool operator<(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) < 0;	//  3
-}
+	state_size_type skip_group(const state_array &NFAs, state_size_type pos) const
+	{
+		ui_l32 depth = 1u;
 
-template <class BiIter>
-bool operator<=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) <= 0;	//  4
-}
+		for (++pos; pos < NFAs.size(); ++pos)
+		{
+			const state_type &s = NFAs[pos];
 
-template <class BiIter>
-bool operator>=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) >= 0;	//  5
-}
+			if (s.type == st_epsilon)
+			{
+				if (s.char_num == epsilon_type::et_ncgopen)
+					++depth;
+				else if (s.char_num == epsilon_type::et_ncgclose)
+				{
+					if (--depth == 0u)
+						return pos;
+				}
+			}
+		}
+		return 0u;
+	}
 
-template <class BiIter>
-bool operator>(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
-{
-	return lhs.compare(rhs) > 0;	//  6
-}
+	void create_rewinder(const state_size_type end, const bool needs_rerun)
+	{
+		state_array newNFAs;
+		state_type rwstate;
 
-//  Compares basic_string & with sub_match &.
-template <class BiIter, class ST, class SA>
-bool operator==(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(lhs.c_str()) == 0;	//  7
-}
+		newNFAs.append(this->NFA_states, 1u, end - 1u);
+		if (!reverse_atoms(newNFAs) || newNFAs.size() == 0u)
+			return;
 
-template <class BiIter, class ST, class SA>
-bool operator!=(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs == rhs);	//  8
-}
+		rwstate.reset(st_lookaround_pop, meta_char::mc_eq);
+		rwstate.quantifier.atmost = 0;
+		newNFAs.insert(0, rwstate);
 
-template <class BiIter, class ST, class SA>
-bool operator<(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(lhs.c_str()) > 0;	//  9
-}
+		rwstate.type = st_lookaround_open;
+		rwstate.next1 = static_cast<std::ptrdiff_t>(end + newNFAs.size() + 2) - 1;
+		rwstate.next2 = 1;
+		rwstate.quantifier.is_greedy = needs_rerun ? 3 : 2; //  Match point rewinder.
+			//  "singing" problem: /\w+ing/ against "singing" matches the
+			//  entire "singing". However, if modified like /(?<=\K\w+)ing/
+			//  it matches "sing" only, which is not correct (but correct if
+			//  /\w+?ing/). To avoid this problem, after rewinding is
+			//  finished rerunning the automaton forwards from the found
+			//  point is needed if the reversed states contain a variable
+			//  length (non fixed length) atom.
+			//  TODO: This rerunning can be avoided if the reversed atoms
+			//  are an exclusive sequence, like /\d+[:,]+\d+abcd/.
+		newNFAs.insert(0, rwstate);
 
-template <class BiIter, class ST, class SA>
-bool operator>(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs < lhs;	//  10
-}
+		rwstate.type = st_lookaround_close;
+		rwstate.next1 = 0;
+		rwstate.next2 = 0;
+		newNFAs.append(1, rwstate);
 
-template <class BiIter, class ST, class SA>
-bool operator>=(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs < rhs);	//  11
-}
+		this->NFA_states.insert(1, newNFAs);
+		this->NFA_states[0].next2 = static_cast<std::ptrdiff_t>(newNFAs.size()) + 1;
+	}
 
-template <class BiIter, class ST, class SA>
-bool operator<=(
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(rhs < lhs);	//  12
-}
+	bool reverse_atoms(state_array &NFAs)
+	{
+		state_array revNFAs;
+		state_array atomseq;
+		state_type epsilon;
 
-//  Compares sub_match & with basic_string &.
-template <class BiIter, class ST, class SA>
-bool operator==(
-	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
-)
-{
-	return lhs.compare(rhs.c_str()) == 0;	//  13
-}
+		epsilon.reset(st_epsilon, epsilon_type::et_rvfmrcg);
 
-template <class BiIter, class ST, class SA>
-bool operator!=(
-	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
-)
-{
-	return !(lhs == rhs);	//  14
-}
+		for (state_size_type cur = 0u; cur < NFAs.size();)
+		{
+			const state_type &state = NFAs[cur];
 
-template <class BiIter, class ST, class SA>
-bool operator<(
-	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
-)
-{
-	return lhs.compare(rhs.c_str()) < 0;	//  15
-}
+			switch (state.type)
+			{
+			case st_epsilon:
+				if (state.is_noncapturinggroup_begin_or_end())
+				{
+					revNFAs.insert(0, epsilon);
+					++cur;
+					continue;
+				}
+				break;
 
-template <class BiIter, class ST, class SA>
-bool operator>(
-	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
-)
-{
-	return rhs < lhs;	//  16
-}
+			case st_roundbracket_open:
+				atomseq.clear();
+				atomseq.push_back(epsilon);
+				atomseq.push_back(epsilon);
+				revNFAs.insert(0, atomseq);
+				cur += 2;
+				continue;
 
-template <class BiIter, class ST, class SA>
-bool operator>=(
-	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
-)
-{
-	return !(lhs < rhs);	//  17
-}
+			case st_roundbracket_close:
+				revNFAs.insert(0, epsilon);
+				cur += 1;
+				continue;
+
+			default:;
+			}
+
+			const state_size_type boundary = find_atom_boundary(NFAs, cur, NFAs.size());
+
+			if (boundary == 0u || cur == boundary)
+				return false;
+
+			atomseq.clear();
+			atomseq.append(NFAs, cur, boundary - cur);
+
+			if (!mend_for_reverse(atomseq))
+			{
+				return false;
+			}
+
+			cur = boundary;
+			revNFAs.insert(0, atomseq);
+		}
+		revNFAs.swap(NFAs);
+		return true;
+	}
+
+	bool mend_for_reverse(state_array &atoms)
+	{
+		for (state_size_type pos = 0; pos < atoms.size(); ++pos)
+		{
+			state_type &s = atoms[pos];
+
+			switch (s.type)
+			{
+			case st_roundbracket_open:
+				if (!check_if_backref_used(pos + 1, s.char_num))
+				{
+					const state_size_type end = skip_bracket(s.char_num, atoms, pos);
+
+					if (end != 0u)
+					{
+						pos += 2;
+						state_array rev(atoms, pos, end - pos);
+
+						if (reverse_atoms(rev) && (end - pos) == rev.size())
+						{
+							if (s.quantifier.is_greedy)
+							{
+								atoms[pos - 2].reset(st_epsilon, epsilon_type::et_mfrfmrcg);
+								atoms[pos - 1].reset(st_epsilon, epsilon_type::et_mfrfmrcg);
+								atoms[end].type = st_epsilon;
+								atoms[end].char_num = epsilon_type::et_mfrfmrcg;
+								atoms[end].next2 = 0;
+							}
+							else
+							{
+								state_type &bro = atoms[pos - 2];
+								state_type &brp = atoms[pos - 1];
+								state_type &brc = atoms[end];
+
+								bro.type = st_repeat_in_push;
+								brp.type = st_repeat_in_pop;
+								brc.type = st_check_0_width_repeat;
+
+								bro.char_num = this->number_of_repeats;
+								brp.char_num = this->number_of_repeats;
+								brc.char_num = this->number_of_repeats;
+								++this->number_of_repeats;
+							}
+							atoms.replace(pos, end - pos, rev);
+							pos += rev.size();
+							continue;
+						}
+					}
+				}
+				return false;
+
+			case st_epsilon:
+				if (s.char_num == epsilon_type::et_ncgopen)
+				{
+					state_size_type end = skip_group(atoms, pos);
+
+					if (end != 0u)
+					{
+						++pos;
+						state_array rev(atoms, pos, end - pos);
+
+						if (reverse_atoms(rev) && (end - pos) == rev.size())
+						{
+							atoms.replace(pos, end - pos, rev);
+							pos += rev.size();
+							continue;
+						}
+					}
+					return false;
+				}
+				else if ((s.char_num == epsilon_type::et_ccastrsk || s.char_num == epsilon_type::et_dfastrsk)
+					&& s.next2 != 0 && !s.quantifier.is_greedy)
+				{
+					s.next2 = s.next1;
+					s.next1 = 1;
+					s.quantifier.is_greedy = 1u;
+				}
+				continue;
+
+			case st_save_and_reset_counter:
+				if (pos + 5 < atoms.size())
+				{
+					state_type &ccstate = atoms[pos + 2];
+
+					if (!ccstate.quantifier.is_greedy)
+					{
+//						for (ui_l32 j = 0; j < 5; ++j)
+//							atoms[pos + j].quantifier.is_greedy = true;
+
+						ccstate.next2 = ccstate.next1;
+						ccstate.next1 = 1;
+						ccstate.quantifier.is_greedy = 1u;
+					}
+					continue;
+				}
+				return false;
+
+			default:;
+			}
+		}
+		return true;
+	}
+
+	state_size_type find_atom_boundary(const state_array &NFAs, state_size_type cur, const state_size_type end) const
+	{
+		const state_size_type begin = cur;
+		state_size_type charatomseq_endpos = cur;
+		const state_type *charatomseq_begin = NULL;
+
+		for (; cur < end; ++cur)
+		{
+			const state_type &state = NFAs[cur];
+
+			switch (state.type)
+			{
+			case st_character:
+			case st_character_class:
+				if (charatomseq_begin == NULL)
+					charatomseq_begin = &state;
+				else if (!charatomseq_begin->is_same_character_or_charclass(state))
+					return charatomseq_endpos;
+
+				charatomseq_endpos = cur + 1;
+				continue;
+
+			case st_epsilon:
+				if (state.next2 == 0)
+				{
+					if (charatomseq_begin)
+						return charatomseq_endpos;
+
+					if (state.char_num == epsilon_type::et_jmpinlp)
+						continue;
+					else if (state.char_num == epsilon_type::et_ncgopen)
+					{
+						const state_size_type gend = skip_group(NFAs, cur);
+
+						return gend != 0u ? gend + 1 : 0u;
+					}
+					else if (state.char_num != epsilon_type::et_brnchend)
+						return cur + 1;
+
+					return 0u;
+				}
+
+				if (state.char_num == epsilon_type::et_ccastrsk)
+				{
+					if (cur + 1 < end)
+					{
+						const state_type &repatom = NFAs[cur + 1];
+
+						if (charatomseq_begin == NULL)
+							charatomseq_begin = &repatom;
+						else if (!charatomseq_begin->is_same_character_or_charclass(repatom))
+							return charatomseq_endpos;
+
+						return cur + state.farnext();
+					}
+					return 0u;
+				}
+				else if (state.char_num == epsilon_type::et_alt)	//  '|'
+				{
+					if (charatomseq_begin)
+						return charatomseq_endpos;
+
+					state_size_type altend = cur + state.next2 - 1;
+
+					for (; this->NFA_states[altend].type == st_epsilon && this->NFA_states[altend].char_num == epsilon_type::et_brnchend; altend += this->NFA_states[altend].next1);
+
+					return altend;
+				}
+
+				if (state.char_num == epsilon_type::et_dfastrsk)
+					return charatomseq_begin ? charatomseq_endpos : cur + state.farnext();
+
+				return 0u;
+
+			case st_save_and_reset_counter:
+				if (charatomseq_begin)
+					return charatomseq_endpos;
+
+				cur += 2;
+				return cur + NFAs[cur].farnext();
+
+			case st_bol:
+			case st_eol:
+			case st_boundary:
+			case st_backreference:
+				if (charatomseq_begin)
+					return charatomseq_endpos;
+				return cur + 1;
+
+			case st_roundbracket_open:
+				if (charatomseq_begin)
+					return charatomseq_endpos;
+				else
+				{
+					const state_size_type rbend = skip_bracket(state.char_num, NFAs, cur);
+
+					if (rbend != 0u)
+						return rbend + 1;
+				}
+				return 0u;
+
+			case st_repeat_in_push:
+				if (charatomseq_begin)
+					return charatomseq_endpos;
+				else
+				{
+					const state_size_type rpend = skip_0width_checker(state.char_num, NFAs, cur);
+
+					if (rpend != 0u)
+						return rpend + 1;
+				}
+				return 0u;
+
+			case st_lookaround_open:
+				if (charatomseq_begin)
+					return charatomseq_endpos;
+				return cur + state.next1;
+
+			case st_roundbracket_close:
+			case st_check_0_width_repeat:
+			case st_lookaround_close:
+				return charatomseq_endpos;
+
+			case st_roundbracket_pop:
+			case st_check_counter:
+			case st_decrement_counter:
+			case st_restore_counter:
+			case st_repeat_in_pop:
+			case st_lookaround_pop:
+				return 0u;
+
+			default:
+				return 0u;
+			}
+		}
+		return begin != charatomseq_endpos ? charatomseq_endpos : 0u;
+	}
+
+	bool find_better_ep(state_size_type cur)
+	{
+		state_size_type betterpos = 0u;
+		ui_l32 bp_cpnum = 0u;
+		ui_l32 charcount = 0u;
+		range_pairs nextcc;
+
+		for (; cur < this->NFA_states.size();)
+		{
+			const state_type &state = this->NFA_states[cur];
+
+			if (state.type == st_epsilon)
+			{
+				if (state.char_num == epsilon_type::et_ncgopen || (state.next2 == 0 && state.char_num != epsilon_type::et_jmpinlp))
+				{
+					++cur;
+					continue;
+				}
+			}
+			else if (state.type == st_roundbracket_open)
+			{
+				if (check_if_backref_used(cur + 1, state.char_num))
+					break;
+
+				cur += state.next1;
+				continue;
+			}
+			else if (state.type == st_bol || state.type == st_eol || state.type == st_boundary)
+			{
+				cur += state.next1;
+				continue;
+			}
+			else if (state.type == st_roundbracket_close)
+			{
+				cur += state.next2;
+				continue;
+			}
+			else if (state.type == st_backreference || state.type == st_lookaround_open)
+				break;
+
+			const state_size_type boundary = find_atom_boundary(this->NFA_states, cur, this->NFA_states.size());
+
+			if (boundary == 0u || cur == boundary)
+				break;
+
+			nextcc.clear();
+			const bool canbe0length = gather_nextchars(nextcc, cur, 0u, false);
+
+			if (canbe0length)
+				break;
+
+			const ui_l32 cpnum = nextcc.total_codepoints();
+			const bool has_obstacle = has_obstacle_to_reverse(cur, boundary, true);
+
+			if (betterpos != 0u)
+			{
+				if (bp_cpnum > cpnum || (bp_cpnum == cpnum && charcount == 1u))
+				{
+					betterpos = cur;
+					bp_cpnum = cpnum;
+					++charcount;
+				}
+			}
+			else
+			{
+				betterpos = cur;
+				bp_cpnum = cpnum;
+				++charcount;
+			}
+
+			if (has_obstacle)
+				break;
+
+			cur = boundary;
+		}
+
+		return (charcount > 1u) ? (create_rewinder(betterpos, true), true) : false;
+	}
+
+#endif	//  !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
+
+public:	//  For debug.
+
+	void print_NFA_states(const int) const;
+};
+//  re_compiler
+
+	}	//  namespace re_detail
+
+//  ... "rei_compiler.hpp"]
+//  ["regex_sub_match.hpp" ...
+
+//  28.9, class template sub_match:
+template <class BidirectionalIterator>
+class sub_match : public std::pair<BidirectionalIterator, BidirectionalIterator>
+{
+public:
+
+	typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
+	typedef typename std::iterator_traits<BidirectionalIterator>::difference_type difference_type;
+	typedef BidirectionalIterator iterator;
+	typedef std::basic_string<value_type> string_type;
+
+	bool matched;
+
+//	constexpr sub_match();	//  C++11.
+
+	sub_match() : matched(false)
+	{
+	}
+
+	difference_type length() const
+	{
+		return matched ? std::distance(this->first, this->second) : 0;
+	}
+
+	operator string_type() const
+	{
+		return matched ? string_type(this->first, this->second) : string_type();
+	}
+
+	string_type str() const
+	{
+		return matched ? string_type(this->first, this->second) : string_type();
+	}
+
+	int compare(const sub_match &s) const
+	{
+		return str().compare(s.str());
+	}
+
+	int compare(const string_type &s) const
+	{
+		return str().compare(s);
+	}
+
+	int compare(const value_type *const s) const
+	{
+		return str().compare(s);
+	}
+
+	void swap(sub_match &s)
+	{
+		if (this != &s)
+		{
+			this->std::pair<BidirectionalIterator, BidirectionalIterator>::swap(s);
+			std::swap(matched, s.matched);
+		}
+	}
+
+#if !defined(SRELL_NO_APIEXT)
+
+	template <typename ST, typename SA>
+	operator std::basic_string<value_type, ST, SA>() const
+	{
+		typedef std::basic_string<value_type, ST, SA> string_type2;
+		return matched ? string_type2(this->first, this->second) : string_type2();
+	}
+
+	template <typename ST, typename SA>
+	std::basic_string<value_type, ST, SA> str() const
+	{
+		typedef std::basic_string<value_type, ST, SA> string_type2;
+		return matched ? string_type2(this->first, this->second) : string_type2();
+	}
+
+#endif	//  !defined(SRELL_NO_APIEXT)
+
+	void set_(const typename re_detail::re_submatch_type<BidirectionalIterator> &br)
+	{
+		this->first = br.core.open_at;
+		this->second = br.core.close_at;
+		this->matched = br.counter != 0;
+	}
+};
+
+//  28.9.2, sub_match non-member operators:
+//  [7.9.2] sub_match non-member operators
+
+//  Compares sub_match & with sub_match &.
+template <class BiIter>
+bool operator==(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) == 0;	//  1
+}
+
+template <class BiIter>
+bool operator!=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) != 0;	//  2
+}
+
+template <class BiIter>
+bool operator<(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) < 0;	//  3
+}
+
+template <class BiIter>
+bool operator<=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) <= 0;	//  4
+}
+
+template <class BiIter>
+bool operator>=(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) >= 0;	//  5
+}
+
+template <class BiIter>
+bool operator>(const sub_match<BiIter> &lhs, const sub_match<BiIter> &rhs)
+{
+	return lhs.compare(rhs) > 0;	//  6
+}
+
+//  Compares basic_string & with sub_match &.
+template <class BiIter, class ST, class SA>
+bool operator==(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(lhs.c_str()) == 0;	//  7
+}
+
+template <class BiIter, class ST, class SA>
+bool operator!=(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs == rhs);	//  8
+}
+
+template <class BiIter, class ST, class SA>
+bool operator<(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(lhs.c_str()) > 0;	//  9
+}
+
+template <class BiIter, class ST, class SA>
+bool operator>(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs < lhs;	//  10
+}
+
+template <class BiIter, class ST, class SA>
+bool operator>=(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs < rhs);	//  11
+}
+
+template <class BiIter, class ST, class SA>
+bool operator<=(
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(rhs < lhs);	//  12
+}
+
+//  Compares sub_match & with basic_string &.
+template <class BiIter, class ST, class SA>
+bool operator==(
+	const sub_match<BiIter> &lhs,
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return lhs.compare(rhs.c_str()) == 0;	//  13
+}
+
+template <class BiIter, class ST, class SA>
+bool operator!=(
+	const sub_match<BiIter> &lhs,
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return !(lhs == rhs);	//  14
+}
+
+template <class BiIter, class ST, class SA>
+bool operator<(
+	const sub_match<BiIter> &lhs,
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return lhs.compare(rhs.c_str()) < 0;	//  15
+}
+
+template <class BiIter, class ST, class SA>
+bool operator>(
+	const sub_match<BiIter> &lhs,
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return rhs < lhs;	//  16
+}
+
+template <class BiIter, class ST, class SA>
+bool operator>=(
+	const sub_match<BiIter> &lhs,
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return !(lhs < rhs);	//  17
+}
 
 template <class BiIter, class ST, class SA>
 bool operator<=(
 	const sub_match<BiIter> &lhs,
-	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+	const std::basic_string<typename std::iterator_traits<BiIter>::value_type, ST, SA> &rhs
+)
+{
+	return !(rhs < lhs);	//  18
+}
+
+//  Compares iterator_traits::value_type * with sub_match &.
+template <class BiIter>
+bool operator==(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(lhs) == 0;	//  19
+}
+
+template <class BiIter>
+bool operator!=(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs == rhs);	//  20
+}
+
+template <class BiIter>
+bool operator<(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(lhs) > 0;	//  21
+}
+
+template <class BiIter>
+bool operator>(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs < lhs;	//  22
+}
+
+template <class BiIter>
+bool operator>=(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs < rhs);	//  23
+}
+
+template <class BiIter>
+bool operator<=(
+	typename std::iterator_traits<BiIter>::value_type const *lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(rhs < lhs);	//  24
+}
+
+//  Compares sub_match & with iterator_traits::value_type *.
+template <class BiIter>
+bool operator==(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return lhs.compare(rhs) == 0;	//  25
+}
+
+template <class BiIter>
+bool operator!=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return !(lhs == rhs);	//  26
+}
+
+template <class BiIter>
+bool operator<(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return lhs.compare(rhs) < 0;	//  27
+}
+
+template <class BiIter>
+bool operator>(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return rhs < lhs;	//  28
+}
+
+template <class BiIter>
+bool operator>=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return !(lhs < rhs);	//  29
+}
+
+template <class BiIter>
+bool operator<=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const *rhs
+)
+{
+	return !(rhs < lhs);	//  30
+}
+
+//  Compares iterator_traits::value_type & with sub_match &.
+template <class BiIter>
+bool operator==(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(typename sub_match<BiIter>::string_type(1, lhs)) == 0;	//  31
+}
+
+template <class BiIter>
+bool operator!=(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs == rhs);	//  32
+}
+
+template <class BiIter>
+bool operator<(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs.compare(typename sub_match<BiIter>::string_type(1, lhs)) > 0;	//  33
+}
+
+template <class BiIter>
+bool operator>(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return rhs < lhs;	//  34
+}
+
+template <class BiIter>
+bool operator>=(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(lhs < rhs);	//  35
+}
+
+template <class BiIter>
+bool operator<=(
+	typename std::iterator_traits<BiIter>::value_type const &lhs,
+	const sub_match<BiIter> &rhs
+)
+{
+	return !(rhs < lhs);	//  36
+}
+
+//  Compares sub_match & with iterator_traits::value_type &.
+template <class BiIter>
+bool operator==(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
 )
 {
-	return !(rhs < lhs);	//  18
+	return lhs.compare(typename sub_match<BiIter>::string_type(1, rhs)) == 0;	//  37
+}
+
+template <class BiIter>
+bool operator!=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
+)
+{
+	return !(lhs == rhs);	//  38
+}
+
+template <class BiIter>
+bool operator<(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
+)
+{
+	return lhs.compare(typename sub_match<BiIter>::string_type(1, rhs)) < 0;	//  39
+}
+
+template <class BiIter>
+bool operator>(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
+)
+{
+	return rhs < lhs;	//  40
+}
+
+template <class BiIter>
+bool operator>=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
+)
+{
+	return !(lhs < rhs);	//  41
+}
+
+template <class BiIter>
+bool operator<=(
+	const sub_match<BiIter> &lhs,
+	typename std::iterator_traits<BiIter>::value_type const &rhs
+)
+{
+	return !(rhs < lhs);	//  42
+}
+
+template <class charT, class ST, class BiIter>
+std::basic_ostream<charT, ST> &operator<<(std::basic_ostream<charT, ST> &os, const sub_match<BiIter> &m)
+{
+	return (os << m.str());
 }
 
-//  Compares iterator_traits::value_type * with sub_match &.
-template <class BiIter>
-bool operator==(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(lhs) == 0;	//  19
-}
+typedef sub_match<const char *> csub_match;
+typedef sub_match<const wchar_t *> wcsub_match;
+typedef sub_match<std::string::const_iterator> ssub_match;
+typedef sub_match<std::wstring::const_iterator> wssub_match;
+
+typedef csub_match u8ccsub_match;
+typedef ssub_match u8cssub_match;
+
+#if defined(WCHAR_MAX)
+	#if WCHAR_MAX >= 0x10ffff
+		typedef wcsub_match u32wcsub_match;
+		typedef wssub_match u32wssub_match;
+		typedef u32wcsub_match u1632wcsub_match;
+		typedef u32wssub_match u1632wssub_match;
+	#elif WCHAR_MAX >= 0xffff
+		typedef wcsub_match u16wcsub_match;
+		typedef wssub_match u16wssub_match;
+		typedef u16wcsub_match u1632wcsub_match;
+		typedef u16wssub_match u1632wssub_match;
+	#endif
+#endif
+
+#if defined(SRELL_CPP11_CHAR1632_ENABLED)
+	typedef sub_match<const char16_t *> u16csub_match;
+	typedef sub_match<const char32_t *> u32csub_match;
+	typedef sub_match<std::u16string::const_iterator> u16ssub_match;
+	typedef sub_match<std::u32string::const_iterator> u32ssub_match;
+#endif
+
+#if defined(SRELL_CPP20_CHAR8_ENABLED)
+	typedef sub_match<const char8_t *> u8csub_match;
+#else
+	typedef u8ccsub_match u8csub_match;
+#endif
+#if defined(SRELL_CPP20_CHAR8_ENABLED) && SRELL_CPP20_CHAR8_ENABLED >= 2
+	typedef sub_match<std::u8string::const_iterator> u8ssub_match;
+#else	//  !defined(SRELL_CPP20_CHAR8_ENABLED) || SRELL_CPP20_CHAR8_ENABLED < 2
+	typedef u8cssub_match u8ssub_match;
+#endif
+
+//  ... "regex_sub_match.hpp"]
+//  ["regex_match_results.hpp" ...
+
+//  28.10, class template match_results:
+template <class BidirectionalIterator, class Allocator = std::allocator<sub_match<BidirectionalIterator> > >
+class match_results
+{
+public:
+
+	typedef sub_match<BidirectionalIterator> value_type;
+	typedef const value_type & const_reference;
+	typedef const_reference reference;
+//	typedef implementation defined const_iterator;
+	typedef typename std::vector<value_type, Allocator>::const_iterator const_iterator;
+	typedef const_iterator iterator;
+	typedef typename std::iterator_traits<BidirectionalIterator>::difference_type difference_type;
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+	typedef typename std::allocator_traits<Allocator>::size_type size_type;
+#else
+	typedef typename Allocator::size_type size_type;	//  TR1.
+#endif
+
+	typedef Allocator allocator_type;
+	typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
+	typedef std::basic_string<char_type> string_type;
+
+public:
+
+	//  28.10.1, construct/copy/destroy:
+	//  [7.10.1] construct/copy/destroy
+	explicit match_results(const Allocator &a = Allocator()) : ready_(0u), sub_matches_(a)
+	{
+	}
+
+	match_results(const match_results &m)
+	{
+		operator=(m);
+	}
+
+#if defined(SRELL_CPP11_MOVE_ENABLED)
+	match_results(match_results &&m) SRELL_NOEXCEPT
+	{
+		operator=(std::move(m));
+	}
+#endif
+
+	match_results &operator=(const match_results &m)
+	{
+		if (this != &m)
+		{
+//			this->sstate_ = m.sstate_;
+			this->ready_ = m.ready_;
+			this->sub_matches_ = m.sub_matches_;
+			this->prefix_ = m.prefix_;
+			this->suffix_ = m.suffix_;
+			this->base_ = m.base_;
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+			this->gnames_ = m.gnames_;
+#endif
+		}
+		return *this;
+	}
+
+#if defined(SRELL_CPP11_MOVE_ENABLED)
+	match_results &operator=(match_results &&m) SRELL_NOEXCEPT
+	{
+		if (this != &m)
+		{
+//			this->sstate_ = std::move(m.sstate_);
+			this->ready_ = m.ready_;
+			this->sub_matches_ = std::move(m.sub_matches_);
+			this->prefix_ = std::move(m.prefix_);
+			this->suffix_ = std::move(m.suffix_);
+			this->base_ = m.base_;
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+			this->gnames_ = std::move(m.gnames_);
+#endif
+		}
+		return *this;
+	}
+#endif
+
+//	~match_results();
+
+	//  28.10.2, state:
+	bool ready() const
+	{
+		return (ready_ & 1u) ? true : false;
+	}
+
+	//  28.10.3, size:
+	//  [7.10.2] size
+	size_type size() const
+	{
+		return sub_matches_.size();
+	}
+
+	size_type max_size() const
+	{
+		return sub_matches_.max_size();
+//		return static_cast<size_type>(~0) / sizeof (value_type);
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	//  28.10.4, element access:
+	//  [7.10.3] element access
+	difference_type length(const size_type sub = 0) const
+	{
+		return (*this)[sub].length();
+	}
 
-template <class BiIter>
-bool operator!=(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs == rhs);	//  20
-}
+	difference_type position(const size_type sub = 0) const
+	{
+		const_reference ref = (*this)[sub];
 
-template <class BiIter>
-bool operator<(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(lhs) > 0;	//  21
-}
+		return std::distance(base_, ref.first);
+	}
 
-template <class BiIter>
-bool operator>(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs < lhs;	//  22
-}
+	string_type str(const size_type sub = 0) const
+	{
+		return string_type((*this)[sub]);
+	}
 
-template <class BiIter>
-bool operator>=(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs < rhs);	//  23
-}
+	const_reference operator[](const size_type n) const
+	{
+		return n < sub_matches_.size() ? sub_matches_[n] : unmatched_;
+	}
 
-template <class BiIter>
-bool operator<=(
-	typename std::iterator_traits<BiIter>::value_type const *lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(rhs < lhs);	//  24
-}
+#if !defined(SRELL_NO_NAMEDCAPTURE)
 
-//  Compares sub_match & with iterator_traits::value_type *.
-template <class BiIter>
-bool operator==(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return lhs.compare(rhs) == 0;	//  25
-}
+	//  Helpers for overload resolution of the integer literal 0 of signed types.
+	template <typename IntegerType>
+	difference_type length(const IntegerType zero) const
+	{
+		return length(static_cast<size_type>(zero));
+	}
+	template <typename IntegerType>
+	difference_type position(const IntegerType zero) const
+	{
+		return position(static_cast<size_type>(zero));
+	}
+	template <typename IntegerType>
+	string_type str(const IntegerType zero) const
+	{
+		return str(static_cast<size_type>(zero));
+	}
+	template <typename IntegerType>
+	const_reference operator[](const IntegerType zero) const
+	{
+		return operator[](static_cast<size_type>(zero));
+	}
 
-template <class BiIter>
-bool operator!=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return !(lhs == rhs);	//  26
-}
+	difference_type length(const string_type &sub) const
+	{
+		return (*this)[sub].length();
+	}
+
+	difference_type position(const string_type &sub) const
+	{
+		const_reference ref = (*this)[sub];
+
+		return std::distance(base_, ref.first);
+	}
+
+	string_type str(const string_type &sub) const
+	{
+		return string_type((*this)[sub]);
+	}
+
+	const_reference operator[](const string_type &sub) const
+	{
+		const re_detail::ui_l32 backrefno = lookup_backref_number(sub.data(), sub.data() + sub.size());
+
+		return backrefno != re_detail::groupname_mapper<char_type>::notfound ? sub_matches_[backrefno] : unmatched_;
+	}
+
+	difference_type length(const char_type *sub) const
+	{
+		return (*this)[sub].length();
+	}
+
+	difference_type position(const char_type *sub) const
+	{
+		const_reference ref = (*this)[sub];
+
+		return std::distance(base_, ref.first);
+	}
+
+	string_type str(const char_type *sub) const
+	{
+		return string_type((*this)[sub]);
+	}
+
+	const_reference operator[](const char_type *sub) const
+	{
+		const re_detail::ui_l32 backrefno = lookup_backref_number(sub, sub + std::char_traits<char_type>::length(sub));
+
+		return backrefno != re_detail::groupname_mapper<char_type>::notfound ? sub_matches_[backrefno] : unmatched_;
+	}
+
+#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
+
+	const_reference prefix() const
+	{
+		return prefix_;
+	}
+
+	const_reference suffix() const
+	{
+		return suffix_;
+	}
+
+	const_iterator begin() const
+	{
+		return sub_matches_.begin();
+	}
+
+	const_iterator end() const
+	{
+		return sub_matches_.end();
+	}
+
+	const_iterator cbegin() const
+	{
+		return sub_matches_.begin();
+	}
+
+	const_iterator cend() const
+	{
+		return sub_matches_.end();
+	}
+
+	//  28.10.5, format:
+	//  [7.10.4] format
+	template <class OutputIter>
+	OutputIter format(
+		OutputIter out,
+		const char_type *fmt_first,
+		const char_type *const fmt_last,
+		regex_constants::match_flag_type /* flags */ = regex_constants::format_default
+	) const
+	{
+		if (this->ready() && !this->empty())
+		{
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+			const bool no_groupnames = gnames_.size() == 0;
+#endif
+			const value_type &m0 = (*this)[0];
+
+			while (fmt_first != fmt_last)
+			{
+				if (*fmt_first != static_cast<char_type>(re_detail::meta_char::mc_dollar))	//  '$'
+				{
+					*out++ = *fmt_first++;
+				}
+				else
+				{
+					++fmt_first;
+					if (fmt_first == fmt_last)
+					{
+						*out++ = re_detail::meta_char::mc_dollar;	//  '$';
+					}
+					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_amp))	//  '&', $&
+					{
+						out = std::copy(m0.first, m0.second, out);
+						++fmt_first;
+					}
+					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_grav))	//  '`', $`, prefix.
+					{
+						out = std::copy(this->prefix().first, this->prefix().second, out);
+						++fmt_first;
+					}
+					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_apos))	//  '\'', $', suffix.
+					{
+						out = std::copy(this->suffix().first, this->suffix().second, out);
+						++fmt_first;
+					}
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+					else if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_lt) && !no_groupnames)	//  '<', $<
+					{
+						const char_type *const current_backup = fmt_first;
+						bool replaced = false;
+
+						if (++fmt_first == fmt_last)
+							;	//  Do nothing.
+						else
+						{
+							const char_type *const name_begin = fmt_first;
+
+							for (;; ++fmt_first)
+							{
+								if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_gt))
+								{
+									const re_detail::ui_l32 backref_number = lookup_backref_number(name_begin, fmt_first);
+
+									if (backref_number != re_detail::groupname_mapper<char_type>::notfound)
+									{
+										const value_type &mn = (*this)[backref_number];
+
+										if (mn.matched)
+											out = std::copy(mn.first, mn.second, out);
+//										replaced = true;
+									}
+									replaced = true;
+									++fmt_first;
+									break;
+								}
+								if (fmt_first == fmt_last)
+									break;
+							}
+						}
+						if (!replaced)
+						{
+							fmt_first = current_backup;
+							*out++ = re_detail::meta_char::mc_dollar;	//  '$';
+						}
+					}
+#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
+					else
+					{
+						const char_type *const backup_pos = fmt_first;
+						size_type backref_number = 0;
 
-template <class BiIter>
-bool operator<(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return lhs.compare(rhs) < 0;	//  27
-}
+						if (fmt_first != fmt_last && *fmt_first >= static_cast<char_type>(re_detail::char_alnum::ch_0) && *fmt_first <= static_cast<char_type>(re_detail::char_alnum::ch_9))	//  '0'-'9'
+						{
+							backref_number += *fmt_first - re_detail::char_alnum::ch_0;	//  '0';
 
-template <class BiIter>
-bool operator>(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return rhs < lhs;	//  28
-}
+							if (++fmt_first != fmt_last && *fmt_first >= static_cast<char_type>(re_detail::char_alnum::ch_0) && *fmt_first <= static_cast<char_type>(re_detail::char_alnum::ch_9))	//  '0'-'9'
+							{
+								backref_number *= 10;
+								backref_number += *fmt_first - re_detail::char_alnum::ch_0;	//  '0';
+								++fmt_first;
+							}
+						}
 
-template <class BiIter>
-bool operator>=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return !(lhs < rhs);	//  29
-}
+						if (backref_number && backref_number < this->size())
+						{
+							const value_type &mn = (*this)[backref_number];
 
-template <class BiIter>
-bool operator<=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const *rhs
-)
-{
-	return !(rhs < lhs);	//  30
-}
+							if (mn.matched)
+								out = std::copy(mn.first, mn.second, out);
+						}
+						else
+						{
+							*out++ = re_detail::meta_char::mc_dollar;	//  '$';
 
-//  Compares iterator_traits::value_type & with sub_match &.
-template <class BiIter>
-bool operator==(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(typename sub_match<BiIter>::string_type(1, lhs)) == 0;	//  31
-}
+							fmt_first = backup_pos;
+							if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_dollar))
+								++fmt_first;
+						}
+					}
+				}
+			}
+		}
+		return out;
+	}
 
-template <class BiIter>
-bool operator!=(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs == rhs);	//  32
-}
+	template <class OutputIter, class ST, class SA>
+	OutputIter format(
+		OutputIter out,
+		const std::basic_string<char_type, ST, SA> &fmt,
+		regex_constants::match_flag_type flags = regex_constants::format_default
+	) const
+	{
+		return format(out, fmt.data(), fmt.data() + fmt.size(), flags);
+	}
 
-template <class BiIter>
-bool operator<(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs.compare(typename sub_match<BiIter>::string_type(1, lhs)) > 0;	//  33
-}
+	template <class ST, class SA>
+	std::basic_string<char_type, ST, SA> format(
+		const string_type &fmt,
+		regex_constants::match_flag_type flags = regex_constants::format_default
+	) const
+	{
+		std::basic_string<char_type, ST, SA> result;
 
-template <class BiIter>
-bool operator>(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return rhs < lhs;	//  34
-}
+//		format(std::back_insert_iterator<string_type>(result), fmt, flags);
+		format(std::back_inserter(result), fmt, flags);
+		return result;
+	}
 
-template <class BiIter>
-bool operator>=(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(lhs < rhs);	//  35
-}
+	string_type format(const char_type *fmt, regex_constants::match_flag_type flags = regex_constants::format_default) const
+	{
+		string_type result;
 
-template <class BiIter>
-bool operator<=(
-	typename std::iterator_traits<BiIter>::value_type const &lhs,
-	const sub_match<BiIter> &rhs
-)
-{
-	return !(rhs < lhs);	//  36
-}
+		format(std::back_inserter(result), fmt, fmt + std::char_traits<char_type>::length(fmt), flags);
+		return result;
+	}
 
-//  Compares sub_match & with iterator_traits::value_type &.
-template <class BiIter>
-bool operator==(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return lhs.compare(typename sub_match<BiIter>::string_type(1, rhs)) == 0;	//  37
-}
+	//  28.10.6, allocator:
+	//  [7.10.5] allocator
+	allocator_type get_allocator() const
+	{
+		return allocator_type();
+	}
 
-template <class BiIter>
-bool operator!=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return !(lhs == rhs);	//  38
-}
+	//  28.10.7, swap:
+	//  [7.10.6] swap
+	void swap(match_results &that)
+	{
+		const match_results tmp(that);
+		that = *this;
+		*this = tmp;
+	}
 
-template <class BiIter>
-bool operator<(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return lhs.compare(typename sub_match<BiIter>::string_type(1, rhs)) < 0;	//  39
-}
+	regex_constants::error_type ecode() const
+	{
+		return static_cast<regex_constants::error_type>(ready_ >> 1);
+	}
 
-template <class BiIter>
-bool operator>(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return rhs < lhs;	//  40
-}
+	//  Sets an interrupt_checker that the searches using this object consult
+	//  at intervals. Passing NULL removes it.
+	void set_interrupt_checker(interrupt_checker *const ic)
+	{
+		sstate_.set_interrupter(ic);
+	}
 
-template <class BiIter>
-bool operator>=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return !(lhs < rhs);	//  41
-}
+#if !defined(SRELL_NO_LIMIT_COUNTER)
 
-template <class BiIter>
-bool operator<=(
-	const sub_match<BiIter> &lhs,
-	typename std::iterator_traits<BiIter>::value_type const &rhs
-)
-{
-	return !(rhs < lhs);	//  42
-}
+	//  Overrides basic_regex::limit_counter for the searches using this
+	//  object, so that one regex object can be shared by searches with
+	//  different limits. Passing 0 restores the regex's own limit.
+	void set_limit_counter(const std::size_t limit)
+	{
+		sstate_.limit_counter = limit;
+	}
 
-template <class charT, class ST, class BiIter>
-std::basic_ostream<charT, ST> &operator<<(std::basic_ostream<charT, ST> &os, const sub_match<BiIter> &m)
-{
-	return (os << m.str());
-}
+	//  Returns how many of the limit counted above were consumed by the
+	//  previous search, summed over all the positions tried.
+	std::size_t steps_consumed() const
+	{
+		return sstate_.steps_consumed();
+	}
 
-typedef sub_match<const char *> csub_match;
-typedef sub_match<const wchar_t *> wcsub_match;
-typedef sub_match<std::string::const_iterator> ssub_match;
-typedef sub_match<std::wstring::const_iterator> wssub_match;
+#endif	//  !defined(SRELL_NO_LIMIT_COUNTER)
 
-typedef csub_match u8ccsub_match;
-typedef ssub_match u8cssub_match;
+#if defined(SRELL_ENABLE_STATS)
+
+	//  Counters collected during the previous search.
+	const search_statistics &stats() const
+	{
+		return sstate_.stats;
+	}
 
-#if defined(WCHAR_MAX)
-	#if WCHAR_MAX >= 0x10ffff
-		typedef wcsub_match u32wcsub_match;
-		typedef wssub_match u32wssub_match;
-		typedef u32wcsub_match u1632wcsub_match;
-		typedef u32wssub_match u1632wssub_match;
-	#elif WCHAR_MAX >= 0xffff
-		typedef wcsub_match u16wcsub_match;
-		typedef wssub_match u16wssub_match;
-		typedef u16wcsub_match u1632wcsub_match;
-		typedef u16wssub_match u1632wssub_match;
-	#endif
 #endif
 
-#if defined(SRELL_CPP11_CHAR1632_ENABLED)
-	typedef sub_match<const char16_t *> u16csub_match;
-	typedef sub_match<const char32_t *> u32csub_match;
-	typedef sub_match<std::u16string::const_iterator> u16ssub_match;
-	typedef sub_match<std::u32string::const_iterator> u32ssub_match;
+#if defined(SRELL_ENABLE_PROFILER)
+
+	//  Counts per state, accumulated over the searches done with this object.
+	const search_profile &profile() const
+	{
+		return sstate_.profile;
+	}
+
+	void clear_profile()
+	{
+		sstate_.profile.clear();
+	}
+
 #endif
 
-#if defined(SRELL_CPP20_CHAR8_ENABLED)
-	typedef sub_match<const char8_t *> u8csub_match;
-#else
-	typedef u8ccsub_match u8csub_match;
+public:	//  For internal.
+
+	typedef match_results<BidirectionalIterator> match_results_type;
+	typedef typename match_results_type::size_type match_results_size_type;
+	typedef typename re_detail::re_search_state</*charT, */BidirectionalIterator> search_state_type;
+
+	search_state_type sstate_;
+
+	void clear_()
+	{
+		ready_ = 0u;
+		sub_matches_.clear();
+//		prefix_.matched = false;
+//		suffix_.matched = false;
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+		gnames_.clear();
 #endif
-#if defined(SRELL_CPP20_CHAR8_ENABLED) && SRELL_CPP20_CHAR8_ENABLED >= 2
-	typedef sub_match<std::u8string::const_iterator> u8ssub_match;
-#else	//  !defined(SRELL_CPP20_CHAR8_ENABLED) || SRELL_CPP20_CHAR8_ENABLED < 2
-	typedef u8cssub_match u8ssub_match;
+	}
+
+//	template <typename charT>
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+	bool set_match_results_(const re_detail::groupname_mapper<char_type> &gnames)
+#else
+	bool set_match_results_()
 #endif
+	{
+		sub_matches_.resize(sstate_.bracket.size());
+//		value_type &m0 = sub_matches_[0];
 
-//  ... "regex_sub_match.hpp"]
-//  ["regex_match_results.hpp" ...
+		sub_matches_[0].matched = true;
 
-//  28.10, class template match_results:
-template <class BidirectionalIterator, class Allocator = std::allocator<sub_match<BidirectionalIterator> > >
-class match_results
-{
-public:
+		for (re_detail::ui_l32 i = 1; i < static_cast<re_detail::ui_l32>(sstate_.bracket.size()); ++i)
+			sub_matches_[i].set_(sstate_.bracket[i]);
 
-	typedef sub_match<BidirectionalIterator> value_type;
-	typedef const value_type & const_reference;
-	typedef const_reference reference;
-//	typedef implementation defined const_iterator;
-	typedef typename std::vector<value_type, Allocator>::const_iterator const_iterator;
-	typedef const_iterator iterator;
-	typedef typename std::iterator_traits<BidirectionalIterator>::difference_type difference_type;
+		base_ = sstate_.lblim;
+		prefix_.first = sstate_.srchbegin;
+		prefix_.second = sub_matches_[0].first = sstate_.bracket[0].core.open_at;
+		suffix_.first = sub_matches_[0].second = sstate_.ssc.iter;
+		suffix_.second = sstate_.srchend;
 
-#if defined(__cplusplus) && __cplusplus >= 201103L
-	typedef typename std::allocator_traits<Allocator>::size_type size_type;
-#else
-	typedef typename Allocator::size_type size_type;	//  TR1.
+		prefix_.matched = prefix_.first != prefix_.second;
+		suffix_.matched = suffix_.first != suffix_.second;
+
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+		gnames_ = gnames;
 #endif
+		ready_ = 1u;
+		return true;
+	}
 
-	typedef Allocator allocator_type;
-	typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
-	typedef std::basic_string<char_type> string_type;
+	bool set_match_results_bmh_()
+	{
+		sub_matches_.resize(1);
+//		value_type &m0 = sub_matches_[0];
 
-public:
+		sub_matches_[0].matched = true;
 
-	//  28.10.1, construct/copy/destroy:
-	//  [7.10.1] construct/copy/destroy
-	explicit match_results(const Allocator &a = Allocator()) : ready_(0u), sub_matches_(a)
+		base_ = sstate_.lblim;
+		prefix_.first = sstate_.srchbegin;
+		prefix_.second = sub_matches_[0].first = sstate_.ssc.iter;
+		suffix_.first = sub_matches_[0].second = sstate_.nextpos;
+		suffix_.second = sstate_.srchend;
+
+		prefix_.matched = prefix_.first != prefix_.second;
+		suffix_.matched = suffix_.first != suffix_.second;
+
+		ready_ = 1u;
+		return true;
+	}
+
+	void set_prefix1_(const BidirectionalIterator pf)
 	{
+		prefix_.first = pf;
 	}
 
-	match_results(const match_results &m)
+	void update_prefix1_(const BidirectionalIterator pf)
 	{
-		operator=(m);
+		prefix_.first = pf;
+		prefix_.matched = prefix_.first != prefix_.second;
 	}
 
-#if defined(SRELL_CPP11_MOVE_ENABLED)
-	match_results(match_results &&m) SRELL_NOEXCEPT
+	void update_prefix2_(const BidirectionalIterator ps)
 	{
-		operator=(std::move(m));
+		prefix_.second = ps;
+		prefix_.matched = prefix_.first != prefix_.second;
 	}
-#endif
 
-	match_results &operator=(const match_results &m)
+	void update_m0_(const BidirectionalIterator mf, const BidirectionalIterator ms)
 	{
-		if (this != &m)
-		{
-//			this->sstate_ = m.sstate_;
-			this->ready_ = m.ready_;
-			this->sub_matches_ = m.sub_matches_;
-			this->prefix_ = m.prefix_;
-			this->suffix_ = m.suffix_;
-			this->base_ = m.base_;
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-			this->gnames_ = m.gnames_;
-#endif
-		}
-		return *this;
+		sub_matches_.resize(1);
+
+		sub_matches_[0].first = mf;
+		sub_matches_[0].second = ms;
+		sub_matches_[0].matched = true;
+
+		prefix_.first = prefix_.second = mf;
 	}
 
-#if defined(SRELL_CPP11_MOVE_ENABLED)
-	match_results &operator=(match_results &&m) SRELL_NOEXCEPT
+	bool mark_as_failed_(const int reason)
 	{
-		if (this != &m)
-		{
-//			this->sstate_ = std::move(m.sstate_);
-			this->ready_ = m.ready_;
-			this->sub_matches_ = std::move(m.sub_matches_);
-			this->prefix_ = std::move(m.prefix_);
-			this->suffix_ = std::move(m.suffix_);
-			this->base_ = m.base_;
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-			this->gnames_ = std::move(m.gnames_);
-#endif
-		}
-		return *this;
+		ready_ = reason ? (reason << 1) : 1u;
+		return false;
 	}
-#endif
 
-//	~match_results();
+private:
 
-	//  28.10.2, state:
-	bool ready() const
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+
+	re_detail::ui_l32 lookup_backref_number(const char_type *begin, const char_type *const end) const
 	{
-		return (ready_ & 1u) ? true : false;
+		typename re_detail::groupname_mapper<char_type>::gname_string key(end - begin);
+
+		for (std::size_t i = 0; begin != end; ++begin, ++i)
+			key[i] = *begin;
+
+		return gnames_[key];
 	}
 
-	//  28.10.3, size:
-	//  [7.10.2] size
-	size_type size() const
+#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
+
+public:	//  For debug.
+
+	template <typename BasicRegexT>
+	void print_sub_matches(const BasicRegexT &, const int) const;
+	void print_addresses(const value_type &, const char *const) const;
+
+private:
+
+	typedef std::vector<value_type, Allocator> sub_match_array;
+
+	unsigned int ready_;
+	sub_match_array sub_matches_;
+	value_type prefix_;
+	value_type suffix_;
+	value_type unmatched_;
+	BidirectionalIterator base_;
+
+#if !defined(SRELL_NO_NAMEDCAPTURE)
+	re_detail::groupname_mapper<char_type> gnames_;
+#endif
+};
+
+//  28.10.7, match_results swap:
+//  [7.10.6] match_results swap
+template <class BidirectionalIterator, class Allocator>
+void swap(
+	match_results<BidirectionalIterator, Allocator> &m1,
+	match_results<BidirectionalIterator, Allocator> &m2
+)
+{
+	m1.swap(m2);
+}
+
+//  28.10.8, match_results comparisons
+template <class BidirectionalIterator, class Allocator>
+bool operator==(
+	const match_results<BidirectionalIterator, Allocator> &m1,
+	const match_results<BidirectionalIterator, Allocator> &m2
+)
+{
+	if (!m1.ready() && !m2.ready())
+		return true;
+
+	if (m1.ready() && m2.ready())
 	{
-		return sub_matches_.size();
+		if (m1.empty() && m2.empty())
+			return true;
+
+		if (!m1.empty() && !m2.empty())
+		{
+			return m1.prefix() == m2.prefix() && m1.size() == m2.size() && std::equal(m1.begin(), m1.end(), m2.begin()) && m1.suffix() == m2.suffix();
+		}
 	}
+	return false;
+}
 
-	size_type max_size() const
+template <class BidirectionalIterator, class Allocator>
+bool operator!=(
+	const match_results<BidirectionalIterator, Allocator> &m1,
+	const match_results<BidirectionalIterator, Allocator> &m2
+)
+{
+	return !(m1 == m2);
+}
+
+#if !defined(SRELL_NO_APIEXT)
+
+//  View of the sub-matches of the current match, passed to the callback of
+//  basic_regex::for_each_match(). It refers to the internal search state
+//  directly instead of copying the sub-matches, so it is valid only until
+//  the callback returns.
+template <class BidirectionalIterator>
+class match_view
+{
+public:
+
+	typedef sub_match<BidirectionalIterator> value_type;
+	typedef std::size_t size_type;
+	typedef typename std::iterator_traits<BidirectionalIterator>::difference_type difference_type;
+	typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
+	typedef std::basic_string<char_type> string_type;
+
+	size_type size() const
 	{
-		return sub_matches_.max_size();
-//		return static_cast<size_type>(~0) / sizeof (value_type);
+		return size_;
 	}
 
 	bool empty() const
 	{
-		return size() == 0;
+		return size_ == 0;
 	}
 
-	//  28.10.4, element access:
-	//  [7.10.3] element access
 	difference_type length(const size_type sub = 0) const
 	{
 		return (*this)[sub].length();
@@ -21152,826 +23567,1345 @@ public:
 
 	difference_type position(const size_type sub = 0) const
 	{
-		const_reference ref = (*this)[sub];
-
-		return std::distance(base_, ref.first);
+		return std::distance(sstate_->lblim, (*this)[sub].first);
 	}
 
 	string_type str(const size_type sub = 0) const
 	{
-		return string_type((*this)[sub]);
+		return (*this)[sub].str();
 	}
 
-	const_reference operator[](const size_type n) const
+	value_type operator[](const size_type n) const
 	{
-		return n < sub_matches_.size() ? sub_matches_[n] : unmatched_;
-	}
+		value_type sm;
 
-#if !defined(SRELL_NO_NAMEDCAPTURE)
+		if (n == 0)
+		{
+			sm.first = first0_;
+			sm.second = second0_;
+			sm.matched = true;
+		}
+		else if (n < size_)
+			sm.set_(sstate_->bracket[n]);
 
-	//  Helpers for overload resolution of the integer literal 0 of signed types.
-	template <typename IntegerType>
-	difference_type length(const IntegerType zero) const
-	{
-		return length(static_cast<size_type>(zero));
+		return sm;
 	}
-	template <typename IntegerType>
-	difference_type position(const IntegerType zero) const
+
+	value_type prefix() const
 	{
-		return position(static_cast<size_type>(zero));
+		value_type sm;
+
+		sm.first = prefix1_;
+		sm.second = first0_;
+		sm.matched = sm.first != sm.second;
+		return sm;
 	}
-	template <typename IntegerType>
-	string_type str(const IntegerType zero) const
+
+	value_type suffix() const
 	{
-		return str(static_cast<size_type>(zero));
+		value_type sm;
+
+		sm.first = second0_;
+		sm.second = sstate_->srchend;
+		sm.matched = sm.first != sm.second;
+		return sm;
 	}
-	template <typename IntegerType>
-	const_reference operator[](const IntegerType zero) const
+
+public:	//  For internal.
+
+	typedef typename re_detail::re_search_state</*charT, */BidirectionalIterator> search_state_type;
+
+	explicit match_view(const search_state_type &ss) : sstate_(&ss), size_(0)
 	{
-		return operator[](static_cast<size_type>(zero));
 	}
 
-	difference_type length(const string_type &sub) const
+	void set_(const size_type size, const BidirectionalIterator mf, const BidirectionalIterator ms, const BidirectionalIterator pf)
 	{
-		return (*this)[sub].length();
+		size_ = size;
+		first0_ = mf;
+		second0_ = ms;
+		prefix1_ = pf;
 	}
 
-	difference_type position(const string_type &sub) const
-	{
-		const_reference ref = (*this)[sub];
+private:
 
-		return std::distance(base_, ref.first);
+	const search_state_type *sstate_;
+	size_type size_;
+	BidirectionalIterator first0_;
+	BidirectionalIterator second0_;
+	BidirectionalIterator prefix1_;
+};
+
+//  Passed to the callback of basic_regex::search_lines(). line() is a line
+//  in which the expression has matched, without its terminating '\n', and
+//  match() is the first match in it, whose position() is counted from the
+//  beginning of the line. Valid only until the callback returns.
+template <class BidirectionalIterator>
+class matched_line
+{
+public:
+
+	typedef sub_match<BidirectionalIterator> value_type;
+	typedef std::size_t size_type;
+
+	//  1-based.
+	size_type lineno() const
+	{
+		return lineno_;
 	}
 
-	string_type str(const string_type &sub) const
+	//  The offset of line().first from the beginning of the subject, in
+	//  code units.
+	size_type position() const
 	{
-		return string_type((*this)[sub]);
+		return position_;
 	}
 
-	const_reference operator[](const string_type &sub) const
+	value_type line() const
 	{
-		const re_detail::ui_l32 backrefno = lookup_backref_number(sub.data(), sub.data() + sub.size());
+		value_type sm;
 
-		return backrefno != re_detail::groupname_mapper<char_type>::notfound ? sub_matches_[backrefno] : unmatched_;
+		sm.first = first_;
+		sm.second = second_;
+		sm.matched = true;
+		return sm;
 	}
 
-	difference_type length(const char_type *sub) const
+	const match_view<BidirectionalIterator> &match() const
 	{
-		return (*this)[sub].length();
+		return view_;
 	}
 
-	difference_type position(const char_type *sub) const
-	{
-		const_reference ref = (*this)[sub];
+public:	//  For internal.
 
-		return std::distance(base_, ref.first);
-	}
+	typedef typename re_detail::re_search_state<BidirectionalIterator> search_state_type;
 
-	string_type str(const char_type *sub) const
+	explicit matched_line(const search_state_type &ss) : view_(ss), lineno_(1), position_(0)
 	{
-		return string_type((*this)[sub]);
 	}
 
-	const_reference operator[](const char_type *sub) const
-	{
-		const re_detail::ui_l32 backrefno = lookup_backref_number(sub, sub + std::char_traits<char_type>::length(sub));
+	match_view<BidirectionalIterator> view_;
+	size_type lineno_;
+	size_type position_;
+	BidirectionalIterator first_;
+	BidirectionalIterator second_;
+};
 
-		return backrefno != re_detail::groupname_mapper<char_type>::notfound ? sub_matches_[backrefno] : unmatched_;
-	}
+#endif	//  !defined(SRELL_NO_APIEXT)
 
-#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
+typedef match_results<const char *> cmatch;
+typedef match_results<const wchar_t *> wcmatch;
+typedef match_results<std::string::const_iterator> smatch;
+typedef match_results<std::wstring::const_iterator> wsmatch;
 
-	const_reference prefix() const
-	{
-		return prefix_;
-	}
+typedef cmatch u8ccmatch;
+typedef smatch u8csmatch;
 
-	const_reference suffix() const
-	{
-		return suffix_;
-	}
+#if defined(WCHAR_MAX)
+	#if WCHAR_MAX >= 0x10ffff
+		typedef wcmatch u32wcmatch;
+		typedef wsmatch u32wsmatch;
+		typedef u32wcmatch u1632wcmatch;
+		typedef u32wsmatch u1632wsmatch;
+	#elif WCHAR_MAX >= 0xffff
+		typedef wcmatch u16wcmatch;
+		typedef wsmatch u16wsmatch;
+		typedef u16wcmatch u1632wcmatch;
+		typedef u16wsmatch u1632wsmatch;
+	#endif
+#endif
 
-	const_iterator begin() const
+#if defined(SRELL_CPP11_CHAR1632_ENABLED)
+	typedef match_results<const char16_t *> u16cmatch;
+	typedef match_results<const char32_t *> u32cmatch;
+	typedef match_results<std::u16string::const_iterator> u16smatch;
+	typedef match_results<std::u32string::const_iterator> u32smatch;
+#endif
+
+#if defined(SRELL_CPP20_CHAR8_ENABLED)
+	typedef match_results<const char8_t *> u8cmatch;
+#else
+	typedef u8ccmatch u8cmatch;
+#endif
+#if defined(SRELL_CPP20_CHAR8_ENABLED) && SRELL_CPP20_CHAR8_ENABLED >= 2
+	typedef match_results<std::u8string::const_iterator> u8smatch;
+#else	//  !defined(SRELL_CPP20_CHAR8_ENABLED) || SRELL_CPP20_CHAR8_ENABLED < 2
+	typedef u8csmatch u8smatch;
+#endif
+
+//  ... "regex_match_results.hpp"]
+//  ["rei_algorithm.hpp" ...
+
+	namespace re_detail
 	{
-		return sub_matches_.begin();
-	}
 
-	const_iterator end() const
+#if !defined(SRELL_NO_APIEXT)
+
+template <typename charT>
+struct repoptions
+{
+	const charT *fmt_begin;
+	const charT *fmt_end;
+	bool global;
+
+	repoptions(const charT *const b, const charT *const e, const bool g)
+		: fmt_begin(b), fmt_end(e), global(g)
 	{
-		return sub_matches_.end();
 	}
+};
 
-	const_iterator cbegin() const
+template <typename charT, typename ST, typename SA, typename BidiIter>
+bool call_mrformat(std::basic_string<charT, ST, SA> &s, const match_results<BidiIter> &m, void *p)
+{
+	const repoptions<charT> *const opts = reinterpret_cast<const repoptions<charT> *>(p);
+
+	m.format(std::back_inserter(s), opts->fmt_begin, opts->fmt_end);	//, flags);
+	return opts->global;
+}
+
+template <typename BidirectionalIterator, typename OffsetType>
+struct columnar_writer
+{
+	OffsetType *const *starts;
+	OffsetType *const *ends;
+	std::size_t numcols;
+	std::size_t capacity;
+	std::size_t *rows;
+	std::size_t *next;
+
+	columnar_writer(std::size_t &r, std::size_t &x, OffsetType *const *const s, OffsetType *const *const e, const std::size_t n, const std::size_t c)
+		: starts(s), ends(e), numcols(n), capacity(c), rows(&r), next(&x)
 	{
-		return sub_matches_.begin();
+		*rows = 0;
+		*next = static_cast<std::size_t>(-1);
 	}
 
-	const_iterator cend() const
+	bool operator()(const match_view<BidirectionalIterator> &m) const
 	{
-		return sub_matches_.end();
+		if (*rows == capacity)
+		{
+			*next = static_cast<std::size_t>(m.position());
+			return false;
+		}
+
+		for (std::size_t i = 0; i < numcols; ++i)
+		{
+			if (m[i].matched)
+			{
+				const OffsetType pos = static_cast<OffsetType>(m.position(i));
+
+				starts[i][*rows] = pos;
+				ends[i][*rows] = static_cast<OffsetType>(pos + m.length(i));
+			}
+			else
+				starts[i][*rows] = ends[i][*rows] = static_cast<OffsetType>(-1);
+		}
+		++*rows;
+		return true;
 	}
+};
 
-	//  28.10.5, format:
-	//  [7.10.4] format
-	template <class OutputIter>
-	OutputIter format(
-		OutputIter out,
-		const char_type *fmt_first,
-		const char_type *const fmt_last,
-		regex_constants::match_flag_type /* flags */ = regex_constants::format_default
+template <typename charT, typename StringLike, typename iteratorTag>
+iteratorTag pos0_(const StringLike &s, iteratorTag)
+{
+	return s.begin();
+}
+template <typename charT, typename StringLike>
+const charT *pos0_(const StringLike &s, const charT *)
+{
+	return s.data();
+}
+
+template <typename charT, typename StringLike, typename iteratorTag>
+iteratorTag pos1_(const StringLike &s, iteratorTag)
+{
+	return s.end();
+}
+template <typename charT, typename StringLike>
+const charT *pos1_(const StringLike &s, const charT *)
+{
+	return s.data() + s.size();
+}
+
+#endif	//  !defined(SRELL_NO_APIEXT)
+
+template <typename charT, typename traits>
+class re_object : public re_compiler<charT, traits>
+{
+public:
+
+	template <typename BidirectionalIterator, typename Allocator>
+	bool search
+	(
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		const BidirectionalIterator lookbehind_limit,
+		match_results<BidirectionalIterator, Allocator> &results,
+		const regex_constants::match_flag_type flags
 	) const
 	{
-		if (this->ready() && !this->empty())
-		{
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-			const bool no_groupnames = gnames_.size() == 0;
-#endif
-			const value_type &m0 = (*this)[0];
+		re_search_state<BidirectionalIterator> &sstate = results.sstate_;
 
-			while (fmt_first != fmt_last)
-			{
-				if (*fmt_first != static_cast<char_type>(re_detail::meta_char::mc_dollar))	//  '$'
-				{
-					*out++ = *fmt_first++;
-				}
-				else
-				{
-					++fmt_first;
-					if (fmt_first == fmt_last)
-					{
-						*out++ = re_detail::meta_char::mc_dollar;	//  '$';
-					}
-					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_amp))	//  '&', $&
-					{
-						out = std::copy(m0.first, m0.second, out);
-						++fmt_first;
-					}
-					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_grav))	//  '`', $`, prefix.
-					{
-						out = std::copy(this->prefix().first, this->prefix().second, out);
-						++fmt_first;
-					}
-					else if (*fmt_first == static_cast<char_type>(re_detail::char_other::co_apos))	//  '\'', $', suffix.
-					{
-						out = std::copy(this->suffix().first, this->suffix().second, out);
-						++fmt_first;
-					}
+		results.clear_();
+		sstate.init(begin, end, lookbehind_limit, flags);
+
+		const int reason = search_core(sstate);
+
+		if (reason == 1)
+		{
 #if !defined(SRELL_NO_NAMEDCAPTURE)
-					else if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_lt) && !no_groupnames)	//  '<', $<
-					{
-						const char_type *const current_backup = fmt_first;
-						bool replaced = false;
+			return results.set_match_results_(this->namedcaptures);
+#else
+			return results.set_match_results_();
+#endif
+		}
+#if !defined(SRELLDBG_NO_BMH)
+		if (reason == 2)
+			return results.set_match_results_bmh_();
+#endif
+		return results.mark_as_failed_(reason);
+	}
 
-						if (++fmt_first == fmt_last)
-							;	//  Do nothing.
-						else
-						{
-							const char_type *const name_begin = fmt_first;
+protected:
 
-							for (;; ++fmt_first)
-							{
-								if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_gt))
-								{
-									const re_detail::ui_l32 backref_number = lookup_backref_number(name_begin, fmt_first);
+#if !defined(SRELLDBG_NO_BMH)
 
-									if (backref_number != re_detail::groupname_mapper<char_type>::notfound)
-									{
-										const value_type &mn = (*this)[backref_number];
+	template <typename BidirectionalIterator>
+	bool do_bmh_search(re_search_state<BidirectionalIterator> &sstate) const
+	{
+		typedef typename std::iterator_traits<BidirectionalIterator>::iterator_category iterator_category;
 
-										if (mn.matched)
-											out = std::copy(mn.first, mn.second, out);
-//										replaced = true;
-									}
-									replaced = true;
-									++fmt_first;
-									break;
-								}
-								if (fmt_first == fmt_last)
-									break;
-							}
-						}
-						if (!replaced)
-						{
-							fmt_first = current_backup;
-							*out++ = re_detail::meta_char::mc_dollar;	//  '$';
-						}
-					}
-#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
-					else
-					{
-						const char_type *const backup_pos = fmt_first;
-						size_type backref_number = 0;
+		return
+#if !defined(SRELL_NO_ICASE)
+			this->is_ricase() ? this->bmdata->do_icasesearch(sstate, iterator_category()) :
+#endif
+#if !defined(SRELLDBG_NO_RAREUNIT)
+			is_contiguous(sstate.srchbegin) ? this->bmdata->do_rareunitsearch(sstate, iterator_category()) :
+#endif
+			this->bmdata->do_casesensitivesearch(sstate, iterator_category());
+	}
 
-						if (fmt_first != fmt_last && *fmt_first >= static_cast<char_type>(re_detail::char_alnum::ch_0) && *fmt_first <= static_cast<char_type>(re_detail::char_alnum::ch_9))	//  '0'-'9'
-						{
-							backref_number += *fmt_first - re_detail::char_alnum::ch_0;	//  '0';
+	//  When an interrupter is set, re_bmh is run on blocks of the subject
+	//  that overlap by the longest match, and the interrupter is called
+	//  between them.
+	template <typename BidirectionalIterator>
+	int do_bmh_search_blocks(re_search_state<BidirectionalIterator> &sstate) const
+	{
+		typedef typename std::iterator_traits<BidirectionalIterator>::iterator_category iterator_category;
+		const BidirectionalIterator begin = sstate.srchbegin;
+		const BidirectionalIterator end = sstate.srchend;
+		const std::size_t overlap = this->bmdata->maxlength() - 1;
+		int reason = 0;
 
-							if (++fmt_first != fmt_last && *fmt_first >= static_cast<char_type>(re_detail::char_alnum::ch_0) && *fmt_first <= static_cast<char_type>(re_detail::char_alnum::ch_9))	//  '0'-'9'
-							{
-								backref_number *= 10;
-								backref_number += *fmt_first - re_detail::char_alnum::ch_0;	//  '0';
-								++fmt_first;
-							}
-						}
+		for (;;)
+		{
+			sstate.srchend = block_end(sstate.srchbegin, end, constants::interrupt_scanblock + overlap, iterator_category());
 
-						if (backref_number && backref_number < this->size())
-						{
-							const value_type &mn = (*this)[backref_number];
+			if (do_bmh_search(sstate))
+			{
+				reason = 2;
+				break;
+			}
 
-							if (mn.matched)
-								out = std::copy(mn.first, mn.second, out);
-						}
-						else
-						{
-							*out++ = re_detail::meta_char::mc_dollar;	//  '$';
+			if (sstate.srchend == end)
+				break;
 
-							fmt_first = backup_pos;
-							if (*fmt_first == static_cast<char_type>(re_detail::meta_char::mc_dollar))
-								++fmt_first;
-						}
-					}
-				}
+			if (sstate.interrupter->interrupted())
+			{
+				reason = static_cast<int>(regex_constants::error_timeout);
+				break;
 			}
+
+			//  The next block begins where a match not found in this block
+			//  can begin at the earliest, moved back to a code point
+			//  boundary.
+			BidirectionalIterator next = sstate.srchend;
+
+			for (std::size_t i = overlap; i; --i)
+				--next;
+
+			for (; next != begin && utf_traits::is_trailing(*next); --next);
+
+			sstate.srchbegin = next;
 		}
-		return out;
+
+		sstate.srchbegin = begin;
+		sstate.srchend = end;
+		return reason;
 	}
 
-	template <class OutputIter, class ST, class SA>
-	OutputIter format(
-		OutputIter out,
-		const std::basic_string<char_type, ST, SA> &fmt,
-		regex_constants::match_flag_type flags = regex_constants::format_default
-	) const
+#endif	//  !defined(SRELLDBG_NO_BMH)
+
+	//  Returns the position len code units after pos, or end if it is nearer.
+	template <typename RandomAccessIterator>
+	RandomAccessIterator block_end(const RandomAccessIterator pos, const RandomAccessIterator end, const std::size_t len, const std::random_access_iterator_tag) const
 	{
-		return format(out, fmt.data(), fmt.data() + fmt.size(), flags);
+		return static_cast<std::size_t>(end - pos) > len ? pos + len : end;
 	}
 
-	template <class ST, class SA>
-	std::basic_string<char_type, ST, SA> format(
-		const string_type &fmt,
-		regex_constants::match_flag_type flags = regex_constants::format_default
-	) const
+	template <typename BidirectionalIterator>
+	BidirectionalIterator block_end(BidirectionalIterator pos, const BidirectionalIterator end, std::size_t len, const std::bidirectional_iterator_tag) const
 	{
-		std::basic_string<char_type, ST, SA> result;
+		for (; len && pos != end; --len)
+			++pos;
 
-//		format(std::back_insert_iterator<string_type>(result), fmt, flags);
-		format(std::back_inserter(result), fmt, flags);
-		return result;
+		return pos;
 	}
 
-	string_type format(const char_type *fmt, regex_constants::match_flag_type flags = regex_constants::format_default) const
+	//  Runs a search on sstate that has been init()'ed by the caller.
+	//  Returns 0 if not found, 1 if found by the automaton ([bracket[0].core.open_at,
+	//  ssc.iter)), 2 if found by re_bmh ([ssc.iter, nextpos)), or an error code.
+	//  The search loops return error_timeout as a reason code, and it is
+	//  thrown here unless SRELL_NO_THROW is defined.
+	template <typename BidirectionalIterator>
+	int search_core(re_search_state<BidirectionalIterator> &sstate) const
 	{
-		string_type result;
+		const int reason = sstate.is_interrupted() ? static_cast<int>(regex_constants::error_timeout) : do_search_core(sstate);
 
-		format(std::back_inserter(result), fmt, fmt + std::char_traits<char_type>::length(fmt), flags);
-		return result;
+#if !defined(SRELL_NO_THROW)
+		if (reason == static_cast<int>(regex_constants::error_timeout))
+			throw regex_error(regex_constants::error_timeout);
+#endif
+		return reason;
 	}
 
-	//  28.10.6, allocator:
-	//  [7.10.5] allocator
-	allocator_type get_allocator() const
+	template <typename BidirectionalIterator>
+	int do_search_core(re_search_state<BidirectionalIterator> &sstate) const
 	{
-		return allocator_type();
-	}
+		if (this->NFA_states.size())
+		{
+#if !defined(SRELLDBG_NO_BMH)
+			if (this->bmdata && !sstate.match_continuous_flag())
+			{
+				const int reason = sstate.interrupter ? do_bmh_search_blocks(sstate) : do_bmh_search(sstate) ? 2 : 0;
 
-	//  28.10.7, swap:
-	//  [7.10.6] swap
-	void swap(match_results &that)
-	{
-		const match_results tmp(that);
-		that = *this;
-		*this = tmp;
-	}
+#if defined(SRELL_ENABLE_STATS)
+				sstate.stats.bmh_skips += std::distance(sstate.srchbegin, reason == 2 ? sstate.ssc.iter : sstate.srchend);
+#endif
+				return reason;
+			}
+#endif	//  !defined(SRELLDBG_NO_BMH)
 
-	regex_constants::error_type ecode() const
-	{
-		return static_cast<regex_constants::error_type>(ready_ >> 1);
-	}
+#if !defined(SRELLDBG_NO_REQUIREDCHARS)
+			if (this->required_units.size() && !has_required_units(sstate.srchbegin, sstate.srchend, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
+				return 0;
+#endif
 
-public:	//  For internal.
+			sstate.init_for_automaton(this->number_of_brackets, this->number_of_counters, this->number_of_repeats);
 
-	typedef match_results<BidirectionalIterator> match_results_type;
-	typedef typename match_results_type::size_type match_results_size_type;
-	typedef typename re_detail::re_search_state</*charT, */BidirectionalIterator> search_state_type;
+#if defined(SRELL_ENABLE_PROFILER)
+			sstate.prepare_profile(this->NFA_states.size());
+#endif
 
-	search_state_type sstate_;
+			if (sstate.match_continuous_flag())
+			{
+				sstate.entry_state = this->NFA_states[0].next_state2();
 
-	void clear_()
-	{
-		ready_ = 0u;
-		sub_matches_.clear();
-//		prefix_.matched = false;
-//		suffix_.matched = false;
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-		gnames_.clear();
+				sstate.ssc.iter = sstate.nextpos;
+
+#if defined(SRELL_NO_LIMIT_COUNTER)
+				sstate.reset();
+#else
+				sstate.reset(this->limit_counter);
 #endif
-	}
+				return !this->is_ricase() ? run_automaton<false, false>(sstate) : run_automaton<true, false>(sstate);
+			}
 
-//	template <typename charT>
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-	bool set_match_results_(const re_detail::groupname_mapper<char_type> &gnames)
+			sstate.entry_state = this->NFA_states[0].next_state1();
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+			//  With the multiline flag, the first character filter does
+			//  better than looking for the beginning of each line.
+			if (this->NFA_states[0].next_state2()->type == st_bol && !this->NFA_states[0].next_state2()->flags)
+			{
+#if !defined(SRELL_NO_ICASE)
+				return !this->is_ricase() ? do_search_bol<false>(sstate) : do_search_bol<true>(sstate);
 #else
-	bool set_match_results_()
+				return do_search_bol<false>(sstate);
+#endif
+			}
+
+			//  With a match point rewinder, which goes back to where the
+			//  line begins by itself, skip_rewound_line() does the rest.
+			if ((this->NFA_states[0].flags & sflags::leading_anystar)
+				|| ((this->NFA_states[0].flags & sflags::leading_dotstar) && this->NFA_states[0].next1 == this->NFA_states[0].next2))
+			{
+#if !defined(SRELL_NO_ICASE)
+				return !this->is_ricase() ? do_search_lines<false>(sstate) : do_search_lines<true>(sstate);
+#else
+				return do_search_lines<false>(sstate);
+#endif
+			}
+
+			if (this->NFA_states[0].flags & sflags::eol_anchored)
+				skip_to_tail(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category());
+#endif	//  !defined(SRELLDBG_NO_SEARCH_PLAN)
+
+#if !defined(SRELLDBG_NO_SCFINDER)
+			if (this->NFA_states[0].char_num != constants::invalid_u32value)
+			{
+				return !this->is_ricase() ? do_search_sc<false>(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category()) : do_search_sc<true>(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category());
+			}
+#endif	//  !defined(SRELLDBG_NO_SCFINDER)
+
+#if !defined(SRELL_NO_ICASE)
+			return !this->is_ricase() ? do_search<false>(sstate) : do_search<true>(sstate);
+#else
+			return do_search<false>(sstate);
 #endif
+		}
+		return 0;
+	}
+
+#if defined(SRELL_ENABLE_PROFILER)
+
+	//  Lists the states entered at least once, in a table or in JSON.
+	//  If [pbegin, pend) is the expression, the part each state was made
+	//  from is shown, encoded in UTF-8.
+	template <typename ForwardIterator>
+	std::string profile_report_(const search_profile &prof, ForwardIterator pbegin, const ForwardIterator pend, const bool json) const
 	{
-		sub_matches_.resize(sstate_.bracket.size());
-//		value_type &m0 = sub_matches_[0];
+		simple_array<ui_l32> u32;
+		std::string report(json ? "[\n" : "");
+		bool first = true;
 
-		sub_matches_[0].matched = true;
+		while (pbegin != pend)
+			u32.push_back(utf_traits::codepoint_inc(pbegin, pend));
 
-		for (re_detail::ui_l32 i = 1; i < static_cast<re_detail::ui_l32>(sstate_.bracket.size()); ++i)
-			sub_matches_[i].set_(sstate_.bracket[i]);
+		if (!json)
+		{
+			append_column_(report, "state", 5, true);
+			append_column_(report, "type", 22, false);
+			append_column_(report, "entries", 10, true);
+			append_column_(report, "failures", 10, true);
+			if (u32.size())
+			{
+				append_column_(report, "span", 9, false);
+				report.append("source");
+			}
+			else
+				report.append("span");
+			report.push_back('\n');
+		}
 
-		base_ = sstate_.lblim;
-		prefix_.first = sstate_.srchbegin;
-		prefix_.second = sub_matches_[0].first = sstate_.bracket[0].core.open_at;
-		suffix_.first = sub_matches_[0].second = sstate_.ssc.iter;
-		suffix_.second = sstate_.srchend;
+		for (std::size_t no = 0; no < prof.entries.size() && no < this->NFA_states.size(); ++no)
+		{
+			if (prof.entries[no] == 0)
+				continue;
+
+			const typename re_object_core<charT, traits>::state_type &state = this->NFA_states[no];
+			const range_pair &srcspan = state.srcspan;
+			std::string source;
+			std::string span;
+
+			if (srcspan.second != 0 && srcspan.second <= u32.size())
+			{
+				char mbstr[utf8_traits<char>::maxseqlen];
+
+				for (ui_l32 i = srcspan.first; i < srcspan.second; ++i)
+				{
+					const ui_l32 seqlen = utf8_traits<char>::to_codeunits(mbstr, u32[i]);
+
+					for (ui_l32 j = 0; j < seqlen; ++j)
+					{
+						if (json && (mbstr[j] == '"' || mbstr[j] == '\\'))
+							source.push_back('\\');
+
+						if (json && static_cast<unsigned char>(mbstr[j]) < 0x20)
+						{
+							source.append("\\u00");
+							source.push_back("0123456789abcdef"[(mbstr[j] >> 4) & 0xf]);
+							source.push_back("0123456789abcdef"[mbstr[j] & 0xf]);
+						}
+						else
+							source.push_back(mbstr[j]);
+					}
+				}
+			}
+
+			if (json)
+			{
+				report.append(first ? "{\"state\": " : ",\n{\"state\": ");
+				append_number_(report, no);
+				report.append(", \"type\": \"");
+				report.append(state_type_name_(state.type));
+				report.append("\", \"entries\": ");
+				append_number_(report, prof.entries[no]);
+				report.append(", \"failures\": ");
+				append_number_(report, prof.failures[no]);
+
+				if (srcspan.second != 0)
+				{
+					report.append(", \"begin\": ");
+					append_number_(report, srcspan.first);
+					report.append(", \"end\": ");
+					append_number_(report, srcspan.second);
+				}
+				if (u32.size())
+				{
+					report.append(", \"source\": \"");
+					report.append(source);
+					report.push_back('"');
+				}
+				report.push_back('}');
+			}
+			else
+			{
+				if (srcspan.second != 0)
+				{
+					append_number_(span, srcspan.first);
+					span.push_back('-');
+					append_number_(span, srcspan.second);
+				}
+				else
+					span.push_back('-');
 
-		prefix_.matched = prefix_.first != prefix_.second;
-		suffix_.matched = suffix_.first != suffix_.second;
+				append_column_(report, no, 5);
+				append_column_(report, state_type_name_(state.type), 22, false);
+				append_column_(report, prof.entries[no], 10);
+				append_column_(report, prof.failures[no], 10);
+				if (u32.size())
+				{
+					append_column_(report, span, 9, false);
+					report.append(source);
+				}
+				else
+					report.append(span);
+				report.push_back('\n');
+			}
+			first = false;
+		}
 
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-		gnames_ = gnames;
-#endif
-		ready_ = 1u;
-		return true;
+		if (json)
+			report.append(first ? "]\n" : "\n]\n");
+
+		return report;
 	}
 
-	bool set_match_results_bmh_()
-	{
-		sub_matches_.resize(1);
-//		value_type &m0 = sub_matches_[0];
+#endif	//  defined(SRELL_ENABLE_PROFILER)
 
-		sub_matches_[0].matched = true;
+private:
 
-		base_ = sstate_.lblim;
-		prefix_.first = sstate_.srchbegin;
-		prefix_.second = sub_matches_[0].first = sstate_.ssc.iter;
-		suffix_.first = sub_matches_[0].second = sstate_.nextpos;
-		suffix_.second = sstate_.srchend;
+	typedef typename traits::utf_traits utf_traits;
 
-		prefix_.matched = prefix_.first != prefix_.second;
-		suffix_.matched = suffix_.first != suffix_.second;
+#if defined(SRELL_ENABLE_PROFILER)
 
-		ready_ = 1u;
-		return true;
+	static const char *state_type_name_(const re_state_type type)
+	{
+		switch (type)
+		{
+		case st_character: return "character";
+		case st_character_class: return "character_class";
+		case st_epsilon: return "epsilon";
+		case st_check_counter: return "check_counter";
+		case st_decrement_counter: return "decrement_counter";
+		case st_save_and_reset_counter: return "save_and_reset_counter";
+		case st_restore_counter: return "restore_counter";
+		case st_roundbracket_open: return "roundbracket_open";
+		case st_roundbracket_pop: return "roundbracket_pop";
+		case st_roundbracket_close: return "roundbracket_close";
+		case st_repeat_in_push: return "repeat_in_push";
+		case st_repeat_in_pop: return "repeat_in_pop";
+		case st_check_0_width_repeat: return "check_0_width_repeat";
+		case st_backreference: return "backreference";
+		case st_lookaround_open: return "lookaround_open";
+		case st_lookaround_pop: return "lookaround_pop";
+		case st_bol: return "bol";
+		case st_eol: return "eol";
+		case st_boundary: return "boundary";
+		case st_success: return "success";
+		case st_string: return "string";
+		case st_repeat_atom: return "repeat_atom";
+		case st_repeat_atom_pop: return "repeat_atom_pop";
+		case st_character_switch: return "character_switch";
+		default: return "unknown";
+		}
 	}
 
-	void set_prefix1_(const BidirectionalIterator pf)
+	static void append_number_(std::string &str, std::size_t num)
 	{
-		prefix_.first = pf;
+		char digits[24];
+		std::size_t len = 0;
+
+		do
+		{
+			digits[len++] = static_cast<char>('0' + num % 10);
+			num /= 10;
+		}
+		while (num);
+
+		while (len)
+			str.push_back(digits[--len]);
 	}
 
-	void update_prefix1_(const BidirectionalIterator pf)
+	//  Right-aligned.
+	static void append_column_(std::string &str, const std::size_t num, const std::size_t width)
 	{
-		prefix_.first = pf;
-		prefix_.matched = prefix_.first != prefix_.second;
+		std::string numstr;
+
+		append_number_(numstr, num);
+		append_column_(str, numstr, width, true);
 	}
 
-	void update_prefix2_(const BidirectionalIterator ps)
+	static void append_column_(std::string &str, const std::string &text, const std::size_t width, const bool right)
 	{
-		prefix_.second = ps;
-		prefix_.matched = prefix_.first != prefix_.second;
+		if (right && text.size() < width)
+			str.append(width - text.size(), ' ');
+		str.append(text);
+		if (!right && text.size() < width)
+			str.append(width - text.size(), ' ');
+		str.append("  ");
 	}
 
-	void update_m0_(const BidirectionalIterator mf, const BidirectionalIterator ms)
+#endif	//  defined(SRELL_ENABLE_PROFILER)
+
+	template <const bool icase, typename BidirectionalIterator>
+	int do_search(re_search_state<BidirectionalIterator> &sstate) const
 	{
-		sub_matches_.resize(1);
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+		const ui_l32 minlen = minimum_length();
+#endif
 
-		sub_matches_[0].first = mf;
-		sub_matches_[0].second = ms;
-		sub_matches_[0].matched = true;
+		for (;;)
+		{
+			const bool final = sstate.nextpos == sstate.srchend;
 
-		prefix_.first = prefix_.second = mf;
-	}
+			sstate.ssc.iter = sstate.nextpos;
 
-	bool mark_as_failed_(const int reason)
-	{
-		ready_ = reason ? (reason << 1) : 1u;
-		return false;
-	}
+			if (!final)
+			{
+#if defined(SRELLDBG_NO_1STCHRCLS)
+				utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend);
+#else
+	#if !defined(SRELLDBG_NO_BITSET)
+				if (!this->firstchar_class_bs.test((*sstate.nextpos++) & utf_traits::bitsetmask))
+	#else
+				const ui_l32 firstchar = utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend);
 
-private:
+				if (!this->firstchar_class.is_included(firstchar))
+	#endif
+				{
+#if defined(SRELL_ENABLE_STATS)
+					++sstate.stats.firstchar_skips;
+#endif
+					if (sstate.is_interrupted())
+						return static_cast<int>(regex_constants::error_timeout);
+					continue;
+				}
+#endif	//  defined(SRELLDBG_NO_1STCHRCLS)
+			}
+			//  Even when final == true, we have to try for such expressions
+			//  as "" =~ /^$/ or "..." =~ /$/.
 
-#if !defined(SRELL_NO_NAMEDCAPTURE)
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+			if (is_too_short(sstate, minlen, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
+				break;
+#endif
 
-	re_detail::ui_l32 lookup_backref_number(const char_type *begin, const char_type *const end) const
-	{
-		typename re_detail::groupname_mapper<char_type>::gname_string key(end - begin);
+			if (sstate.is_interrupted())
+				return static_cast<int>(regex_constants::error_timeout);
 
-		for (std::size_t i = 0; begin != end; ++begin, ++i)
-			key[i] = *begin;
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+			const BidirectionalIterator candidate = sstate.ssc.iter;
+#endif
 
-		return gnames_[key];
+#if defined(SRELL_NO_LIMIT_COUNTER)
+			sstate.reset(/* first */);
+#else
+			sstate.reset(/* first, */ this->limit_counter);
+#endif
+			const int reason = run_automaton<icase, false>(sstate /* , false */);
+			if (reason)
+				return reason;
+
+			if (final)
+				break;
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+			skip_rewound_line(sstate, candidate);
+#endif
+		}
+		return 0;
 	}
 
-#endif	//  !defined(SRELL_NO_NAMEDCAPTURE)
+#if !defined(SRELLDBG_NO_SCFINDER)
 
-public:	//  For debug.
+	template <const bool icase, typename ContiguousIterator>
+	int do_search_sc(re_search_state<ContiguousIterator> &sstate, const std::random_access_iterator_tag) const
+	{
+		if (is_contiguous(sstate.srchbegin))
+		{
+			typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
+			const char_type ec = static_cast<char_type>(this->NFA_states[0].char_num);
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+			const ui_l32 minlen = minimum_length();
+#endif
 
-	template <typename BasicRegexT>
-	void print_sub_matches(const BasicRegexT &, const int) const;
-	void print_addresses(const value_type &, const char *const) const;
+			for (;;)
+			{
+				if (sstate.nextpos >= sstate.srchend)
+					break;
 
-private:
+				sstate.ssc.iter = sstate.nextpos;
 
-	typedef std::vector<value_type, Allocator> sub_match_array;
+				//  With an interrupter, the rest is scanned per block.
+				const ContiguousIterator scanend = sstate.interrupter ? block_end(sstate.nextpos, sstate.srchend, constants::interrupt_scanblock, std::random_access_iterator_tag()) : sstate.srchend;
+				const char_type *const bgnpos = std::char_traits<char_type>::find(&*sstate.nextpos, scanend - sstate.nextpos, ec);
 
-	unsigned int ready_;
-	sub_match_array sub_matches_;
-	value_type prefix_;
-	value_type suffix_;
-	value_type unmatched_;
-	BidirectionalIterator base_;
+#if defined(SRELL_ENABLE_STATS)
+				sstate.stats.firstchar_skips += (bgnpos ? bgnpos : &*sstate.nextpos + (scanend - sstate.nextpos)) - &*sstate.nextpos;
+#endif
 
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-	re_detail::groupname_mapper<char_type> gnames_;
+				if (bgnpos)
+				{
+//					sstate.ssc.iter = bgnpos;
+					sstate.ssc.iter += bgnpos - &*sstate.nextpos;
+//					sstate.nextpos = bgnpos + 1;
+					sstate.nextpos = sstate.ssc.iter + 1;
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+					if (is_too_short(sstate, minlen, std::random_access_iterator_tag()))
+						break;
 #endif
-};
 
-//  28.10.7, match_results swap:
-//  [7.10.6] match_results swap
-template <class BidirectionalIterator, class Allocator>
-void swap(
-	match_results<BidirectionalIterator, Allocator> &m1,
-	match_results<BidirectionalIterator, Allocator> &m2
-)
-{
-	m1.swap(m2);
-}
+					if (sstate.is_interrupted())
+						return static_cast<int>(regex_constants::error_timeout);
 
-//  28.10.8, match_results comparisons
-template <class BidirectionalIterator, class Allocator>
-bool operator==(
-	const match_results<BidirectionalIterator, Allocator> &m1,
-	const match_results<BidirectionalIterator, Allocator> &m2
-)
-{
-	if (!m1.ready() && !m2.ready())
-		return true;
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+					const ContiguousIterator candidate = sstate.ssc.iter;
+#endif
 
-	if (m1.ready() && m2.ready())
-	{
-		if (m1.empty() && m2.empty())
-			return true;
+#if defined(SRELL_NO_LIMIT_COUNTER)
+					sstate.reset();
+#else
+					sstate.reset(this->limit_counter);
+#endif
+					const int reason = run_automaton<icase, false>(sstate);
+					if (reason)
+						return reason;
 
-		if (!m1.empty() && !m2.empty())
-		{
-			return m1.prefix() == m2.prefix() && m1.size() == m2.size() && std::equal(m1.begin(), m1.end(), m2.begin()) && m1.suffix() == m2.suffix();
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+					skip_rewound_line(sstate, candidate);
+#endif
+				}
+				else if (scanend != sstate.srchend)
+				{
+					sstate.nextpos = scanend;
+
+					if (sstate.interrupter->interrupted())
+						return static_cast<int>(regex_constants::error_timeout);
+				}
+				else
+					break;
+			}
+			return 0;
 		}
+		return do_search_sc<icase>(sstate, std::bidirectional_iterator_tag());
 	}
-	return false;
-}
 
-template <class BidirectionalIterator, class Allocator>
-bool operator!=(
-	const match_results<BidirectionalIterator, Allocator> &m1,
-	const match_results<BidirectionalIterator, Allocator> &m2
-)
-{
-	return !(m1 == m2);
-}
+	template <const bool icase, typename BidirectionalIterator>
+	int do_search_sc(re_search_state<BidirectionalIterator> &sstate, const std::bidirectional_iterator_tag) const
+	{
+		typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
+		const char_type ec = static_cast<char_type>(this->NFA_states[0].char_num);
 
-typedef match_results<const char *> cmatch;
-typedef match_results<const wchar_t *> wcmatch;
-typedef match_results<std::string::const_iterator> smatch;
-typedef match_results<std::wstring::const_iterator> wsmatch;
+		for (; sstate.nextpos != sstate.srchend;)
+		{
+			const BidirectionalIterator scanend = sstate.interrupter ? block_end(sstate.nextpos, sstate.srchend, constants::interrupt_scanblock, std::bidirectional_iterator_tag()) : sstate.srchend;
 
-typedef cmatch u8ccmatch;
-typedef smatch u8csmatch;
+			sstate.ssc.iter = find(sstate.nextpos, scanend, ec);
 
-#if defined(WCHAR_MAX)
-	#if WCHAR_MAX >= 0x10ffff
-		typedef wcmatch u32wcmatch;
-		typedef wsmatch u32wsmatch;
-		typedef u32wcmatch u1632wcmatch;
-		typedef u32wsmatch u1632wsmatch;
-	#elif WCHAR_MAX >= 0xffff
-		typedef wcmatch u16wcmatch;
-		typedef wsmatch u16wsmatch;
-		typedef u16wcmatch u1632wcmatch;
-		typedef u16wsmatch u1632wsmatch;
-	#endif
+#if defined(SRELL_ENABLE_STATS)
+			sstate.stats.firstchar_skips += std::distance(sstate.nextpos, sstate.ssc.iter);
 #endif
 
-#if defined(SRELL_CPP11_CHAR1632_ENABLED)
-	typedef match_results<const char16_t *> u16cmatch;
-	typedef match_results<const char32_t *> u32cmatch;
-	typedef match_results<std::u16string::const_iterator> u16smatch;
-	typedef match_results<std::u32string::const_iterator> u32smatch;
+			if (sstate.ssc.iter != scanend)
+			{
+				sstate.nextpos = sstate.ssc.iter;
+				++sstate.nextpos;
+
+				if (sstate.is_interrupted())
+					return static_cast<int>(regex_constants::error_timeout);
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+				const BidirectionalIterator candidate = sstate.ssc.iter;
 #endif
 
-#if defined(SRELL_CPP20_CHAR8_ENABLED)
-	typedef match_results<const char8_t *> u8cmatch;
+#if defined(SRELL_NO_LIMIT_COUNTER)
+				sstate.reset();
 #else
-	typedef u8ccmatch u8cmatch;
+				sstate.reset(this->limit_counter);
 #endif
-#if defined(SRELL_CPP20_CHAR8_ENABLED) && SRELL_CPP20_CHAR8_ENABLED >= 2
-	typedef match_results<std::u8string::const_iterator> u8smatch;
-#else	//  !defined(SRELL_CPP20_CHAR8_ENABLED) || SRELL_CPP20_CHAR8_ENABLED < 2
-	typedef u8csmatch u8smatch;
+				const int reason = run_automaton<icase, false>(sstate);
+				if (reason)
+					return reason;
+
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
+				skip_rewound_line(sstate, candidate);
 #endif
+			}
+			else if (scanend != sstate.srchend)
+			{
+				sstate.nextpos = scanend;
 
-//  ... "regex_match_results.hpp"]
-//  ["rei_algorithm.hpp" ...
+				if (sstate.interrupter->interrupted())
+					return static_cast<int>(regex_constants::error_timeout);
+			}
+			else
+				break;
+		}
+		return 0;
+	}
 
-	namespace re_detail
+	template <typename BidirectionalIterator, typename CharT0>
+	BidirectionalIterator find(BidirectionalIterator begin, const BidirectionalIterator end, const CharT0 c) const
 	{
+		for (; begin != end; ++begin)
+			if ((*begin & utf_traits::bitsetmask) == (c & utf_traits::bitsetmask))
+				break;
 
-#if !defined(SRELL_NO_APIEXT)
+		return begin;
+	}
 
-template <typename charT>
-struct repoptions
-{
-	const charT *fmt_begin;
-	const charT *fmt_end;
-	bool global;
+	//  Returns the position of the first single character in [begin, end),
+	//  or end.
+	template <typename ContiguousIterator>
+	ContiguousIterator find_sc(const ContiguousIterator begin, const ContiguousIterator end, const std::random_access_iterator_tag) const
+	{
+		if (is_contiguous(begin) && begin != end)
+		{
+			typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
+			const char_type *const found = std::char_traits<char_type>::find(&*begin, end - begin, static_cast<char_type>(this->NFA_states[0].char_num));
 
-	repoptions(const charT *const b, const charT *const e, const bool g)
-		: fmt_begin(b), fmt_end(e), global(g)
+			return found ? begin + (found - &*begin) : end;
+		}
+		return find(begin, end, this->NFA_states[0].char_num);
+	}
+
+	template <typename BidirectionalIterator>
+	BidirectionalIterator find_sc(const BidirectionalIterator begin, const BidirectionalIterator end, const std::bidirectional_iterator_tag) const
 	{
+		return find(begin, end, this->NFA_states[0].char_num);
 	}
-};
 
-template <typename charT, typename ST, typename SA, typename BidiIter>
-bool call_mrformat(std::basic_string<charT, ST, SA> &s, const match_results<BidiIter> &m, void *p)
-{
-	const repoptions<charT> *const opts = reinterpret_cast<const repoptions<charT> *>(p);
+#endif	//  !defined(SRELLDBG_NO_SCFINDER)
 
-	m.format(std::back_inserter(s), opts->fmt_begin, opts->fmt_end);	//, flags);
-	return opts->global;
-}
+#if !defined(SRELLDBG_NO_REQUIREDCHARS)
 
-template <typename charT, typename StringLike, typename iteratorTag>
-iteratorTag pos0_(const StringLike &s, iteratorTag)
-{
-	return s.begin();
-}
-template <typename charT, typename StringLike>
-const charT *pos0_(const StringLike &s, const charT *)
-{
-	return s.data();
-}
+	//  Returns false if one of required_units is missing from [begin, end),
+	//  which then contains no match.
+	//  char_traits::find is used only for one-byte units, for which it is
+	//  memchr. For wider ones it can be a loop that compares one unit at a
+	//  time (so in libstdc++), slower than std::find.
+	template <typename ContiguousIterator>
+	bool has_required_units(const ContiguousIterator begin, const ContiguousIterator end, const std::random_access_iterator_tag) const
+	{
+		typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
 
-template <typename charT, typename StringLike, typename iteratorTag>
-iteratorTag pos1_(const StringLike &s, iteratorTag)
-{
-	return s.end();
-}
-template <typename charT, typename StringLike>
-const charT *pos1_(const StringLike &s, const charT *)
-{
-	return s.data() + s.size();
-}
+		if (sizeof (char_type) == 1 && is_contiguous(begin) && begin != end)
+		{
+			const std::size_t len = static_cast<std::size_t>(end - begin);
 
-#endif	//  !defined(SRELL_NO_APIEXT)
+			for (std::size_t i = 0; i < this->required_units.size(); ++i)
+				if (!std::char_traits<char_type>::find(&*begin, len, static_cast<char_type>(this->required_units[i])))
+					return false;
 
-template <typename charT, typename traits>
-class re_object : public re_compiler<charT, traits>
-{
-public:
+			return true;
+		}
+		return has_required_units(begin, end, std::bidirectional_iterator_tag());
+	}
 
-	template <typename BidirectionalIterator, typename Allocator>
-	bool search
-	(
-		const BidirectionalIterator begin,
-		const BidirectionalIterator end,
-		const BidirectionalIterator lookbehind_limit,
-		match_results<BidirectionalIterator, Allocator> &results,
-		const regex_constants::match_flag_type flags
-	) const
+	template <typename BidirectionalIterator>
+	bool has_required_units(const BidirectionalIterator begin, const BidirectionalIterator end, const std::bidirectional_iterator_tag) const
 	{
-		int reason = 0;
-
-		results.clear_();
-
-		if (this->NFA_states.size())
-		{
-			re_search_state<BidirectionalIterator> &sstate = results.sstate_;
+		typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
 
-			sstate.init(begin, end, lookbehind_limit, flags);
+		for (std::size_t i = 0; i < this->required_units.size(); ++i)
+			if (std::find(begin, end, static_cast<char_type>(this->required_units[i])) == end)
+				return false;
 
-#if !defined(SRELLDBG_NO_BMH)
-			if (this->bmdata && !sstate.match_continuous_flag())
-			{
-#if !defined(SRELL_NO_ICASE)
-				if (!this->is_ricase() ? this->bmdata->do_casesensitivesearch(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category()) : this->bmdata->do_icasesearch(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
-#else
-				if (this->bmdata->do_casesensitivesearch(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
-#endif	//  !defined(SRELL_NO_ICASE)
-					return results.set_match_results_bmh_();
+		return true;
+	}
 
-				goto NOT_FOUND;
-			}
-#endif	//  !defined(SRELLDBG_NO_BMH)
+#endif	//  !defined(SRELLDBG_NO_REQUIREDCHARS)
 
-			sstate.init_for_automaton(this->number_of_brackets, this->number_of_counters, this->number_of_repeats);
+#if !defined(SRELLDBG_NO_SEARCH_PLAN)
 
-			if (sstate.match_continuous_flag())
-			{
-				sstate.entry_state = this->NFA_states[0].next_state2;
+	//  For an expression that begins with ^ without the multiline flag.
+	//  It can match only where the subject begins, so the automaton is run
+	//  only once.
+	template <const bool icase, typename BidirectionalIterator>
+	int do_search_bol(re_search_state<BidirectionalIterator> &sstate) const
+	{
+		sstate.entry_state = this->NFA_states[0].next_state2();
+		sstate.ssc.iter = sstate.nextpos;
 
-				sstate.ssc.iter = sstate.nextpos;
+		if (is_too_short(sstate, this->NFA_states[0].quantifier.atleast, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
+			return 0;
 
 #if defined(SRELL_NO_LIMIT_COUNTER)
-				sstate.reset();
+		sstate.reset();
 #else
-				sstate.reset(this->limit_counter);
+		sstate.reset(this->limit_counter);
 #endif
-				reason = !this->is_ricase() ? run_automaton<false, false>(sstate) : run_automaton<true, false>(sstate);
+		return run_automaton<icase, false>(sstate);
+	}
 
-				goto CHECK_REASON;
-			}
+	//  For an expression that begins with .* or .+. If the automaton fails
+	//  at the beginning of a line, it fails at every position up to the
+	//  next line terminator, so the search moves on to the next line. With
+	//  leading_anystar, only an invalid sequence ends a "line".
+	template <const bool icase, typename BidirectionalIterator>
+	int do_search_lines(re_search_state<BidirectionalIterator> &sstate) const
+	{
+		const ui_l32 minlen = this->NFA_states[0].quantifier.atleast;
 
-			sstate.entry_state = this->NFA_states[0].next_state1;
+		sstate.entry_state = this->NFA_states[0].next_state2();
 
 #if !defined(SRELLDBG_NO_SCFINDER)
-			if (this->NFA_states[0].char_num != constants::invalid_u32value)
-			{
-				reason = !this->is_ricase() ? do_search_sc<false>(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category()) : do_search_sc<true>(sstate, typename std::iterator_traits<BidirectionalIterator>::iterator_category());
+		//  Every match contains the single character.
+		if (this->NFA_states[0].char_num != constants::invalid_u32value
+				&& find_sc(sstate.nextpos, sstate.srchend, typename std::iterator_traits<BidirectionalIterator>::iterator_category()) == sstate.srchend)
+			return 0;
+#endif
 
-				goto CHECK_REASON;
-			}
-#endif	//  !defined(SRELLDBG_NO_SCFINDER)
+		for (;;)
+		{
+			sstate.ssc.iter = sstate.nextpos;
 
-#if !defined(SRELL_NO_ICASE)
-			reason = !this->is_ricase() ? do_search<false>(sstate) : do_search<true>(sstate);
+			if (is_too_short(sstate, minlen, typename std::iterator_traits<BidirectionalIterator>::iterator_category()))
+				break;
+
+			if (sstate.is_interrupted())
+				return static_cast<int>(regex_constants::error_timeout);
+
+#if defined(SRELL_NO_LIMIT_COUNTER)
+			sstate.reset();
 #else
-			reason = do_search<false>(results);
+			sstate.reset(this->limit_counter);
 #endif
-			CHECK_REASON:
-			if (reason == 1)
+			const int reason = run_automaton<icase, false>(sstate);
+			if (reason)
+				return reason;
+
+			for (;;)
 			{
-#if !defined(SRELL_NO_NAMEDCAPTURE)
-				return results.set_match_results_(this->namedcaptures);
-#else
-				return results.set_match_results_();
-#endif
+				if (sstate.nextpos == sstate.srchend)
+					return 0;
+
+				const ui_l32 c = utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend);
+
+				if (c > constants::unicode_max_codepoint || (!(this->NFA_states[0].flags & sflags::leading_anystar) && stops_dot(c)))
+					break;
 			}
 		}
-#if !defined(SRELLDBG_NO_BMH)
-		NOT_FOUND:
-#endif
-		return results.mark_as_failed_(reason);
+		return 0;
 	}
 
-private:
+	//  Called after the automaton has failed at candidate. If the match
+	//  point rewinder has moved the beginning back to where the line
+	//  begins, the automaton has been rerun from there, and every other
+	//  position in the line fails in the same way.
+	template <typename BidirectionalIterator>
+	void skip_rewound_line(re_search_state<BidirectionalIterator> &sstate, const BidirectionalIterator candidate) const
+	{
+		if ((this->NFA_states[0].flags & sflags::within_line) && sstate.bracket[0].core.open_at != candidate)
+		{
+			for (sstate.nextpos = candidate; sstate.nextpos != sstate.srchend;)
+				if (stops_dot(utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend)))
+					break;
+		}
+	}
 
-	typedef typename traits::utf_traits utf_traits;
+	//  Returns true if /./ without dotall does not match c, which is a line
+	//  terminator or, from an invalid sequence, not a code point.
+	static bool stops_dot(const ui_l32 c)
+	{
+		return c == char_ctrl::cc_nl || c == char_ctrl::cc_cr || c == 0x2028 || c == 0x2029 || c > constants::unicode_max_codepoint;
+	}
 
-	template <const bool icase, typename BidirectionalIterator>
-	int do_search(re_search_state<BidirectionalIterator> &sstate) const
+	//  For an eol_anchored expression. No match can begin further than
+	//  the maximum length from the end, in code units.
+	template <typename RandomAccessIterator>
+	void skip_to_tail(re_search_state<RandomAccessIterator> &sstate, const std::random_access_iterator_tag) const
 	{
-		for (;;)
-		{
-			const bool final = sstate.nextpos == sstate.srchend;
+		const std::size_t maxlen = this->NFA_states[0].quantifier.atmost;
+		const std::size_t rest = static_cast<std::size_t>(sstate.srchend - sstate.nextpos);
 
-			sstate.ssc.iter = sstate.nextpos;
+		if (rest / utf_traits::maxseqlen > maxlen)
+			sstate.nextpos = sstate.srchend - static_cast<typename std::iterator_traits<RandomAccessIterator>::difference_type>(maxlen * utf_traits::maxseqlen);
+	}
 
-			if (!final)
-			{
-#if defined(SRELLDBG_NO_1STCHRCLS)
-				utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend);
-#else
-	#if !defined(SRELLDBG_NO_BITSET)
-				if (!this->firstchar_class_bs.test((*sstate.nextpos++) & utf_traits::bitsetmask))
-	#else
-				const ui_l32 firstchar = utf_traits::codepoint_inc(sstate.nextpos, sstate.srchend);
+	template <typename BidirectionalIterator>
+	void skip_to_tail(re_search_state<BidirectionalIterator> &, const std::bidirectional_iterator_tag) const
+	{
+	}
 
-				if (!this->firstchar_class.is_included(firstchar))
-	#endif
-					continue;
-#endif	//  defined(SRELLDBG_NO_1STCHRCLS)
-			}
-			//  Even when final == true, we have to try for such expressions
-			//  as "" =~ /^$/ or "..." =~ /$/.
+	//  The minimum length of the expression, which is also that of what
+	//  is left after the position the automaton is run from, unless a
+	//  rewinder moves the beginning of the match back.
+	ui_l32 minimum_length() const
+	{
+		return this->NFA_states[0].next1 == this->NFA_states[0].next2 ? this->NFA_states[0].quantifier.atleast : 0u;
+	}
+
+	template <typename RandomAccessIterator>
+	bool is_too_short(const re_search_state<RandomAccessIterator> &sstate, const ui_l32 minlen, const std::random_access_iterator_tag) const
+	{
+		return static_cast<std::size_t>(sstate.srchend - sstate.ssc.iter) < minlen;
+	}
+
+	template <typename BidirectionalIterator>
+	bool is_too_short(const re_search_state<BidirectionalIterator> &, const ui_l32, const std::bidirectional_iterator_tag) const
+	{
+		return false;
+	}
+
+#endif	//  !defined(SRELLDBG_NO_SEARCH_PLAN)
+
+	template <typename BidirectionalIterator>
+	bool is_contiguous(BidirectionalIterator) const
+	{
+		return false;
+	}
+
+#if !defined(SRELL_NO_CONCEPTS) && defined(__cpp_concepts)
+
+	template <std::contiguous_iterator I>
+	bool is_contiguous(I) const
+	{
+		return true;
+	}
 
-#if defined(SRELL_NO_LIMIT_COUNTER)
-			sstate.reset(/* first */);
 #else
-			sstate.reset(/* first, */ this->limit_counter);
-#endif
-			const int reason = run_automaton<icase, false>(sstate /* , false */);
-			if (reason)
-				return reason;
 
-			if (final)
-				break;
-		}
-		return 0;
+	bool is_contiguous(const charT *) const
+	{
+		return true;
 	}
 
-#if !defined(SRELLDBG_NO_SCFINDER)
+	bool is_contiguous(typename std::basic_string<charT>::const_iterator) const
+	{
+		return true;
+	}
+#endif	//  !defined(SRELL_NO_CONCEPTS) && defined(__cpp_concepts)
 
-	template <const bool icase, typename ContiguousIterator>
-	int do_search_sc(re_search_state<ContiguousIterator> &sstate, const std::random_access_iterator_tag) const
+	template <const bool icase, const bool reverse, typename BidirectionalIterator>
+	void consume_repeat_atom(const re_state &atom, re_search_state<BidirectionalIterator> &sstate) const
 	{
-		if (is_contiguous(sstate.srchbegin))
+		typedef casehelper<ui_l32, icase> casehelper_type;
+		BidirectionalIterator &iter = sstate.ssc.iter;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+		if (!reverse)
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
 		{
-			typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
-			const char_type ec = static_cast<char_type>(this->NFA_states[0].char_num);
+			if (atom.flags == 0u)
+			{
+				for (; !sstate.is_at_srchend();)
+				{
+					const BidirectionalIterator prevpos = iter;
 
-			for (;;)
+					if (casehelper_type::canonicalise(utf_traits::codepoint_inc(iter, sstate.srchend)) != atom.char_num)
+					{
+						iter = prevpos;
+						break;
+					}
+				}
+			}
+			else if (atom.flags == 1u)
 			{
-				if (sstate.nextpos >= sstate.srchend)
-					break;
+				find_excluded(iter, sstate.srchend, atom.char_num, typename std::iterator_traits<BidirectionalIterator>::iterator_category());
 
-				sstate.ssc.iter = sstate.nextpos;
+				for (; !sstate.is_at_srchend();)
+				{
+					const ui_l32 cu = static_cast<ui_l32>(*iter);
+
+					if (cu < 0x80)	//  Whatever the encoding, an ASCII character.
+					{
+						if (cu == atom.char_num)
+							break;
+						++iter;
+						continue;
+					}
 
-				const char_type *const bgnpos = std::char_traits<char_type>::find(&*sstate.nextpos, sstate.srchend - sstate.nextpos, ec);
+					const BidirectionalIterator prevpos = iter;
+					const ui_l32 uchar = utf_traits::codepoint_inc(iter, sstate.srchend);
 
-				if (bgnpos)
+					//  May be an overlong sequence decoded into the excluded one.
+					if (uchar == atom.char_num || uchar > constants::unicode_max_codepoint)
+					{
+						iter = prevpos;
+						break;
+					}
+				}
+			}
+			else
+			{
+				for (; !sstate.is_at_srchend();)
 				{
-//					sstate.ssc.iter = bgnpos;
-					sstate.ssc.iter += bgnpos - &*sstate.nextpos;
-//					sstate.nextpos = bgnpos + 1;
-					sstate.nextpos = sstate.ssc.iter + 1;
+					const BidirectionalIterator prevpos = iter;
+					const ui_l32 uchar = utf_traits::codepoint_inc(iter, sstate.srchend);
 
-#if defined(SRELL_NO_LIMIT_COUNTER)
-					sstate.reset();
+#if !defined(SRELLDBG_NO_CCPOS)
+					if (!this->character_class.is_included(atom.quantifier.atleast, atom.quantifier.atmost, uchar))
 #else
-					sstate.reset(this->limit_counter);
+					if (!this->character_class.is_included(atom.char_num, uchar))
 #endif
-					const int reason = run_automaton<icase, false>(sstate);
-					if (reason)
-						return reason;
+					{
+						iter = prevpos;
+						break;
+					}
 				}
-				else
+			}
+		}
+		else	//  reverse == true.
+		{
+			for (; !sstate.is_at_lookbehindlimit();)
+			{
+				const BidirectionalIterator prevpos = iter;
+				const ui_l32 uchar = utf_traits::dec_codepoint(iter, sstate.lblim);
+
+				if (!is_in_repeat_atom<icase>(atom, uchar))
+				{
+					iter = prevpos;
 					break;
+				}
 			}
-			return 0;
 		}
-		return do_search_sc<icase>(sstate, std::bidirectional_iterator_tag());
 	}
 
-	template <const bool icase, typename BidirectionalIterator>
-	int do_search_sc(re_search_state<BidirectionalIterator> &sstate, const std::bidirectional_iterator_tag) const
+#if !defined(SRELLDBG_NO_BOUNDED_REPEAT)
+	//  Consumes at least quantifier.atleast and at most quantifier.atmost of
+	//  the repeat_atom_pop that follows. minpos receives where the minimum
+	//  ends.
+	template <const bool icase, const bool reverse, typename BidirectionalIterator>
+	bool consume_bounded_repeat_atom(const re_state &atom, re_search_state<BidirectionalIterator> &sstate, BidirectionalIterator &minpos) const
 	{
-		typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
-		const char_type ec = static_cast<char_type>(this->NFA_states[0].char_num);
+		const re_quantifier &bounds = atom.next_state2()->quantifier;
+		BidirectionalIterator &iter = sstate.ssc.iter;
+		ui_l32 count = 0;
 
-		for (; sstate.nextpos != sstate.srchend;)
+		for (; count < bounds.atmost; ++count)
 		{
-			sstate.ssc.iter = find(sstate.nextpos, sstate.srchend, ec);
-
-			if (sstate.ssc.iter != sstate.srchend)
-			{
-				sstate.nextpos = sstate.ssc.iter;
-				++sstate.nextpos;
+			if (count == bounds.atleast)
+				minpos = iter;
 
-#if defined(SRELL_NO_LIMIT_COUNTER)
-				sstate.reset();
-#else
-				sstate.reset(this->limit_counter);
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
 #endif
-				const int reason = run_automaton<icase, false>(sstate);
-				if (reason)
-					return reason;
-			}
-			else
+			if (!reverse ? sstate.is_at_srchend() : sstate.is_at_lookbehindlimit())
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+				break;
+
+			const BidirectionalIterator prevpos = iter;
+			const ui_l32 uchar = !reverse
+				? utf_traits::codepoint_inc(iter, sstate.srchend)
+				: utf_traits::dec_codepoint(iter, sstate.lblim);
+
+			if (!is_in_repeat_atom<icase>(atom, uchar))
+			{
+				iter = prevpos;
 				break;
+			}
 		}
-		return 0;
+
+		if (count < bounds.atleast)
+			return false;
+
+		if (count == bounds.atleast)
+			minpos = iter;
+
+		return true;
 	}
+#endif	//  !defined(SRELLDBG_NO_BOUNDED_REPEAT)
 
-	template <typename BidirectionalIterator, typename CharT0>
-	BidirectionalIterator find(BidirectionalIterator begin, const BidirectionalIterator end, const CharT0 c) const
+	template <const bool icase>
+	bool is_in_repeat_atom(const re_state &atom, const ui_l32 uchar) const
 	{
-		for (; begin != end; ++begin)
-			if ((*begin & utf_traits::bitsetmask) == (c & utf_traits::bitsetmask))
-				break;
+		if ((atom.flags & 9u) == 0u)
+			return casehelper<ui_l32, icase>::canonicalise(uchar) == atom.char_num;
 
-		return begin;
+		if ((atom.flags & 9u) == 1u)
+			return uchar != atom.char_num && uchar <= constants::unicode_max_codepoint;
+
+#if !defined(SRELLDBG_NO_CCPOS)
+		return this->character_class.is_included(atom.quantifier.atleast, atom.quantifier.atmost, uchar);
+#else
+		return this->character_class.is_included(atom.char_num, uchar);
+#endif
 	}
 
-	template <typename BidirectionalIterator>
-	bool is_contiguous(BidirectionalIterator) const
+	//  Binary search in the cases of character_switch.
+	const range_pair *find_switch_case(const re_state &state, const ui_l32 uchar) const
 	{
-		return false;
-	}
+		const range_pair *base = this->switch_cases.data() + state.char_num;
+		ui_l32 count = state.quantifier.atleast;
 
-#if !defined(SRELL_NO_CONCEPTS) && defined(__cpp_concepts)
+		while (count)
+		{
+			const ui_l32 half = count >> 1;
 
-	template <std::contiguous_iterator I>
-	bool is_contiguous(I) const
-	{
-		return true;
+			if (base[half].first < uchar)
+			{
+				base += half + 1;
+				count -= half + 1;
+			}
+			else
+				count = half;
+		}
+		return base != this->switch_cases.data() + state.char_num + state.quantifier.atleast && base->first == uchar ? base : NULL;
 	}
 
-#else
-
-	bool is_contiguous(const charT *) const
+	template <typename BidirectionalIterator>
+	void find_excluded(BidirectionalIterator &, const BidirectionalIterator, const ui_l32, const std::bidirectional_iterator_tag) const
 	{
-		return true;
 	}
 
-	bool is_contiguous(typename std::basic_string<charT>::const_iterator) const
+	//  Skips to the excluded character with char_traits::find if the
+	//  code units skipped are all ASCII. Otherwise leaves it to the caller.
+	template <typename ContiguousIterator>
+	void find_excluded(ContiguousIterator &iter, const ContiguousIterator end, const ui_l32 ec, const std::random_access_iterator_tag) const
 	{
-		return true;
+		if (iter != end && is_contiguous(iter))
+		{
+			typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
+			const char_type *const begin = &*iter;
+			const std::size_t len = end - iter;
+			const char_type *found = std::char_traits<char_type>::find(begin, len, static_cast<char_type>(ec));
+
+			if (found == NULL)
+				found = begin + len;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+			if (utf_traits::maxseqlen > 1 || utf_traits::charbit > 8)
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+			{
+				ui_l32 units = 0u;
+
+				//  No early exit so that the loop can be vectorised.
+				for (const char_type *cur = begin; cur != found; ++cur)
+					units |= static_cast<ui_l32>(*cur);
+
+				if (units > 0x7f)
+					return;
+			}
+			iter += found - begin;
+		}
 	}
-#endif	//  !defined(SRELL_NO_CONCEPTS) && defined(__cpp_concepts)
-#endif	//  !defined(SRELLDBG_NO_SCFINDER)
 
 	template <typename T, const bool>
 	struct casehelper
@@ -22000,41 +24934,75 @@ private:
 		typedef casehelper<ui_l32, icase> casehelper_type;
 		typedef typename re_object_core<charT, traits>::state_type state_type;
 		typedef re_search_state</*charT, */BidirectionalIterator> ss_type;
-//		typedef typename ss_type::search_state_core ssc_type;
+		typedef typename ss_type::search_state_core ssc_type;
 		typedef typename ss_type::submatch_type submatch_type;
 		typedef typename ss_type::submatchcore_type submatchcore_type;
 		typedef typename ss_type::counter_type counter_type;
 		typedef typename ss_type::position_type position_type;
 		ui_l32 is_matched;
 
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+		//  In the order of re_state_type.
+		static const void *const dispatch_table[] = {
+			&&CG_CHARACTER, &&CG_CHARACTER_CLASS, &&CG_EPSILON,
+			&&CG_CHECK_COUNTER, &&CG_DECREMENT_COUNTER, &&CG_SAVE_AND_RESET_COUNTER, &&CG_RESTORE_COUNTER,
+			&&CG_ROUNDBRACKET_OPEN, &&CG_ROUNDBRACKET_POP, &&CG_ROUNDBRACKET_CLOSE,
+			&&CG_REPEAT_IN_PUSH, &&CG_REPEAT_IN_POP, &&CG_CHECK_0_WIDTH_REPEAT,
+			&&CG_BACKREFERENCE, &&CG_LOOKAROUND_OPEN, &&CG_LOOKAROUND_POP,
+			&&CG_BOL, &&CG_EOL, &&CG_BOUNDARY, &&CG_SUCCESS, &&CG_STRING,
+			&&CG_REPEAT_ATOM, &&CG_REPEAT_ATOM_POP, &&CG_CHARACTER_SWITCH
+#if defined(SRELLTEST_NEXTPOS_OPT)
+			, &&CG_MOVE_NEXTPOS
+#endif
+		};
+#endif
+
 		goto START;
 
 		JUDGE:
 		if (is_matched)
 		{
 			MATCHED:
-			sstate.ssc.state = sstate.ssc.state->next_state1;
+			sstate.ssc.state = sstate.ssc.state->next_state1();
 		}
 		else
 		{
 			NOT_MATCHED:
 
+#if defined(SRELL_ENABLE_PROFILER)
+			++sstate.profile.failures[sstate.ssc.state - this->NFA_states.data()];
+#endif
+
 #if !defined(SRELL_NO_LIMIT_COUNTER)
 			if (--sstate.failure_counter)
 			{
+				BACKTRACK:
 #endif
 				if (sstate.bt_stack.size() > sstate.btstack_size)
 				{
+#if defined(SRELL_ENABLE_STATS)
+					++sstate.stats.backtracks;
+					sstate.sample_btstack_depth();
+#endif
 					sstate.ssc = sstate.bt_stack.back();
 					sstate.bt_stack.pop_back();
 
-					sstate.ssc.state = sstate.ssc.state->next_state2;
+					sstate.ssc.state = sstate.ssc.state->next_state2();
 				}
 				else
 					return 0;
 
 #if !defined(SRELL_NO_LIMIT_COUNTER)
 			}
+			else if (sstate.failure_reserve)
+			{
+				if (sstate.interrupter->interrupted())
+					return static_cast<int>(regex_constants::error_timeout);
+				sstate.refill_failure_counter();
+				goto BACKTRACK;
+			}
 			else
 #if defined(SRELL_NO_THROW)
 				return static_cast<int>(regex_constants::error_complexity);
@@ -22049,9 +25017,25 @@ private:
 		{
 			START:
 
+#if defined(SRELL_ENABLE_PROFILER)
+			++sstate.profile.entries[sstate.ssc.state - this->NFA_states.data()];
+#endif
+
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+			__builtin_prefetch(sstate.ssc.state->next_state1());
+			goto *dispatch_table[sstate.ssc.state->type];
+#pragma GCC diagnostic pop
+#endif
+
 			switch (sstate.ssc.state->type)
 			{
 			case st_character:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_CHARACTER:
+#endif
+#if !defined(SRELL_ENABLE_PROFILER)
+				ST_CHARACTER:
+#endif
 
 #if defined(_MSC_VER) && _MSC_VER >= 1400
 #pragma warning(push)
@@ -22071,12 +25055,23 @@ private:
 						RETRY_CF:
 
 						if (sstate.ssc.state->char_num == uchar)
+						{
+#if !defined(SRELL_ENABLE_PROFILER)
+							//  A character followed by another one is the most
+							//  common sequence. Compared without the dispatch.
+							sstate.ssc.state = sstate.ssc.state->next_state1();
+							if (sstate.ssc.state->type == st_character)
+								goto ST_CHARACTER;
+							continue;
+#else
 							goto MATCHED;
+#endif
+						}
 
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-						if (sstate.ssc.state->next_state2)
+						if (sstate.ssc.state->next2)
 						{
-							sstate.ssc.state = sstate.ssc.state->next_state2;
+							sstate.ssc.state = sstate.ssc.state->next_state2();
 
 							if (sstate.ssc.state->type == st_character)
 								goto RETRY_CF;
@@ -22087,9 +25082,9 @@ private:
 #endif
 					}
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-					else if (sstate.ssc.state->next_state2)
+					else if (sstate.ssc.state->next2)
 					{
-						sstate.ssc.state = sstate.ssc.state->next_state2;
+						sstate.ssc.state = sstate.ssc.state->next_state2();
 						continue;
 					}
 #endif
@@ -22105,12 +25100,23 @@ private:
 						RETRY_CB:
 
 						if (sstate.ssc.state->char_num == uchar)
+						{
+#if !defined(SRELL_ENABLE_PROFILER)
+							//  A character followed by another one is the most
+							//  common sequence. Compared without the dispatch.
+							sstate.ssc.state = sstate.ssc.state->next_state1();
+							if (sstate.ssc.state->type == st_character)
+								goto ST_CHARACTER;
+							continue;
+#else
 							goto MATCHED;
+#endif
+						}
 
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-						if (sstate.ssc.state->next_state2)
+						if (sstate.ssc.state->next2)
 						{
-							sstate.ssc.state = sstate.ssc.state->next_state2;
+							sstate.ssc.state = sstate.ssc.state->next_state2();
 
 							if (sstate.ssc.state->type == st_character)
 								goto RETRY_CB;
@@ -22121,9 +25127,9 @@ private:
 #endif
 					}
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-					else if (sstate.ssc.state->next_state2)
+					else if (sstate.ssc.state->next2)
 					{
-						sstate.ssc.state = sstate.ssc.state->next_state2;
+						sstate.ssc.state = sstate.ssc.state->next_state2();
 						continue;
 					}
 #endif
@@ -22131,6 +25137,9 @@ private:
 				goto NOT_MATCHED;
 
 			case st_character_class:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_CHARACTER_CLASS:
+#endif
 
 #if defined(_MSC_VER) && _MSC_VER >= 1400
 #pragma warning(push)
@@ -22157,9 +25166,9 @@ private:
 							goto MATCHED;
 
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-						if (sstate.ssc.state->next_state2)
+						if (sstate.ssc.state->next2)
 						{
-							sstate.ssc.state = sstate.ssc.state->next_state2;
+							sstate.ssc.state = sstate.ssc.state->next_state2();
 
 //							if (sstate.ssc.state->type == st_character_class)
 //								goto RETRY_CCF;
@@ -22170,9 +25179,9 @@ private:
 #endif
 					}
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-					else if (sstate.ssc.state->next_state2)
+					else if (sstate.ssc.state->next2)
 					{
-						sstate.ssc.state = sstate.ssc.state->next_state2;
+						sstate.ssc.state = sstate.ssc.state->next_state2();
 						continue;
 					}
 #endif
@@ -22195,9 +25204,9 @@ private:
 							goto MATCHED;
 
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-						if (sstate.ssc.state->next_state2)
+						if (sstate.ssc.state->next2)
 						{
-							sstate.ssc.state = sstate.ssc.state->next_state2;
+							sstate.ssc.state = sstate.ssc.state->next_state2();
 
 //							if (sstate.ssc.state->type == st_character_class)
 //								goto RETRY_CCB;
@@ -22208,25 +25217,191 @@ private:
 #endif
 					}
 #if !defined(SRELLDBG_NO_ASTERISK_OPT)
-					else if (sstate.ssc.state->next_state2)
+					else if (sstate.ssc.state->next2)
 					{
-						sstate.ssc.state = sstate.ssc.state->next_state2;
+						sstate.ssc.state = sstate.ssc.state->next_state2();
 						continue;
 					}
 #endif
 				}
 				goto NOT_MATCHED;
 
+			case st_string:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_STRING:
+#endif
+				{
+					const charT *cu = this->strings.data() + sstate.ssc.state->char_num;
+					const charT *const cuend = cu + sstate.ssc.state->quantifier.atleast;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+					if (!reverse)
+					{
+						if (!icase)
+						{
+							//  Compared code unit by code unit like BMH.
+							for (; cu != cuend; ++cu, ++sstate.ssc.iter)
+								if (sstate.is_at_srchend() || *sstate.ssc.iter != *cu)
+									goto NOT_MATCHED;
+						}
+						else
+						{
+							for (; cu != cuend;)
+								if (sstate.is_at_srchend() || casehelper_type::canonicalise(utf_traits::codepoint_inc(sstate.ssc.iter, sstate.srchend)) != utf_traits::codepoint_inc(cu, cuend))
+									goto NOT_MATCHED;
+						}
+					}
+					else	//  reverse == true.
+					{
+						//  In lookbehinds the characters are placed in the reverse order.
+						for (; cu != cuend;)
+							if (sstate.is_at_lookbehindlimit() || casehelper_type::canonicalise(utf_traits::dec_codepoint(sstate.ssc.iter, sstate.lblim)) != utf_traits::codepoint_inc(cu, cuend))
+								goto NOT_MATCHED;
+					}
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+				}
+				goto MATCHED;
+
+			case st_repeat_atom:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_REPEAT_ATOM:
+#endif
+				{
+#if !defined(SRELLDBG_NO_BOUNDED_REPEAT)
+					if (sstate.ssc.state->flags & 16u)
+						goto BOUNDED_REPEAT_ATOM;
+#endif
+					const BidirectionalIterator orgpos = sstate.ssc.iter;
+
+					consume_repeat_atom<icase, reverse>(*sstate.ssc.state, sstate);
+
+					if (sstate.ssc.state->quantifier.is_greedy && sstate.ssc.iter != orgpos)
+					{
+						//  Instead of one entry per character, two entries for
+						//  the whole run. The lower one keeps where the run began,
+						//  and is removed only by repeat_atom_pop.
+						const ssc_type endstate = sstate.ssc;
+
+						sstate.ssc.state = endstate.state->next_state2();
+						sstate.ssc.iter = orgpos;
+						sstate.bt_stack.push_back(sstate.ssc);
+						sstate.bt_stack.push_back(endstate);
+						sstate.ssc = endstate;
+					}
+				}
+				goto MATCHED;
+
+#if !defined(SRELLDBG_NO_BOUNDED_REPEAT)
+				BOUNDED_REPEAT_ATOM:
+				{
+					BidirectionalIterator minpos = sstate.ssc.iter;
+
+					if (!consume_bounded_repeat_atom<icase, reverse>(*sstate.ssc.state, sstate, minpos))
+						goto NOT_MATCHED;
+
+					if (sstate.ssc.state->quantifier.is_greedy && sstate.ssc.iter != minpos)
+					{
+						//  As above, but what the minimum consumed is never
+						//  given back.
+						const ssc_type endstate = sstate.ssc;
+
+						sstate.ssc.state = endstate.state->next_state2();
+						sstate.ssc.iter = minpos;
+						sstate.bt_stack.push_back(sstate.ssc);
+						sstate.bt_stack.push_back(endstate);
+						sstate.ssc = endstate;
+					}
+				}
+				goto MATCHED;
+#endif
+
+			case st_repeat_atom_pop:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_REPEAT_ATOM_POP:
+#endif
+				{
+					//  Gives back one character and retries what follows the run.
+					const BidirectionalIterator orgpos = sstate.bt_stack.back().iter;
+
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+					if (!reverse)
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+						utf_traits::dec_codepoint(sstate.ssc.iter, orgpos);
+					else
+						utf_traits::codepoint_inc(sstate.ssc.iter, orgpos);
+
+					if (sstate.ssc.iter != orgpos)
+					{
+						sstate.ssc.state = sstate.ssc.state->next_state2();
+						sstate.bt_stack.push_back(sstate.ssc);
+						sstate.ssc.state = sstate.ssc.state->next_state2();
+					}
+					else
+						sstate.bt_stack.pop_back();
+				}
+				goto MATCHED;
+
+			case st_character_switch:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_CHARACTER_SWITCH:
+#endif
+				{
+					//  Goes straight to the alternative that begins with the
+					//  character, as the chain of characters it replaces does.
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(push)
+#pragma warning(disable:4127)
+#endif
+					if (!reverse ? !sstate.is_at_srchend() : !sstate.is_at_lookbehindlimit())
+#if defined(_MSC_VER) && _MSC_VER >= 1400
+#pragma warning(pop)
+#endif
+					{
+						const BidirectionalIterator prevpos = sstate.ssc.iter;
+						const ui_l32 uchar = casehelper_type::canonicalise(!reverse
+							? utf_traits::codepoint_inc(sstate.ssc.iter, sstate.srchend)
+							: utf_traits::dec_codepoint(sstate.ssc.iter, sstate.lblim));
+						const range_pair *const found = find_switch_case(*sstate.ssc.state, uchar);
+
+						if (found)
+						{
+							sstate.ssc.state = this->NFA_states.data() + found->second;
+							continue;
+						}
+						sstate.ssc.iter = prevpos;
+					}
+
+					if (sstate.ssc.state->next2)
+					{
+						sstate.ssc.state = sstate.ssc.state->next_state2();
+						continue;
+					}
+				}
+				goto NOT_MATCHED;
+
 			case st_epsilon:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_EPSILON:
+#endif
 
 #if defined(SRELLDBG_NO_SKIP_EPSILON)
-				if (sstate.ssc.state->next_state2)
+				if (sstate.ssc.state->next2)
 #endif
 				{
 					sstate.bt_stack.push_back(sstate.ssc);	//	sstate.push();
 				}
 
-				sstate.ssc.state = sstate.ssc.state->next_state1;
+				sstate.ssc.state = sstate.ssc.state->next_state1();
 				continue;
 
 			default:
@@ -22234,6 +25409,9 @@ private:
 				{
 
 			case st_check_counter:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_CHECK_COUNTER:
+#endif
 				{
 					ST_CHECK_COUNTER:
 					ui_l32 &counter = sstate.counter[sstate.ssc.state->char_num];
@@ -22247,14 +25425,14 @@ private:
 							LOOP_WITHOUT_INCREMENT:	//  counter >= atmost && atmost == infinity.
 
 							sstate.bt_stack.push_back(sstate.ssc);
-							sstate.ssc.state = sstate.ssc.state->next_state1;
+							sstate.ssc.state = sstate.ssc.state->next_state1();
 						}
 						else
 						{
 							sstate.ssc.state
 								= sstate.ssc.state->quantifier.is_greedy
-								? sstate.ssc.state->next_state1
-								: sstate.ssc.state->next_state2;
+								? sstate.ssc.state->next_state1()
+								: sstate.ssc.state->next_state2();
 						}
 					}
 					else
@@ -22264,17 +25442,23 @@ private:
 
 						sstate.ssc.state
 							= sstate.ssc.state->quantifier.is_greedy
-							? sstate.ssc.state->next_state2
-							: sstate.ssc.state->next_state1;
+							? sstate.ssc.state->next_state2()
+							: sstate.ssc.state->next_state1();
 					}
 				}
 				continue;
 
 			case st_decrement_counter:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_DECREMENT_COUNTER:
+#endif
 				--sstate.counter[sstate.ssc.state->char_num];
 				goto NOT_MATCHED;
 
 			case st_save_and_reset_counter:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_SAVE_AND_RESET_COUNTER:
+#endif
 				{
 					counter_type &c = sstate.counter[sstate.ssc.state->char_num];
 
@@ -22282,15 +25466,21 @@ private:
 					sstate.bt_stack.push_back(sstate.ssc);
 					c = 0;
 				}
-				sstate.ssc.state = sstate.ssc.state->next_state1;
+				sstate.ssc.state = sstate.ssc.state->next_state1();
 				goto ST_CHECK_COUNTER;
 
 			case st_restore_counter:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_RESTORE_COUNTER:
+#endif
 				sstate.counter[sstate.ssc.state->char_num] = sstate.counter_stack.back();
 				sstate.counter_stack.pop_back();
 				goto NOT_MATCHED;
 
 			case st_roundbracket_open:	//  '(':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_ROUNDBRACKET_OPEN:
+#endif
 				{
 					submatch_type &bracket = sstate.bracket[sstate.ssc.state->char_num];
 
@@ -22328,6 +25518,9 @@ private:
 				goto MATCHED;
 
 			case st_roundbracket_pop:	//  '/':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_ROUNDBRACKET_POP:
+#endif
 				{
 					for (ui_l32 brno = sstate.ssc.state->quantifier.atmost; brno >= sstate.ssc.state->quantifier.atleast; --brno)
 					{
@@ -22348,33 +25541,36 @@ private:
 				goto NOT_MATCHED;
 
 			case st_roundbracket_close:	//  ')':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_ROUNDBRACKET_CLOSE:
+#endif
 				{
 					submatch_type &bracket = sstate.bracket[sstate.ssc.state->char_num];
 					submatchcore_type &brc = bracket.core;
 
 					if ((!reverse ? brc.open_at : brc.close_at) != sstate.ssc.iter)
 					{
-						sstate.ssc.state = sstate.ssc.state->next_state1;
+						sstate.ssc.state = sstate.ssc.state->next_state1();
 					}
 					else	//  0 width match, breaks from the loop.
 					{
-						if (sstate.ssc.state->next_state1->type != st_check_counter)
+						if (sstate.ssc.state->next_state1()->type != st_check_counter)
 						{
 							if (bracket.counter > 1)
 								goto NOT_MATCHED;	//  ECMAScript spec 15.10.2.5, note 4.
 
-							sstate.ssc.state = sstate.ssc.state->next_state2;
+							sstate.ssc.state = sstate.ssc.state->next_state2();
 								//  Accepts 0 width match and exits.
 						}
 						else
 						{
 							//  A pair with check_counter.
-							const counter_type counter = sstate.counter[sstate.ssc.state->next_state1->char_num];
+							const counter_type counter = sstate.counter[sstate.ssc.state->next_state1()->char_num];
 
-							if (counter > sstate.ssc.state->next_state1->quantifier.atleast)
+							if (counter > sstate.ssc.state->next_state1()->quantifier.atleast)
 								goto NOT_MATCHED;	//  Takes a captured string in the previous loop.
 
-							sstate.ssc.state = sstate.ssc.state->next_state1;
+							sstate.ssc.state = sstate.ssc.state->next_state1();
 								//  Accepts 0 width match and continues.
 						}
 					}
@@ -22397,6 +25593,9 @@ private:
 				continue;
 
 			case st_repeat_in_push:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_REPEAT_IN_PUSH:
+#endif
 				{
 					position_type &r = sstate.repeat[sstate.ssc.state->char_num];
 
@@ -22418,6 +25617,9 @@ private:
 				goto MATCHED;
 
 			case st_repeat_in_pop:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_REPEAT_IN_POP:
+#endif
 				for (ui_l32 brno = sstate.ssc.state->quantifier.atmost; brno >= sstate.ssc.state->quantifier.atleast; --brno)
 				{
 					submatch_type &inner_bracket = sstate.bracket[brno];
@@ -22433,31 +25635,37 @@ private:
 				goto NOT_MATCHED;
 
 			case st_check_0_width_repeat:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_CHECK_0_WIDTH_REPEAT:
+#endif
 				if (sstate.ssc.iter != sstate.repeat[sstate.ssc.state->char_num])
 					goto MATCHED;
 
-				if (sstate.ssc.state->next_state1->type == st_check_counter)
+				if (sstate.ssc.state->next_state1()->type == st_check_counter)
 				{
-					const counter_type counter = sstate.counter[sstate.ssc.state->next_state1->char_num];
+					const counter_type counter = sstate.counter[sstate.ssc.state->next_state1()->char_num];
 
-					if (counter > sstate.ssc.state->next_state1->quantifier.atleast)
+					if (counter > sstate.ssc.state->next_state1()->quantifier.atleast)
 						goto NOT_MATCHED;
 
-					sstate.ssc.state = sstate.ssc.state->next_state1;
+					sstate.ssc.state = sstate.ssc.state->next_state1();
 				}
 				else
-					sstate.ssc.state = sstate.ssc.state->next_state2;
+					sstate.ssc.state = sstate.ssc.state->next_state2();
 
 				continue;
 
 			case st_backreference:	//  '\\':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_BACKREFERENCE:
+#endif
 				{
 					const submatch_type &bracket = sstate.bracket[sstate.ssc.state->char_num];
 
 					if (bracket.counter == 0)	//  Undefined.
 					{
 						ESCAPE_FROM_ZERO_WIDTH_MATCH:
-						sstate.ssc.state = sstate.ssc.state->next_state2;
+						sstate.ssc.state = sstate.ssc.state->next_state2();
 						continue;
 					}
 
@@ -22533,9 +25741,16 @@ private:
 				goto MATCHED;
 
 			case st_lookaround_open:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_LOOKAROUND_OPEN:
+#endif
 				{
 					const state_type *const lostate = sstate.ssc.state;
 
+#if defined(SRELL_ENABLE_STATS)
+					++sstate.stats.lookarounds;
+#endif
+
 					for (ui_l32 brno = lostate->quantifier.atleast; brno <= lostate->quantifier.atmost; ++brno)
 					{
 						const submatch_type &sm = sstate.bracket[brno];
@@ -22574,27 +25789,24 @@ private:
 						}
 					}
 #endif
-					sstate.ssc.state = lostate->next_state2->next_state1;
+					sstate.ssc.state = lostate->next_state2()->next_state1();
 
 					//  sstate.ssc.state is no longer pointing to lookaround_open!
 
-#if defined(SRELL_NO_THROW)
-					const int reason =
-#else
-					is_matched =
-#endif
+					{
+						const int reason =
 #if !defined(SRELL_FIXEDWIDTHLOOKBEHIND)
-						(lostate->quantifier.is_greedy == 0 ? run_automaton<icase, false>(sstate) : run_automaton<icase, true>(sstate));
+							(lostate->quantifier.is_greedy == 0 ? run_automaton<icase, false>(sstate) : run_automaton<icase, true>(sstate));
 #else
-						run_automaton<icase, false>(sstate);
+							run_automaton<icase, false>(sstate);
 #endif
 
-#if defined(SRELL_NO_THROW)
-					if (reason & ~1)
-						return reason;
+						//  error_timeout is returned also in the throw mode.
+						if (reason & ~1)
+							return reason;
 
-					is_matched = reason ? 1 : 0;
-#endif
+						is_matched = reason ? 1 : 0;
+					}
 
 #if defined(SRELL_FIXEDWIDTHLOOKBEHIND)
 					AFTER_LOOKAROUND:
@@ -22609,9 +25821,7 @@ private:
 					}
 #endif
 
-#if defined(SRELL_ENABLE_GT)
 					if (lostate->char_num != meta_char::mc_gt)	//  '>'
-#endif
 					{
 #if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
 						if (lostate->quantifier.is_greedy < 3)
@@ -22631,20 +25841,23 @@ private:
 					{
 #if !defined(SRELL_FIXEDWIDTHLOOKBEHIND) && !defined(SRELLDBG_NO_MPREWINDER)
 						if (lostate->quantifier.is_greedy == 3)
-							sstate.ssc.state = this->NFA_states[0].next_state2;
+							sstate.ssc.state = this->NFA_states[0].next_state2();
 						else
 #endif
-							sstate.ssc.state = lostate->next_state1;
+							sstate.ssc.state = lostate->next_state1();
 						continue;
 					}
 
 					if (lostate->quantifier.atleast <= lostate->quantifier.atmost)
 						sstate.bt_stack.pop_back();
-					sstate.ssc.state = lostate->next_state2;
+					sstate.ssc.state = lostate->next_state2();
 				}
 				//@fallthrough@
 
 			case st_lookaround_pop:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_LOOKAROUND_POP:
+#endif
 				for (ui_l32 brno = sstate.ssc.state->quantifier.atmost; brno >= sstate.ssc.state->quantifier.atleast; --brno)
 				{
 					submatch_type &sm = sstate.bracket[brno];
@@ -22657,6 +25870,9 @@ private:
 				goto NOT_MATCHED;
 
 			case st_bol:	//  '^':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_BOL:
+#endif
 				if (sstate.is_at_lookbehindlimit() && !sstate.is_prev_avail())
 				{
 					if (!sstate.match_not_bol_flag())
@@ -22677,6 +25893,9 @@ private:
 				goto NOT_MATCHED;
 
 			case st_eol:	//  '$':
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_EOL:
+#endif
 				if (sstate.is_at_srchend())
 				{
 					if (!sstate.match_not_eol_flag())
@@ -22696,6 +25915,9 @@ private:
 				goto NOT_MATCHED;
 
 			case st_boundary:	//  '\b' '\B'
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_BOUNDARY:
+#endif
 				is_matched = sstate.ssc.state->flags;	//  is_not.
 //				is_matched = sstate.ssc.state->char_num == char_alnum::ch_B;
 
@@ -22748,8 +25970,16 @@ private:
 				goto JUDGE;
 
 			case st_success:	//  == lookaround_close.
-//				if (is_recursive)
-				if (sstate.btstack_size)
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_SUCCESS:
+#endif
+#if defined(SRELL_ENABLE_STATS)
+				sstate.sample_btstack_depth();
+#endif
+				//  lookaround_close has the char_num of its lookaround_open.
+				//  btstack_size cannot tell it, as it is 0 also in a
+				//  lookaround entered before anything has been pushed.
+				if (sstate.ssc.state->char_num != char_ctrl::cc_nul)
 					return 1;
 
 				if
@@ -22764,6 +25994,9 @@ private:
 
 #if defined(SRELLTEST_NEXTPOS_OPT)
 			case st_move_nextpos:
+#if defined(SRELL_GNU_COMPUTED_GOTO_ENABLED)
+				CG_MOVE_NEXTPOS:
+#endif
 #if !defined(SRELLDBG_NO_1STCHRCLS) && !defined(SRELLDBG_NO_BITSET)
 				sstate.nextpos = sstate.ssc.iter;
 				if (!sstate.is_at_srchend())
@@ -22850,6 +26083,256 @@ protected:
 		}
 	}
 
+	//  The scan starts at from, and positions are measured from begin, which
+	//  lookbehinds can look back to as well.
+	template <typename BidirectionalIterator, typename Callback>
+	regex_constants::error_type do_for_each_match(
+		const BidirectionalIterator begin,
+		const BidirectionalIterator from,
+		const BidirectionalIterator end,
+		Callback SRELL_FORWARDING_REF callback,
+		regex_constants::match_flag_type flags,
+		interrupt_checker *const ic
+	) const
+	{
+		typedef match_view<BidirectionalIterator> view_type;
+		re_search_state<BidirectionalIterator> sstate;
+		view_type view(sstate);
+		BidirectionalIterator start = from;
+		BidirectionalIterator prevend = from;
+
+		if (from != begin)
+			flags |= regex_constants::match_prev_avail;
+
+		sstate.set_interrupter(ic);
+
+		for (;;)
+		{
+			sstate.init(start, end, begin, flags);
+
+			const int reason = search_core(sstate);
+
+			if (reason == 1)
+				view.set_(sstate.bracket.size(), sstate.bracket[0].core.open_at, sstate.ssc.iter, prevend);
+#if !defined(SRELLDBG_NO_BMH)
+			else if (reason == 2)
+				view.set_(1, sstate.ssc.iter, sstate.nextpos, prevend);
+#endif
+			else
+				return static_cast<regex_constants::error_type>(reason);
+
+			if (!callback(static_cast<const view_type &>(view)))
+				break;
+
+			const sub_match<BidirectionalIterator> m0 = view[0];
+
+			prevend = start = m0.second;
+
+			if (m0.first == m0.second)
+			{
+				if (start == end)
+					break;
+
+				utf_traits::codepoint_inc(start, end);
+			}
+			flags |= regex_constants::match_prev_avail;
+		}
+		return 0;
+	}
+
+	//  Each line is searched as a subject of its own, so that ^ and $ match
+	//  at its ends as with the multiline flag and no match runs over '\n'.
+	//  Lines that cannot contain the literal or the single character every
+	//  match contains are skipped by one scan of the rest of the subject,
+	//  and the line number and position are brought up to date in bulk.
+	template <typename BidirectionalIterator, typename Callback>
+	regex_constants::error_type do_for_each_line(
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags,
+		interrupt_checker *const ic
+	) const
+	{
+		typedef typename std::iterator_traits<BidirectionalIterator>::value_type char_type;
+		typedef typename std::iterator_traits<BidirectionalIterator>::iterator_category iterator_category;
+		typedef matched_line<BidirectionalIterator> line_type;
+		re_search_state<BidirectionalIterator> sstate;
+		line_type line(sstate);
+		BidirectionalIterator linebegin = begin;
+		const char_type lf = static_cast<char_type>(char_ctrl::cc_nl);
+
+		sstate.set_interrupter(ic);
+
+		while (linebegin != end)
+		{
+			BidirectionalIterator found = linebegin;
+
+#if !defined(SRELLDBG_NO_BMH)
+			if (this->bmdata)
+			{
+				sstate.init(linebegin, end, linebegin, flags);
+
+				const int reason = search_core(sstate);
+
+				if (reason != 2)
+					return static_cast<regex_constants::error_type>(reason);
+
+				found = sstate.ssc.iter;
+			}
+#endif
+#if !defined(SRELLDBG_NO_SCFINDER)
+			if (found == linebegin && this->NFA_states.size() && this->NFA_states[0].char_num != constants::invalid_u32value)
+			{
+				found = find_sc(linebegin, end, iterator_category());
+
+				if (found == end)
+					return 0;
+			}
+#endif
+
+			if (found != linebegin)
+			{
+				BidirectionalIterator skipto = found;
+
+				for (; skipto != linebegin; --skipto)
+				{
+					BidirectionalIterator prev = skipto;
+
+					if (*--prev == lf)
+						break;
+				}
+				line.lineno_ += static_cast<std::size_t>(std::count(linebegin, skipto, lf));
+				line.position_ += static_cast<std::size_t>(std::distance(linebegin, skipto));
+				linebegin = skipto;
+			}
+
+			const BidirectionalIterator lineend = find_lf(linebegin, end, iterator_category());
+
+			sstate.init(linebegin, lineend, linebegin, flags);
+
+			const int reason = search_core(sstate);
+
+			if (reason == 1)
+				line.view_.set_(sstate.bracket.size(), sstate.bracket[0].core.open_at, sstate.ssc.iter, linebegin);
+#if !defined(SRELLDBG_NO_BMH)
+			else if (reason == 2)
+				line.view_.set_(1, sstate.ssc.iter, sstate.nextpos, linebegin);
+#endif
+			else if (reason != 0)
+				return static_cast<regex_constants::error_type>(reason);
+
+			if (reason != 0)
+			{
+				line.first_ = linebegin;
+				line.second_ = lineend;
+
+				if (!callback(static_cast<const line_type &>(line)))
+					break;
+			}
+
+			if (lineend == end)
+				break;
+
+			line.position_ += static_cast<std::size_t>(std::distance(linebegin, lineend)) + 1;
+			++line.lineno_;
+			linebegin = lineend;
+			++linebegin;
+		}
+		return 0;
+	}
+
+	template <typename ContiguousIterator>
+	ContiguousIterator find_lf(const ContiguousIterator begin, const ContiguousIterator end, const std::random_access_iterator_tag) const
+	{
+		if (is_contiguous(begin) && begin != end)
+		{
+			typedef typename std::iterator_traits<ContiguousIterator>::value_type char_type;
+			const char_type *const found = std::char_traits<char_type>::find(&*begin, end - begin, static_cast<char_type>(char_ctrl::cc_nl));
+
+			return found ? begin + (found - &*begin) : end;
+		}
+		return std::find(begin, end, static_cast<typename std::iterator_traits<ContiguousIterator>::value_type>(char_ctrl::cc_nl));
+	}
+
+	template <typename BidirectionalIterator>
+	BidirectionalIterator find_lf(const BidirectionalIterator begin, const BidirectionalIterator end, const std::bidirectional_iterator_tag) const
+	{
+		return std::find(begin, end, static_cast<typename std::iterator_traits<BidirectionalIterator>::value_type>(char_ctrl::cc_nl));
+	}
+
+	template <typename BidirectionalIterator>
+	int do_count(
+		std::size_t &count,
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		regex_constants::match_flag_type flags,
+		interrupt_checker *const ic
+	) const
+	{
+		re_search_state<BidirectionalIterator> sstate;
+		BidirectionalIterator start = begin;
+		bool prevmatch_empty = false;
+
+		sstate.set_interrupter(ic);
+		count = 0;
+
+		for (;;)
+		{
+			int reason;
+
+			if (!prevmatch_empty)
+			{
+				sstate.init(start, end, begin, flags);
+				reason = search_core(sstate);
+			}
+			else
+			{
+				//  28.12.1.4.3: Same as regex_iterator::operator++().
+				sstate.init(start, end, begin, flags | regex_constants::match_not_null | regex_constants::match_continuous);
+				reason = search_core(sstate);
+
+				if (reason == 0)
+				{
+					utf_traits::codepoint_inc(start, end);
+					flags |= regex_constants::match_prev_avail;
+
+					sstate.init(start, end, begin, flags);
+					reason = search_core(sstate);
+				}
+			}
+
+			BidirectionalIterator matchbegin;
+
+			if (reason == 1)
+			{
+				matchbegin = sstate.bracket[0].core.open_at;
+				start = sstate.ssc.iter;
+			}
+#if !defined(SRELLDBG_NO_BMH)
+			else if (reason == 2)
+			{
+				matchbegin = sstate.ssc.iter;
+				start = sstate.nextpos;
+			}
+#endif
+			else
+				return reason;
+
+			++count;
+
+			prevmatch_empty = matchbegin == start;
+
+			if (prevmatch_empty)
+			{
+				if (start == end)
+					return 0;
+			}
+			else
+				flags |= regex_constants::match_prev_avail;
+		}
+	}
+
 	template <typename BidiIter>
 	struct submatch_helper : public sub_match<BidiIter>
 	{
@@ -22960,6 +26443,8 @@ public:
 
 	static const regex_constants::syntax_option_type dotall = regex_constants::dotall;
 	static const regex_constants::syntax_option_type unicodesets = regex_constants::unicodesets;
+	static const regex_constants::syntax_option_type noredos = regex_constants::noredos;
+	static const regex_constants::syntax_option_type atomic = regex_constants::atomic;
 
 	//  28.8.2, construct/copy/destroy:
 	//  [7.8.2] construct/copy/destroy
@@ -23128,6 +26613,61 @@ public:
 		return re_detail::re_object_core<charT, traits>::ecode();
 	}
 
+#if !defined(SRELL_NO_RISKCHECK)
+
+	//  Result of the analysis of loops done when the expression was compiled.
+	//  risk_position() and risk_length() give the part of the expression that
+	//  caused the risk, counted in code points.
+	regex_constants::risk_type backtracking_risk() const
+	{
+		return this->risk_level;
+	}
+
+	std::size_t risk_position() const
+	{
+		return this->risk_span.first;
+	}
+
+	std::size_t risk_length() const
+	{
+		return this->risk_span.second - this->risk_span.first;
+	}
+
+#endif	//  !defined(SRELL_NO_RISKCHECK)
+
+#if defined(SRELL_ENABLE_STATS)
+
+	//  Number of states left after the optimisation at compile time.
+	std::size_t state_count() const
+	{
+		return this->NFA_states.size();
+	}
+
+#endif	//  defined(SRELL_ENABLE_STATS)
+
+#if defined(SRELL_ENABLE_PROFILER)
+
+	//  Formats the counts in prof, collected by searches with this object,
+	//  as a table or in JSON. Passing the expression adds the part of it
+	//  that each state was made from.
+	std::string profile_report(const search_profile &prof, const bool json = false) const
+	{
+		return this->profile_report_(prof, static_cast<const charT *>(NULL), static_cast<const charT *>(NULL), json);
+	}
+
+	std::string profile_report(const search_profile &prof, const charT *const p, const bool json = false) const
+	{
+		return this->profile_report_(prof, p, p + std::char_traits<charT>::length(p), json);
+	}
+
+	template <typename ST, typename SA>
+	std::string profile_report(const search_profile &prof, const std::basic_string<charT, ST, SA> &p, const bool json = false) const
+	{
+		return this->profile_report_(prof, p.begin(), p.end(), json);
+	}
+
+#endif	//  defined(SRELL_ENABLE_PROFILER)
+
 #if !defined(SRELL_NO_APIEXT)
 
 	template <typename BidirectionalIterator, typename Allocator>
@@ -23410,6 +26950,220 @@ public:
 		this->template do_split<MatchResults>(c, str, str + std::char_traits<charT>::length(str), limit);
 	}
 
+	//  Calls callback(const match_view<BidirectionalIterator> &) for each match
+	//  found in [begin, end), in the same order as regex_iterator2 visits them,
+	//  until the callback returns false. One search state is kept throughout
+	//  the scan and no match_results is constructed.
+	//  If ic is not NULL, it is consulted at intervals during the scan (see
+	//  interrupt_checker).
+	//  The callback is taken by reference and is neither copied nor moved,
+	//  so a lambda or a temporary function object can be passed as well.
+	//  Since C++11 it is a forwarding reference, and what a non-const
+	//  function object gathers in its members is left in it after the call.
+	//  In C++98 it is a const reference, so the operator() has to be const.
+	//  Returns 0, or the error that stopped the search in the no throw mode.
+	template <typename BidirectionalIterator, typename Callback>
+	regex_constants::error_type for_each_match(
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_match(begin, begin, end, callback, flags, ic);
+	}
+
+	template <typename Callback>
+	regex_constants::error_type for_each_match(
+		const charT *const str,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_match(str, str, str + std::char_traits<charT>::length(str), callback, flags, ic);
+	}
+
+	template <typename ST, typename SA, typename Callback>
+	regex_constants::error_type for_each_match(
+		const std::basic_string<charT, ST, SA> &s,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_match(s.begin(), s.begin(), s.end(), callback, flags, ic);
+	}
+
+	//  Splits [begin, end) into lines at '\n' and calls
+	//  callback(const matched_line<BidirectionalIterator> &) for each line
+	//  in which the expression matches, until the callback returns false.
+	//  Each line is searched on its own: ^ and $ match at its ends, and
+	//  neither a match nor a lookbehind reaches into the next or previous
+	//  line. A '\r' before '\n' belongs to the line. A last line without
+	//  '\n' is searched too, but the empty one after a final '\n' is not.
+	//  callback, ic and the return value are the same as for_each_match().
+	template <typename BidirectionalIterator, typename Callback>
+	regex_constants::error_type search_lines(
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_line(begin, end, callback, flags, ic);
+	}
+
+	template <typename Callback>
+	regex_constants::error_type search_lines(
+		const charT *const str,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_line(str, str + std::char_traits<charT>::length(str), callback, flags, ic);
+	}
+
+	template <typename ST, typename SA, typename Callback>
+	regex_constants::error_type search_lines(
+		const std::basic_string<charT, ST, SA> &s,
+		Callback SRELL_FORWARDING_REF callback,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_for_each_line(s.begin(), s.end(), callback, flags, ic);
+	}
+
+	//  Sets num to the number of matches that regex_iterator would visit in
+	//  [begin, end), without constructing any match_results.
+	//  ic and the return value are the same as for_each_match(). If an
+	//  error occurs in the no throw mode, num is the number of matches found
+	//  before it.
+	template <typename BidirectionalIterator>
+	regex_constants::error_type count(
+		std::size_t &num,
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_count(num, begin, end, flags, ic);
+	}
+
+	regex_constants::error_type count(
+		std::size_t &num,
+		const charT *const str,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_count(num, str, str + std::char_traits<charT>::length(str), flags, ic);
+	}
+
+	template <typename ST, typename SA>
+	regex_constants::error_type count(
+		std::size_t &num,
+		const std::basic_string<charT, ST, SA> &s,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->do_count(num, s.begin(), s.end(), flags, ic);
+	}
+
+	//  Writes the offsets from begin of the matches found in [begin, end)
+	//  into column arrays supplied by the caller: starts[n][row] and
+	//  ends[n][row] receive the start and end of the n-th sub-match of the
+	//  row-th match, for n in [0, numcols). Each column must have room for
+	//  capacity elements. An unmatched group is stored as OffsetType(-1).
+	//  Matches are visited in the same order as for_each_match(), until
+	//  capacity rows are written. rows is set to the number of rows written.
+	//  If a match is found after the last row, the scan stops there and next
+	//  is set to the offset at which that match begins; otherwise next is
+	//  set to std::size_t(-1). The rest of the matches can be extracted by
+	//  the overload below that resumes the scan at begin + next.
+	//  The offsets are converted to OffsetType by static_cast, so OffsetType
+	//  has to be able to represent the length of the subject; otherwise they
+	//  wrap around.
+	//  ic and the return value are the same as for_each_match().
+	template <typename BidirectionalIterator, typename OffsetType>
+	regex_constants::error_type extract_offsets(
+		std::size_t &rows,
+		std::size_t &next,
+		const BidirectionalIterator begin,
+		const BidirectionalIterator end,
+		OffsetType *const *const starts,
+		OffsetType *const *const ends,
+		const std::size_t numcols,
+		const std::size_t capacity,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->extract_offsets(rows, next, begin, begin, end, starts, ends, numcols, capacity, flags, ic);
+	}
+
+	//  The same as above but the scan starts at from in [begin, end). The
+	//  offsets are still measured from begin, and lookbehinds can look back
+	//  to begin, so a scan stopped by capacity is resumed by passing
+	//  begin + next as from.
+	template <typename BidirectionalIterator, typename OffsetType>
+	regex_constants::error_type extract_offsets(
+		std::size_t &rows,
+		std::size_t &next,
+		const BidirectionalIterator begin,
+		const BidirectionalIterator from,
+		const BidirectionalIterator end,
+		OffsetType *const *const starts,
+		OffsetType *const *const ends,
+		const std::size_t numcols,
+		const std::size_t capacity,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		const re_detail::columnar_writer<BidirectionalIterator, OffsetType> writer(rows, next, starts, ends, numcols, capacity);
+
+		return this->do_for_each_match(begin, from, end, writer, flags, ic);
+	}
+
+	template <typename OffsetType>
+	regex_constants::error_type extract_offsets(
+		std::size_t &rows,
+		std::size_t &next,
+		const charT *const str,
+		OffsetType *const *const starts,
+		OffsetType *const *const ends,
+		const std::size_t numcols,
+		const std::size_t capacity,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->extract_offsets(rows, next, str, str + std::char_traits<charT>::length(str), starts, ends, numcols, capacity, flags, ic);
+	}
+
+	template <typename ST, typename SA, typename OffsetType>
+	regex_constants::error_type extract_offsets(
+		std::size_t &rows,
+		std::size_t &next,
+		const std::basic_string<charT, ST, SA> &s,
+		OffsetType *const *const starts,
+		OffsetType *const *const ends,
+		const std::size_t numcols,
+		const std::size_t capacity,
+		const regex_constants::match_flag_type flags = regex_constants::match_default,
+		interrupt_checker *const ic = NULL
+	) const
+	{
+		return this->extract_offsets(rows, next, s.begin(), s.end(), starts, ends, numcols, capacity, flags, ic);
+	}
+
 private:
 
 	typedef re_detail::re_object<charT, traits> base_type;
@@ -23443,6 +27197,10 @@ template <class charT, class traits>
 	const regex_constants::syntax_option_type basic_regex<charT, traits>::dotall;
 template <class charT, class traits>
 	const regex_constants::syntax_option_type basic_regex<charT, traits>::unicodesets;
+template <class charT, class traits>
+	const regex_constants::syntax_option_type basic_regex<charT, traits>::noredos;
+template <class charT, class traits>
+	const regex_constants::syntax_option_type basic_regex<charT, traits>::atomic;
 
 //  28.8.6, basic_regex swap:
 template <class charT, class traits>